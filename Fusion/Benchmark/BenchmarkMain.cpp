@@ -0,0 +1,73 @@
+/******************************************************************************
+	BenchmarkMain.cpp
+
+	Date      : 18 Oct 2026
+******************************************************************************/
+
+#include <QCoreApplication>
+#include <QCommandLineParser>
+#include <QStringList>
+
+#include "FusionBenchmark.h"
+
+// usage:
+//   FusionBenchmark --data "Siemens testing data results on RTStruct" --size 320,320,29
+//                   --iterations 5 --out result.json --filter "RTStruct|Flip"
+int main(int argc, char *argv[])
+{
+	QCoreApplication app(argc, argv);
+	QCoreApplication::setApplicationName("FusionBenchmark");
+
+	QCommandLineParser parser;
+	parser.setApplicationDescription("Micro benchmarks for the Fusion import and conversion paths");
+	parser.addHelpOption();
+
+	QCommandLineOption dataOption("data", "Folder with the RTSTRUCT sample cases.", "dir");
+	QCommandLineOption sizeOption("size", "Synthetic volume dimension x,y,z (default 320,320,29).", "x,y,z", "320,320,29");
+	QCommandLineOption iterationsOption("iterations", "Iterations per benchmark (default 5).", "n", "5");
+	QCommandLineOption outOption("out", "Write Google Benchmark style JSON to this file.", "file");
+	QCommandLineOption filterOption("filter", "Regular expression selecting the benchmarks to run.", "regex");
+	QCommandLineOption dicomDirOption("dicomdir", "DICOMDIR file for the DicomDirParser benchmark.", "file");
+	parser.addOption(dataOption);
+	parser.addOption(sizeOption);
+	parser.addOption(iterationsOption);
+	parser.addOption(outOption);
+	parser.addOption(filterOption);
+	parser.addOption(dicomDirOption);
+	parser.process(app);
+
+	FusionBenchmark::Settings settings;
+	settings.sDataDir = parser.value(dataOption);
+	settings.sDicomDirFile = parser.value(dicomDirOption);
+	settings.sJsonFile = parser.value(outOption);
+	settings.sFilter = parser.value(filterOption);
+	settings.iIterations = parser.value(iterationsOption).toInt();
+
+	QStringList size = parser.value(sizeOption).split(',');
+	if (size.size() != 3)
+	{
+		printf("invalid --size, expected x,y,z\n");
+		return 1;
+	}
+	for (int i = 0; i < 3; i++)
+	{
+		settings.iSyntheticSize[i] = size.at(i).toInt();
+		if (settings.iSyntheticSize[i] <= 0)
+		{
+			printf("invalid --size, expected x,y,z\n");
+			return 1;
+		}
+	}
+
+	FusionBenchmark benchmark(settings);
+	int iNumFailed = benchmark.Run();
+	benchmark.PrintSummary();
+
+	if (!settings.sJsonFile.isEmpty() && !benchmark.WriteJson(settings.sJsonFile))
+	{
+		printf("failed to write %s\n", settings.sJsonFile.toLatin1().data());
+		return 1;
+	}
+
+	return iNumFailed > 0 ? 2 : 0;
+}
@@ -0,0 +1,198 @@
+/******************************************************************************
+	BrickedVolume.cpp
+
+	Date      : 18 Oct 2026
+******************************************************************************/
+
+#include <string.h>
+
+#include "BrickedVolume.h"
+#include "ImageStack.h"
+#include "FusionTrace.h"
+
+namespace
+{
+	// walks the bricks in storage order, so each brick is loaded once per plane
+	template <typename T>
+	void ExtractSagittalPlane(const BrickedVolume& volume, int x, T* pOutput)
+	{
+		const int* dim = volume.GetDimension();
+		for (int z0 = 0; z0 < dim[2]; z0 += BRICK_SIZE)
+		{
+			int z1 = qMin(z0 + BRICK_SIZE, dim[2]);
+			for (int y0 = 0; y0 < dim[1]; y0 += BRICK_SIZE)
+			{
+				int y1 = qMin(y0 + BRICK_SIZE, dim[1]);
+				for (int z = z0; z < z1; z++)
+				{
+					// consecutive y are one brick row apart
+					const T* pVoxel = (const T*)volume.GetVoxelPtr(x, y0, z);
+					T* pRow = pOutput + (qint64)z * dim[1];
+					for (int y = y0; y < y1; y++, pVoxel += BRICK_SIZE)
+						pRow[y] = *pVoxel;
+				}
+			}
+		}
+	}
+}
+
+/******************************************************************************/
+/* Constructors and destructors
+/******************************************************************************/
+
+BrickedVolume::BrickedVolume()
+{
+	m_dim[0] = m_dim[1] = m_dim[2] = 0;
+	m_bricks[0] = m_bricks[1] = m_bricks[2] = 0;
+	m_iPixelSize = 0;
+}
+
+BrickedVolume::~BrickedVolume()
+{
+}
+
+/******************************************************************************/
+/* Conversion functions
+/******************************************************************************/
+
+bool BrickedVolume::FromImageStack(ImageStack* pImageStack)
+{
+	if (!pImageStack || !pImageStack->GetPixelsPtr())
+		return false;
+
+	return FromFlat(pImageStack->GetPixelsPtr(), pImageStack->GetDimension(), pImageStack->GetPixelSize());
+}
+
+bool BrickedVolume::FromFlat(const void* pPixels, const int dim[3], int iPixelSize)
+{
+	Clear();
+
+	if (!pPixels || dim[0] <= 0 || dim[1] <= 0 || dim[2] <= 0)
+		return false;
+	if (iPixelSize != 1 && iPixelSize != 2 && iPixelSize != 4)
+		return false;
+
+	FUSION_TRACE_SCOPE("BrickVolume", "import");
+
+	for (int i = 0; i < 3; i++)
+	{
+		m_dim[i] = dim[i];
+		m_bricks[i] = (dim[i] + BRICK_MASK) >> BRICK_SHIFT;
+	}
+	m_iPixelSize = iPixelSize;
+
+	// zero filled, the padding of the border bricks stays zero
+	m_data.fill(0, m_bricks[0] * m_bricks[1] * m_bricks[2] * BRICK_VOXELS * iPixelSize);
+
+	// every source row is split into brick rows
+	const unsigned char* pSrc = (const unsigned char*)pPixels;
+	int iRowSize = dim[0] * iPixelSize;
+	for (int z = 0; z < dim[2]; z++)
+	{
+		for (int y = 0; y < dim[1]; y++)
+		{
+			const unsigned char* pRow = pSrc + ((qint64)z * dim[1] + y) * iRowSize;
+			for (int bx = 0; bx < m_bricks[0]; bx++)
+			{
+				int iNumVoxels = qMin(BRICK_SIZE, dim[0] - (bx << BRICK_SHIFT));
+				memcpy(GetBrickRow(bx, y >> BRICK_SHIFT, z >> BRICK_SHIFT, y & BRICK_MASK, z & BRICK_MASK),
+					pRow + (bx << BRICK_SHIFT) * iPixelSize, iNumVoxels * iPixelSize);
+			}
+		}
+	}
+
+	return true;
+}
+
+bool BrickedVolume::ToFlat(void* pPixels) const
+{
+	if (!pPixels || IsEmpty())
+		return false;
+
+	FUSION_TRACE_SCOPE("UnbrickVolume", "import");
+
+	// the region reader already writes x fastest rows
+	int min[3] = { 0, 0, 0 };
+	return ExtractRegion(min, m_dim, pPixels);
+}
+
+void BrickedVolume::Clear()
+{
+	m_dim[0] = m_dim[1] = m_dim[2] = 0;
+	m_bricks[0] = m_bricks[1] = m_bricks[2] = 0;
+	m_iPixelSize = 0;
+	m_data.clear();
+	m_data.squeeze();
+}
+
+/******************************************************************************/
+/* Access functions
+/******************************************************************************/
+
+bool BrickedVolume::ExtractSagittal(int x, void* pOutput) const
+{
+	if (!pOutput || IsEmpty() || x < 0 || x >= m_dim[0])
+		return false;
+
+	switch (m_iPixelSize)
+	{
+		case 1:
+			ExtractSagittalPlane(*this, x, (quint8*)pOutput);
+		break;
+
+		case 2:
+			ExtractSagittalPlane(*this, x, (quint16*)pOutput);
+		break;
+
+		case 4:
+			ExtractSagittalPlane(*this, x, (quint32*)pOutput);
+		break;
+
+		default:
+			return false;
+	}
+
+	return true;
+}
+
+bool BrickedVolume::ExtractCoronal(int y, void* pOutput) const
+{
+	if (!pOutput || IsEmpty() || y < 0 || y >= m_dim[1])
+		return false;
+
+	// a coronal plane is the region one voxel thick in y
+	int min[3] = { 0, y, 0 };
+	int max[3] = { m_dim[0], y + 1, m_dim[2] };
+	return ExtractRegion(min, max, pOutput);
+}
+
+bool BrickedVolume::ExtractRegion(const int min[3], const int max[3], void* pOutput) const
+{
+	if (!pOutput || IsEmpty())
+		return false;
+
+	for (int i = 0; i < 3; i++)
+	{
+		if (min[i] < 0 || max[i] > m_dim[i] || min[i] >= max[i])
+			return false;
+	}
+
+	// brick rows are contiguous in x, so each output row is a few memcpy
+	unsigned char* pDst = (unsigned char*)pOutput;
+	for (int z = min[2]; z < max[2]; z++)
+	{
+		for (int y = min[1]; y < max[1]; y++)
+		{
+			int x = min[0];
+			while (x < max[0])
+			{
+				int iNumVoxels = qMin(BRICK_SIZE - (x & BRICK_MASK), max[0] - x);
+				memcpy(pDst, GetVoxelPtr(x, y, z), iNumVoxels * m_iPixelSize);
+				pDst += iNumVoxels * m_iPixelSize;
+				x += iNumVoxels;
+			}
+		}
+	}
+
+	return true;
+}
@@ -0,0 +1,75 @@
+/******************************************************************************
+	BrickedVolume.h
+
+	Date      : 18 Oct 2026
+******************************************************************************/
+
+#ifndef BRICKED_VOLUME_H
+#define BRICKED_VOLUME_H
+
+#include <QVector>
+
+class ImageStack;
+
+#define BRICK_SHIFT 4
+#define BRICK_SIZE (1 << BRICK_SHIFT)	// voxels along each edge of a brick
+#define BRICK_MASK (BRICK_SIZE - 1)
+#define BRICK_VOXELS (BRICK_SIZE * BRICK_SIZE * BRICK_SIZE)
+
+// Copy of an ImageStack in 16x16x16 bricks. Inside a brick the voxels are x
+// fastest, the bricks themselves are stored x, y, z. Every voxel is at most a
+// brick away from its neighbours along any axis, so sagittal, coronal and
+// sub region reads stay in a few kB of memory instead of striding across
+// whole slices.
+//
+// The flat x fastest buffer is still what VTK and ITK take, FromFlat() and
+// ToFlat() convert between the two. Bricks at the upper borders are padded
+// with zeros.
+class BrickedVolume
+{
+public:
+	BrickedVolume();
+	~BrickedVolume();
+
+	// conversion
+	bool FromImageStack(ImageStack* pImageStack);
+	bool FromFlat(const void* pPixels, const int dim[3], int iPixelSize);
+	bool ToFlat(void* pPixels) const;
+	void Clear();
+
+	bool IsEmpty() const { return m_data.isEmpty(); }
+	const int* GetDimension() const { return m_dim; }
+	int GetPixelSize() const { return m_iPixelSize; }
+
+	// voxel access, no bounds checks
+	inline const unsigned char* GetVoxelPtr(int x, int y, int z) const
+	{
+		qint64 iBrick = ((qint64)(z >> BRICK_SHIFT) * m_bricks[1] + (y >> BRICK_SHIFT)) * m_bricks[0] + (x >> BRICK_SHIFT);
+		int iVoxel = (((z & BRICK_MASK) << BRICK_SHIFT) + (y & BRICK_MASK)) * BRICK_SIZE + (x & BRICK_MASK);
+		return m_data.constData() + (iBrick * BRICK_VOXELS + iVoxel) * m_iPixelSize;
+	}
+
+	template <typename T>
+	inline T GetVoxel(int x, int y, int z) const { return *(const T*)GetVoxelPtr(x, y, z); }
+
+	// planes with z as rows, same layout as ImageStackReslicer
+	bool ExtractSagittal(int x, void* pOutput) const;	// dim[1] x dim[2]
+	bool ExtractCoronal(int y, void* pOutput) const;	// dim[0] x dim[2]
+
+	// box [min, max) written x fastest into pOutput
+	bool ExtractRegion(const int min[3], const int max[3], void* pOutput) const;
+
+protected:
+	inline unsigned char* GetBrickRow(int bx, int by, int bz, int ly, int lz)
+	{
+		qint64 iBrick = ((qint64)bz * m_bricks[1] + by) * m_bricks[0] + bx;
+		return m_data.data() + (iBrick * BRICK_VOXELS + ((lz << BRICK_SHIFT) + ly) * BRICK_SIZE) * m_iPixelSize;
+	}
+
+	int m_dim[3];
+	int m_bricks[3];	// number of bricks along each axis
+	int m_iPixelSize;
+	QVector<unsigned char> m_data;
+};
+
+#endif
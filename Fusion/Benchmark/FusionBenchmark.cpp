@@ -0,0 +1,1098 @@
+/******************************************************************************
+	FusionBenchmark.cpp
+
+	Date      : 18 Oct 2026
+******************************************************************************/
+
+#pragma warning(disable:4996)
+
+#include <QDir>
+#include <QDirIterator>
+#include <QFileInfo>
+#include <QElapsedTimer>
+#include <QDateTime>
+#include <QRegularExpression>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QThread>
+#include <QVector>
+#include <QXmlStreamReader>
+#include <QtMath>
+
+#include "FusionBenchmark.h"
+#include "FusionSurgery.h"
+#include "ImageStackReslicer.h"
+#include "BrickedVolume.h"
+#include "ChunkedCrypto.h"
+#include "ZipArchiveWriter.h"
+#include "DicomDirImporter.h"
+#include "RTStruct.h"
+#include "RTROI.h"
+#include "inurbsSubModel.h"
+#include "inurbsPlanarCurve.h"
+#include "inurbsPlanarCurveStack.h"
+#include "CommonClasses.h"
+#include "Constants.h"
+
+/******************************************************************************/
+/* Benchmark surgery
+/******************************************************************************/
+
+// gives the benchmark access to the image stack and model creation without
+// going through the controller and the visual engine
+class BenchmarkSurgery : public FusionSurgery
+{
+public:
+	bool CreateSyntheticImageStack(const int dim[3])
+	{
+		int size[3] = { dim[0], dim[1], dim[2] };
+		double spacing[3] = { 0.625, 0.625, 3.0 };
+		double origin[3];
+		for (int i = 0; i < 3; i++)
+			origin[i] = -(spacing[i] * size[i] / 2);
+
+		if (!CreateImageStack(size, origin, spacing, 2))
+			return false;
+
+		// fill with a fixed pseudo random pattern so that runs are comparable
+		short* pPixels = (short*)m_pImageStack->GetPixelsPtr();
+		qint64 iNumPixels = (qint64)size[0] * size[1] * size[2];
+		unsigned int seed = 12345;
+		for (qint64 i = 0; i < iNumPixels; i++)
+		{
+			seed = seed * 1103515245 + 12345;
+			pPixels[i] = (short)((seed >> 16) & 0x3ff);
+		}
+
+		m_pImageStack->SetModality(ImageStack::MODALITY_MRI);
+		m_pImageStack->SetWindowCenterWidthDicom(512, 1024);
+		return true;
+	}
+
+	void ResetModel()
+	{
+		NewUrologyModel(MODEL_MODE_SEMIAUTO);
+		CreateSubModel(MODEL_PROSTATE, SURFACE_CLOSED);
+		NewLesionsModel();
+	}
+
+	void ReleaseRTStruct()
+	{
+		delete m_pRTStruct;
+		m_pRTStruct = NULL;
+	}
+
+	// prostate and lesion curves with negative, rounding and large coordinates
+	void CreateSyntheticModel(int iNumSlices, int iNumPoints)
+	{
+		ResetModel();
+
+		QVector<inurbsPoint> points(iNumPoints);
+		for (int iSubModel = 0; iSubModel < 3; iSubModel++)
+		{
+			inurbsSubModel* pSubModel = iSubModel == 0 ? m_pUrologyModel->GetSubModel(MODEL_PROSTATE) : CreateLesionSubModel();
+			if (iSubModel > 0)
+				pSubModel->SetRiskScore(iSubModel + 2);
+
+			double fRadius = iSubModel == 0 ? 25.0 : 4.0;
+			double fCentre = iSubModel == 0 ? 0.0 : (iSubModel == 1 ? -10.00005 : 12.34565);
+			for (int z = 0; z < iNumSlices; z++)
+			{
+				double fZ = -43.5 + z * 3.0;
+				double fOffsetY = z == 0 ? -1000.0 : 0.0;
+				for (int i = 0; i < iNumPoints; i++)
+				{
+					double fAngle = 2.0 * M_PI * i / iNumPoints;
+					points[i] = inurbsPoint(fCentre + fRadius * cos(fAngle), fCentre + fRadius * sin(fAngle) + fOffsetY, fZ);
+				}
+
+				inurbsPlanarCurve* pCurve = pSubModel->GetCurveStack()->CreateCurve(fZ);
+				pCurve->SetPoints(points.data(), iNumPoints);
+			}
+		}
+	}
+
+	// the two writers of model.xml, UrologyModel through the DOM and the stream of SaveModel
+	bool WriteModelXmlDom(QString sRemarks)
+	{
+		return m_pUrologyModel->SaveLesionsModel(m_sCasePath, sRemarks, "");
+	}
+
+	bool WriteModelXmlStream(QString sRemarks)
+	{
+		m_sLesionRemarks = sRemarks;
+		m_pLesionRemarksModel = m_pUrologyModel;
+		return WriteModelXml("");
+	}
+};
+
+// compares two model.xml files element by element, the indentation and the
+// XML declaration aside. sDifference gets the first element that differs
+static bool CompareModelXml(QString sFile, QString sOtherFile, QString& sDifference)
+{
+	QFile file(sFile), otherFile(sOtherFile);
+	if (!file.open(QIODevice::ReadOnly) || !otherFile.open(QIODevice::ReadOnly))
+	{
+		sDifference = "cannot read the written files";
+		return false;
+	}
+
+	QXmlStreamReader reader(&file), otherReader(&otherFile);
+	QXmlStreamReader* pReaders[2] = { &reader, &otherReader };
+	while (true)
+	{
+		// the next element start, end or text of each file
+		QString sTokens[2];
+		for (int i = 0; i < 2; i++)
+		{
+			while (!pReaders[i]->atEnd())
+			{
+				QXmlStreamReader::TokenType token = pReaders[i]->readNext();
+				if (token == QXmlStreamReader::StartElement)
+					sTokens[i] = "<" + pReaders[i]->name().toString() + ">";
+				else if (token == QXmlStreamReader::EndElement)
+					sTokens[i] = "</" + pReaders[i]->name().toString() + ">";
+				else if (token == QXmlStreamReader::Characters && !pReaders[i]->isWhitespace())
+					sTokens[i] = pReaders[i]->text().toString().trimmed();
+				else
+					continue;
+				break;
+			}
+		}
+
+		if (reader.hasError() || otherReader.hasError())
+		{
+			sDifference = reader.hasError() ? reader.errorString() : otherReader.errorString();
+			return false;
+		}
+
+		if (sTokens[0] != sTokens[1])
+		{
+			sDifference = QString("line %1: %2, line %3: %4").arg(reader.lineNumber()).arg(sTokens[0])
+				.arg(otherReader.lineNumber()).arg(sTokens[1]);
+			return false;
+		}
+
+		if (reader.atEnd() && otherReader.atEnd())
+			return true;
+	}
+}
+
+/******************************************************************************/
+/* Constructors and destructors
+/******************************************************************************/
+
+FusionBenchmark::FusionBenchmark(const Settings& settings)
+{
+	m_settings = settings;
+	if (m_settings.iIterations < 1)
+		m_settings.iIterations = 1;
+}
+
+FusionBenchmark::~FusionBenchmark()
+{
+	RemoveTempCaseDirs();
+}
+
+/******************************************************************************/
+/* Run functions
+/******************************************************************************/
+
+int FusionBenchmark::Run()
+{
+	m_results.clear();
+	m_sampleCases = FindSampleCases();
+
+	RunRTStructSuite();
+	RunModelXmlSuite();
+	RunImportSuite();
+	RunSyntheticSuite();
+	RunResliceSuite();
+	RunBrickSuite();
+	RunCryptoSuite();
+	RunDicomDirSuite();
+
+	RemoveTempCaseDirs();
+
+	int iNumFailed = 0;
+	for (int i = 0; i < m_results.size(); i++)
+	{
+		if (m_results.at(i).bSkipped && m_results.at(i).sMessage.startsWith("failed"))
+			iNumFailed++;
+	}
+
+	return iNumFailed;
+}
+
+bool FusionBenchmark::IsEnabled(QString sName)
+{
+	if (m_settings.sFilter.isEmpty())
+		return true;
+
+	return QRegularExpression(m_settings.sFilter).match(sName).hasMatch();
+}
+
+FusionBenchmark::Result& FusionBenchmark::Measure(QString sName, BenchmarkFunction setup, BenchmarkFunction body, BenchmarkFunction teardown)
+{
+	Result result;
+	result.sName = sName;
+	result.iIterations = 0;
+	result.fMeanMs = result.fMinMs = result.fMaxMs = 0.0;
+	result.fBytes = result.fContours = result.fSlices = 0.0;
+	result.bSkipped = false;
+
+	double fTotalMs = 0.0;
+	QElapsedTimer timer;
+
+	for (int i = 0; i < m_settings.iIterations; i++)
+	{
+		if (setup && !setup())
+		{
+			result.bSkipped = true;
+			result.sMessage = "failed in setup";
+			break;
+		}
+
+		timer.start();
+		bool bOk = body();
+		double fMs = timer.nsecsElapsed() / 1.0e6;
+
+		if (teardown)
+			teardown();
+
+		if (!bOk)
+		{
+			result.bSkipped = true;
+			result.sMessage = "failed";
+			break;
+		}
+
+		fTotalMs += fMs;
+		if (result.iIterations == 0 || fMs < result.fMinMs)
+			result.fMinMs = fMs;
+		if (fMs > result.fMaxMs)
+			result.fMaxMs = fMs;
+		result.iIterations++;
+	}
+
+	if (result.iIterations > 0)
+		result.fMeanMs = fTotalMs / result.iIterations;
+
+	m_results.append(result);
+	return m_results.last();
+}
+
+void FusionBenchmark::Skip(QString sName, QString sMessage)
+{
+	Result result;
+	result.sName = sName;
+	result.iIterations = 0;
+	result.fMeanMs = result.fMinMs = result.fMaxMs = 0.0;
+	result.fBytes = result.fContours = result.fSlices = 0.0;
+	result.bSkipped = true;
+	result.sMessage = sMessage;
+	m_results.append(result);
+}
+
+/******************************************************************************/
+/* Suites
+/******************************************************************************/
+
+void FusionBenchmark::RunRTStructSuite()
+{
+	for (int c = 0; c < m_sampleCases.size(); c++)
+	{
+		const SampleCase& sample = m_sampleCases.at(c);
+
+		// LoadRTStruct
+		QString sName = "LoadRTStruct/" + sample.sName;
+		if (IsEnabled(sName))
+		{
+			BenchmarkSurgery surgery;
+			QString sFile = sample.sRTStructFile;
+
+			Result& result = Measure(sName, BenchmarkFunction(), [&surgery, sFile]() {
+				return surgery.LoadRTStruct(sFile, "");
+			});
+
+			result.fBytes = QFileInfo(sFile).size();
+			RTStruct* pRTStruct = surgery.GetRTStruct();
+			if (pRTStruct)
+			{
+				for (int i = 0; i < pRTStruct->GetNumROIs(); i++)
+					result.fContours += pRTStruct->GetROI(i)->GetNumContours();
+			}
+		}
+
+		// ReleaseRTStruct, the teardown on case close
+		sName = "ReleaseRTStruct/" + sample.sName;
+		if (IsEnabled(sName))
+		{
+			BenchmarkSurgery surgery;
+			QString sFile = sample.sRTStructFile;
+
+			Result& result = Measure(sName, [&surgery, sFile]() {
+				return surgery.LoadRTStruct(sFile, "");
+			}, [&surgery]() {
+				surgery.ReleaseRTStruct();
+				return true;
+			});
+
+			result.fBytes = QFileInfo(sFile).size();
+		}
+
+		// ConvertRTContoursToModel, needs the referenced images
+		sName = "ConvertRTContoursToModel/" + sample.sName;
+		if (!IsEnabled(sName))
+			continue;
+
+		if (sample.imageFiles.isEmpty())
+		{
+			Skip(sName, "no image series found next to the RTSTRUCT file");
+			continue;
+		}
+
+		QString sFile = sample.sRTStructFile;
+		QStringList files = sample.imageFiles;
+
+		BenchmarkSurgery surgery;
+		surgery.SetCasePath(CreateTempCaseDir(sample.sName));
+		if (!surgery.ImportDICOMImages(files, FusionSurgery::FLIP_NONE, 0, 0))
+		{
+			Skip(sName, "failed to import image series");
+			continue;
+		}
+		double fContours = 0.0;
+
+		// the conversion transforms the contour points in place, so the
+		// RTSTRUCT and the model are reloaded before every iteration
+		Result& result = Measure(sName, [&surgery, &fContours, sFile]() {
+			surgery.ResetModel();
+			if (!surgery.LoadRTStruct(sFile, ""))
+				return false;
+
+			fContours = 0.0;
+			RTStruct* pRTStruct = surgery.GetRTStruct();
+			for (int i = 0; i < pRTStruct->GetNumROIs(); i++)
+				fContours += pRTStruct->GetROI(i)->GetNumContours();
+			return true;
+		}, [&surgery, files]() {
+			return surgery.ConvertRTContoursToModel(files, "");
+		});
+
+		result.fContours = fContours;
+		result.fSlices = files.size();
+
+		// releasing the converted model, as on case close
+		sName = "ReleaseModel/" + sample.sName;
+		if (!IsEnabled(sName))
+			continue;
+
+		Result& releaseResult = Measure(sName, [&surgery, files, sFile]() {
+			surgery.ResetModel();
+			return surgery.LoadRTStruct(sFile, "") && surgery.ConvertRTContoursToModel(files, "");
+		}, [&surgery]() {
+			surgery.ResetModel();
+			return true;
+		});
+
+		releaseResult.fContours = fContours;
+		releaseResult.fSlices = files.size();
+	}
+}
+
+void FusionBenchmark::RunModelXmlSuite()
+{
+	// the streamed model.xml replaces the DOM writer of UrologyModel, the match
+	// fails the run when its elements, numbers or escaping drift from it
+	const int iNumSlices = 30;
+	const int iNumPoints = 64;
+	QString sRemarks = QString::fromUtf8("Lesion <1> & \"2\" 'apex', \xc3\xa4\xc3\xb6 > 5 mm");
+	QString sCaseName = QString("synthetic_%1x%2").arg(iNumSlices).arg(iNumPoints);
+
+	BenchmarkSurgery surgery;
+	QString sCaseDir = CreateTempCaseDir(sCaseName);
+	surgery.SetCasePath(sCaseDir);
+	surgery.CreateSyntheticModel(iNumSlices, iNumPoints);
+
+	QString sModelFile = sCaseDir + "/model/" + XML_FILE_NAME_MODEL;
+	QString sDomFile = sModelFile + ".dom";
+
+	QString sName = "WriteModelXml/Dom/" + sCaseName;
+	if (IsEnabled(sName))
+	{
+		Result& result = Measure(sName, BenchmarkFunction(), [&surgery, sRemarks]() {
+			return surgery.WriteModelXmlDom(sRemarks);
+		});
+		result.fBytes = QFileInfo(sModelFile).size();
+		result.fContours = 3 * iNumSlices;
+	}
+
+	sName = "WriteModelXml/Stream/" + sCaseName;
+	if (IsEnabled(sName))
+	{
+		Result& result = Measure(sName, BenchmarkFunction(), [&surgery, sRemarks]() {
+			return surgery.WriteModelXmlStream(sRemarks);
+		});
+		result.fBytes = QFileInfo(sModelFile).size();
+		result.fContours = 3 * iNumSlices;
+	}
+
+	sName = "ModelXmlMatch/" + sCaseName;
+	if (!IsEnabled(sName))
+		return;
+
+	QString sDifference;
+	QFile::remove(sDomFile);
+	if (!surgery.WriteModelXmlDom(sRemarks) || !QFile::rename(sModelFile, sDomFile) || !surgery.WriteModelXmlStream(sRemarks))
+		Skip(sName, "failed to write model.xml");
+	else if (!CompareModelXml(sDomFile, sModelFile, sDifference))
+		Skip(sName, "failed, the streamed model.xml differs from the DOM one at " + sDifference);
+	else
+	{
+		Result& result = Measure(sName, BenchmarkFunction(), [sDomFile, sModelFile, &sDifference]() {
+			return CompareModelXml(sDomFile, sModelFile, sDifference);
+		});
+		result.fBytes = QFileInfo(sModelFile).size();
+		result.fContours = 3 * iNumSlices;
+	}
+}
+
+void FusionBenchmark::RunImportSuite()
+{
+	for (int c = 0; c < m_sampleCases.size(); c++)
+	{
+		const SampleCase& sample = m_sampleCases.at(c);
+		if (sample.imageFiles.isEmpty())
+			continue;
+
+		QString sName = "ImportDICOMImages/" + sample.sName;
+		if (!IsEnabled(sName))
+			continue;
+
+		BenchmarkSurgery surgery;
+		surgery.SetCasePath(CreateTempCaseDir(sample.sName));
+		QStringList files = sample.imageFiles;
+
+		Result& result = Measure(sName, BenchmarkFunction(), [&surgery, &files]() {
+			return surgery.ImportDICOMImages(files, FusionSurgery::FLIP_NONE, 0, 0);
+		});
+
+		for (int i = 0; i < files.size(); i++)
+			result.fBytes += QFileInfo(files.at(i)).size();
+		result.fSlices = files.size();
+	}
+}
+
+void FusionBenchmark::RunSyntheticSuite()
+{
+	const int* dim = m_settings.iSyntheticSize;
+	QString sSize = QString("%1x%2x%3").arg(dim[0]).arg(dim[1]).arg(dim[2]);
+
+	BenchmarkSurgery surgery;
+	surgery.SetCasePath(CreateTempCaseDir("synthetic"));
+	if (!surgery.CreateSyntheticImageStack(dim))
+	{
+		Skip("Synthetic/" + sSize, "failed to allocate synthetic image stack");
+		return;
+	}
+
+	ImageStack* pImageStack = surgery.GetImageStack();
+	double fBytes = pImageStack->GetSize();
+
+	struct FlipCase { const char* name; int iFlip; };
+	FlipCase flipCases[] = {
+		{ "FLIP_X", FusionSurgery::FLIP_X },
+		{ "FLIP_Y", FusionSurgery::FLIP_Y },
+		{ "FLIP_Z", FusionSurgery::FLIP_Z },
+		{ "FLIP_AntPos", FusionSurgery::FLIP_X | FusionSurgery::FLIP_Y },
+		{ "FLIP_ApexBase", FusionSurgery::FLIP_X | FusionSurgery::FLIP_Z },
+	};
+
+	for (int i = 0; i < (int)(sizeof(flipCases) / sizeof(flipCases[0])); i++)
+	{
+		QString sName = QString("FlipImageStack/%1/%2").arg(flipCases[i].name).arg(sSize);
+		if (!IsEnabled(sName))
+			continue;
+
+		int iFlip = flipCases[i].iFlip;
+		Result& result = Measure(sName, BenchmarkFunction(), [&surgery, iFlip]() {
+			surgery.FlipImageStack(iFlip);
+			return true;
+		});
+		result.fBytes = fBytes;
+		result.fSlices = dim[2];
+	}
+
+	QString sName = "SaveImageStack8Bit/" + sSize;
+	if (IsEnabled(sName))
+	{
+		Result& result = Measure(sName, BenchmarkFunction(), [&surgery]() {
+			return surgery.SaveImageStack8Bit("");
+		});
+		result.fBytes = fBytes;
+		result.fSlices = dim[2];
+	}
+}
+
+void FusionBenchmark::RunResliceSuite()
+{
+	const int* dim = m_settings.iSyntheticSize;
+	QString sSize = QString("%1x%2x%3").arg(dim[0]).arg(dim[1]).arg(dim[2]);
+
+	BenchmarkSurgery surgery;
+	if (!surgery.CreateSyntheticImageStack(dim))
+	{
+		Skip("Reslice/" + sSize, "failed to allocate synthetic image stack");
+		return;
+	}
+
+	ImageStack* pImageStack = surgery.GetImageStack();
+	const short* pPixels = (const short*)pImageStack->GetPixelsPtr();
+	double fBytes = pImageStack->GetSize();
+
+	ImageStackReslicer reslicer;
+	QString sName = "ResliceBuild/" + sSize;
+	if (IsEnabled(sName))
+	{
+		Result& result = Measure(sName, BenchmarkFunction(), [&reslicer, pImageStack]() {
+			return reslicer.SetImageStack(pImageStack);
+		});
+		result.fBytes = fBytes;
+		result.fSlices = dim[2];
+	}
+
+	// a crosshair drag across the whole volume, one plane per voxel
+	QVector<short> plane(qMax(dim[0], dim[1]) * dim[2]);
+
+	sName = "SagittalSweep/Strided/" + sSize;
+	if (IsEnabled(sName))
+	{
+		Result& result = Measure(sName, BenchmarkFunction(), [&plane, pPixels, dim]() {
+			for (int x = 0; x < dim[0]; x++)
+			{
+				short* pOut = plane.data();
+				for (int z = 0; z < dim[2]; z++)
+					for (int y = 0; y < dim[1]; y++)
+						*pOut++ = pPixels[((qint64)z * dim[1] + y) * dim[0] + x];
+			}
+			return true;
+		});
+		result.fBytes = fBytes;
+		result.fSlices = dim[0];
+	}
+
+	sName = "SagittalSweep/Transposed/" + sSize;
+	if (IsEnabled(sName))
+	{
+		Result& result = Measure(sName, [&reslicer, pImageStack]() {
+			return reslicer.GetImageStack() == pImageStack || reslicer.SetImageStack(pImageStack);
+		}, [&reslicer, &plane, dim]() {
+			for (int x = 0; x < dim[0]; x++)
+			{
+				if (!reslicer.GetSagittalSlice(x, plane.data()))
+					return false;
+			}
+			return true;
+		});
+		result.fBytes = fBytes;
+		result.fSlices = dim[0];
+	}
+
+	sName = "CoronalSweep/Strided/" + sSize;
+	if (IsEnabled(sName))
+	{
+		Result& result = Measure(sName, BenchmarkFunction(), [&plane, pPixels, dim]() {
+			for (int y = 0; y < dim[1]; y++)
+			{
+				short* pOut = plane.data();
+				for (int z = 0; z < dim[2]; z++)
+				{
+					memcpy(pOut, pPixels + ((qint64)z * dim[1] + y) * dim[0], dim[0] * sizeof(short));
+					pOut += dim[0];
+				}
+			}
+			return true;
+		});
+		result.fBytes = fBytes;
+		result.fSlices = dim[1];
+	}
+
+	sName = "CoronalSweep/Transposed/" + sSize;
+	if (IsEnabled(sName))
+	{
+		Result& result = Measure(sName, [&reslicer, pImageStack]() {
+			return reslicer.GetImageStack() == pImageStack || reslicer.SetImageStack(pImageStack);
+		}, [&reslicer, &plane, dim]() {
+			for (int y = 0; y < dim[1]; y++)
+			{
+				if (!reslicer.GetCoronalSlice(y, plane.data()))
+					return false;
+			}
+			return true;
+		});
+		result.fBytes = fBytes;
+		result.fSlices = dim[1];
+	}
+}
+
+void FusionBenchmark::RunBrickSuite()
+{
+	const int* dim = m_settings.iSyntheticSize;
+	QString sSize = QString("%1x%2x%3").arg(dim[0]).arg(dim[1]).arg(dim[2]);
+
+	BenchmarkSurgery surgery;
+	if (!surgery.CreateSyntheticImageStack(dim))
+	{
+		Skip("Brick/" + sSize, "failed to allocate synthetic image stack");
+		return;
+	}
+
+	ImageStack* pImageStack = surgery.GetImageStack();
+	const short* pPixels = (const short*)pImageStack->GetPixelsPtr();
+	double fBytes = pImageStack->GetSize();
+
+	BrickedVolume volume;
+	QString sName = "BrickConvert/FromFlat/" + sSize;
+	if (IsEnabled(sName))
+	{
+		Result& result = Measure(sName, BenchmarkFunction(), [&volume, pImageStack]() {
+			return volume.FromImageStack(pImageStack);
+		});
+		result.fBytes = fBytes;
+		result.fSlices = dim[2];
+	}
+
+	if (volume.IsEmpty() && !volume.FromImageStack(pImageStack))
+	{
+		Skip("Brick/" + sSize, "failed to brick the synthetic image stack");
+		return;
+	}
+
+	QVector<short> buffer((qint64)dim[0] * dim[1] * dim[2]);
+	sName = "BrickConvert/ToFlat/" + sSize;
+	if (IsEnabled(sName))
+	{
+		Result& result = Measure(sName, BenchmarkFunction(), [&volume, &buffer, pPixels, fBytes]() {
+			return volume.ToFlat(buffer.data()) && memcmp(buffer.constData(), pPixels, (size_t)fBytes) == 0;
+		});
+		result.fBytes = fBytes;
+		result.fSlices = dim[2];
+	}
+
+	// same sweeps as the reslice suite, compare with SagittalSweep/Strided and CoronalSweep/Strided
+	sName = "SagittalSweep/Bricked/" + sSize;
+	if (IsEnabled(sName))
+	{
+		Result& result = Measure(sName, BenchmarkFunction(), [&volume, &buffer, dim]() {
+			for (int x = 0; x < dim[0]; x++)
+			{
+				if (!volume.ExtractSagittal(x, buffer.data()))
+					return false;
+			}
+			return true;
+		});
+		result.fBytes = fBytes;
+		result.fSlices = dim[0];
+	}
+
+	sName = "CoronalSweep/Bricked/" + sSize;
+	if (IsEnabled(sName))
+	{
+		Result& result = Measure(sName, BenchmarkFunction(), [&volume, &buffer, dim]() {
+			for (int y = 0; y < dim[1]; y++)
+			{
+				if (!volume.ExtractCoronal(y, buffer.data()))
+					return false;
+			}
+			return true;
+		});
+		result.fBytes = fBytes;
+		result.fSlices = dim[1];
+	}
+
+	// lesion sized boxes on a grid across the volume
+	const int iBox[3] = { qMin(48, dim[0]), qMin(48, dim[1]), qMin(16, dim[2]) };
+	QList<QVector<int> > boxes;
+	for (int z = 0; z + iBox[2] <= dim[2]; z += iBox[2])
+		for (int y = 0; y + iBox[1] <= dim[1]; y += iBox[1])
+			for (int x = 0; x + iBox[0] <= dim[0]; x += iBox[0])
+				boxes.append(QVector<int>() << x << y << z);
+
+	sName = "RegionRead/Flat/" + sSize;
+	if (IsEnabled(sName))
+	{
+		Result& result = Measure(sName, BenchmarkFunction(), [&boxes, &buffer, pPixels, dim, iBox]() {
+			for (int i = 0; i < boxes.size(); i++)
+			{
+				const QVector<int>& min = boxes.at(i);
+				short* pOut = buffer.data();
+				for (int z = min[2]; z < min[2] + iBox[2]; z++)
+				{
+					for (int y = min[1]; y < min[1] + iBox[1]; y++)
+					{
+						memcpy(pOut, pPixels + ((qint64)z * dim[1] + y) * dim[0] + min[0], iBox[0] * sizeof(short));
+						pOut += iBox[0];
+					}
+				}
+			}
+			return true;
+		});
+		result.fBytes = (double)boxes.size() * iBox[0] * iBox[1] * iBox[2] * sizeof(short);
+	}
+
+	sName = "RegionRead/Bricked/" + sSize;
+	if (IsEnabled(sName))
+	{
+		Result& result = Measure(sName, BenchmarkFunction(), [&volume, &boxes, &buffer, iBox]() {
+			for (int i = 0; i < boxes.size(); i++)
+			{
+				const QVector<int>& min = boxes.at(i);
+				int max[3] = { min[0] + iBox[0], min[1] + iBox[1], min[2] + iBox[2] };
+				if (!volume.ExtractRegion(min.constData(), max, buffer.data()))
+					return false;
+			}
+			return true;
+		});
+		result.fBytes = (double)boxes.size() * iBox[0] * iBox[1] * iBox[2] * sizeof(short);
+	}
+}
+
+void FusionBenchmark::RunCryptoSuite()
+{
+	const int* dim = m_settings.iSyntheticSize;
+	QString sSize = QString("%1x%2x%3").arg(dim[0]).arg(dim[1]).arg(dim[2]);
+
+	BenchmarkSurgery surgery;
+	if (!surgery.CreateSyntheticImageStack(dim))
+	{
+		Skip("ChunkedCrypto/" + sSize, "failed to allocate synthetic image stack");
+		return;
+	}
+
+	ImageStack* pImageStack = surgery.GetImageStack();
+	const unsigned char* pPixels = pImageStack->GetPixelsPtr();
+	qint64 iSliceSize = (qint64)dim[0] * dim[1] * pImageStack->GetPixelSize();
+	double fBytes = pImageStack->GetSize();
+
+	// one block per slice, as the case image file is written
+	QString sFile = CreateTempCaseDir("crypto") + "/" + "image16.fck";
+	QString sPassword = "benchmark";
+
+	QString sName = "ChunkedCrypto/Encrypt/" + sSize;
+	if (IsEnabled(sName))
+	{
+		Result& result = Measure(sName, BenchmarkFunction(), [pPixels, fBytes, sFile, sPassword, iSliceSize]() {
+			return ChunkedCrypto::EncryptToFile(pPixels, (qint64)fBytes, sFile, sPassword, (int)iSliceSize);
+		});
+		result.fBytes = fBytes;
+		result.fSlices = dim[2];
+	}
+
+	if (!QFileInfo(sFile).exists() && !ChunkedCrypto::EncryptToFile(pPixels, (qint64)fBytes, sFile, sPassword, (int)iSliceSize))
+	{
+		Skip("ChunkedCrypto/" + sSize, "failed to encrypt the synthetic image stack");
+		return;
+	}
+
+	// includes the key derivation, the fixed cost of opening a case
+	QVector<unsigned char> buffer((int)fBytes);
+	sName = "ChunkedCrypto/DecryptAll/" + sSize;
+	if (IsEnabled(sName))
+	{
+		Result& result = Measure(sName, BenchmarkFunction(), [&buffer, pPixels, fBytes, sFile, sPassword]() {
+			ChunkedCryptoReader reader;
+			return reader.Open(sFile, sPassword) && reader.ReadAll(buffer.data()) && memcmp(buffer.constData(), pPixels, (size_t)fBytes) == 0;
+		});
+		result.fBytes = fBytes;
+		result.fSlices = dim[2];
+	}
+
+	ChunkedCryptoReader reader;
+	if (!reader.Open(sFile, sPassword))
+	{
+		Skip("ChunkedCrypto/" + sSize, "failed to open the encrypted file");
+		return;
+	}
+
+	// the slices a user steps through, without decrypting the rest of the file
+	sName = "ChunkedCrypto/RandomSlice/" + sSize;
+	if (IsEnabled(sName))
+	{
+		Result& result = Measure(sName, BenchmarkFunction(), [&reader, &buffer, iSliceSize, dim]() {
+			unsigned int seed = 12345;
+			for (int i = 0; i < dim[2]; i++)
+			{
+				seed = seed * 1103515245 + 12345;
+				int z = (seed >> 16) % dim[2];
+				if (!reader.Read(z * iSliceSize, buffer.data(), iSliceSize))
+					return false;
+			}
+			return true;
+		});
+		result.fBytes = (double)iSliceSize * dim[2];
+		result.fSlices = dim[2];
+	}
+	reader.Close();
+
+	// re-encrypting a case with a new password, the passwords swap every run
+	sName = "ChunkedCrypto/Rekey/" + sSize;
+	if (IsEnabled(sName))
+	{
+		QString sPasswords[2] = { sPassword, sPassword + "2" };
+		int iCurrent = 0;
+		Result& result = Measure(sName, BenchmarkFunction(), [&sPasswords, &iCurrent, sFile]() {
+			if (!ChunkedCrypto::Rekey(sFile, sPasswords[iCurrent], sPasswords[1 - iCurrent]))
+				return false;
+			iCurrent = 1 - iCurrent;
+			return true;
+		});
+		result.fBytes = fBytes;
+		result.fSlices = dim[2];
+	}
+
+	// the anonymous export writes the image into a zip archive, deflated when it is plain
+	QString sArchiveFile = CreateTempCaseDir("archive") + "/" + "export.zip";
+	QByteArray pixels = QByteArray::fromRawData((const char*)pPixels, (int)fBytes);
+	sName = "ZipArchive/Deflate/" + sSize;
+	if (IsEnabled(sName))
+	{
+		Result& result = Measure(sName, BenchmarkFunction(), [&pixels, sArchiveFile]() {
+			ZipArchiveWriter archive;
+			return archive.Open(sArchiveFile) && archive.AddFile("image16.dat", pixels, true) && archive.Close();
+		});
+		result.fBytes = fBytes;
+		result.fSlices = dim[2];
+	}
+}
+
+void FusionBenchmark::RunDicomDirSuite()
+{
+	QStringList dicomDirFiles;
+	if (!m_settings.sDicomDirFile.isEmpty())
+		dicomDirFiles.append(m_settings.sDicomDirFile);
+	else if (!m_settings.sDataDir.isEmpty())
+	{
+		QDirIterator it(m_settings.sDataDir, QStringList() << "DICOMDIR", QDir::Files, QDirIterator::Subdirectories);
+		while (it.hasNext())
+			dicomDirFiles.append(it.next());
+	}
+
+	if (dicomDirFiles.isEmpty())
+	{
+		if (IsEnabled("DicomDirParser"))
+			Skip("DicomDirParser", "no DICOMDIR file found, pass one with --dicomdir");
+		return;
+	}
+
+	for (int i = 0; i < dicomDirFiles.size(); i++)
+	{
+		QString sFile = dicomDirFiles.at(i);
+		QString sName = "DicomDirParser/" + QFileInfo(sFile).dir().dirName();
+		if (!IsEnabled(sName))
+			continue;
+
+		int iNumImages = 0;
+		Result& result = Measure(sName, BenchmarkFunction(), [sFile, &iNumImages]() {
+			DicomDirImporter importer;
+			if (!importer.DicomDirParser(sFile))
+				return false;
+
+			iNumImages = 0;
+			QMapIterator<int, DicomDirImporter::DicomDirInfo> it(importer.MapDicomDirInfo);
+			while (it.hasNext())
+				iNumImages += it.next().value().filespath.size();
+			return true;
+		});
+
+		result.fBytes = QFileInfo(sFile).size();
+		result.fSlices = iNumImages;
+	}
+}
+
+/******************************************************************************/
+/* Output functions
+/******************************************************************************/
+
+bool FusionBenchmark::WriteJson(QString sFile)
+{
+	QJsonObject context;
+	context.insert("date", QDateTime::currentDateTime().toString(Qt::ISODate));
+	context.insert("executable", "FusionBenchmark");
+	context.insert("num_cpus", QThread::idealThreadCount());
+	context.insert("data_dir", m_settings.sDataDir);
+	context.insert("iterations", m_settings.iIterations);
+	QJsonArray size;
+	for (int i = 0; i < 3; i++)
+		size.append(m_settings.iSyntheticSize[i]);
+	context.insert("synthetic_size", size);
+#ifdef NDEBUG
+	context.insert("library_build_type", "release");
+#else
+	context.insert("library_build_type", "debug");
+#endif
+
+	QJsonArray benchmarks;
+	for (int i = 0; i < m_results.size(); i++)
+	{
+		const Result& result = m_results.at(i);
+
+		QJsonObject item;
+		item.insert("name", result.sName);
+		item.insert("iterations", result.iIterations);
+		item.insert("real_time", result.fMeanMs);
+		item.insert("min_time", result.fMinMs);
+		item.insert("max_time", result.fMaxMs);
+		item.insert("time_unit", "ms");
+
+		if (result.bSkipped)
+		{
+			item.insert("error_occurred", true);
+			item.insert("error_message", result.sMessage);
+		}
+		else if (result.fMeanMs > 0.0)
+		{
+			double fSeconds = result.fMeanMs / 1000.0;
+			if (result.fBytes > 0.0)
+			{
+				item.insert("bytes_per_second", result.fBytes / fSeconds);
+				item.insert("mb_per_second", result.fBytes / (1024.0 * 1024.0) / fSeconds);
+			}
+			if (result.fContours > 0.0)
+				item.insert("contours_per_second", result.fContours / fSeconds);
+			if (result.fSlices > 0.0)
+				item.insert("slices_per_second", result.fSlices / fSeconds);
+		}
+
+		benchmarks.append(item);
+	}
+
+	QJsonObject root;
+	root.insert("context", context);
+	root.insert("benchmarks", benchmarks);
+
+	QFile file(sFile);
+	if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate))
+		return false;
+
+	file.write(QJsonDocument(root).toJson(QJsonDocument::Indented));
+	file.close();
+	return true;
+}
+
+void FusionBenchmark::PrintSummary()
+{
+	printf("%-60s %10s %10s %10s %12s %12s %12s\n", "Benchmark", "Mean(ms)", "Min(ms)", "Iter", "MB/s", "Contours/s", "Slices/s");
+	printf("%s\n", QString(130, '-').toLatin1().data());
+
+	for (int i = 0; i < m_results.size(); i++)
+	{
+		const Result& result = m_results.at(i);
+		if (result.bSkipped)
+		{
+			printf("%-60s %s\n", result.sName.toLatin1().data(), ("skipped: " + result.sMessage).toLatin1().data());
+			continue;
+		}
+
+		double fSeconds = result.fMeanMs / 1000.0;
+		double fMBs = (fSeconds > 0.0) ? result.fBytes / (1024.0 * 1024.0) / fSeconds : 0.0;
+		double fContours = (fSeconds > 0.0) ? result.fContours / fSeconds : 0.0;
+		double fSlices = (fSeconds > 0.0) ? result.fSlices / fSeconds : 0.0;
+
+		printf("%-60s %10.3f %10.3f %10d %12.2f %12.1f %12.1f\n", result.sName.toLatin1().data(),
+			result.fMeanMs, result.fMinMs, result.iIterations, fMBs, fContours, fSlices);
+	}
+}
+
+/******************************************************************************/
+/* Helper functions
+/******************************************************************************/
+
+// An RTSTRUCT file is paired with the image series folder next to it, e.g.
+//   BotImage sample/example_rtstruct_file.dcm + BotImage sample/T2wAx-seriesnum_007-index_00/
+//   N11780398/AIRC ... RTSTRUCT/x.dcm       + N11780398/1753374N11780398T2/
+QList<FusionBenchmark::SampleCase> FusionBenchmark::FindSampleCases()
+{
+	QList<SampleCase> cases;
+	if (m_settings.sDataDir.isEmpty() || !QDir(m_settings.sDataDir).exists())
+		return cases;
+
+	QRegularExpression rtRegExp("rt_?struct", QRegularExpression::CaseInsensitiveOption);
+
+	// group dicom files by folder
+	QMap<QString, QStringList> seriesFolders;
+	QStringList rtFiles;
+	QDirIterator it(m_settings.sDataDir, QStringList() << "*.dcm" << "*.DCM", QDir::Files, QDirIterator::Subdirectories);
+	while (it.hasNext())
+	{
+		QString sFile = it.next();
+		if (rtRegExp.match(sFile).hasMatch())
+			rtFiles.append(sFile);
+		else
+			seriesFolders[QFileInfo(sFile).absolutePath()].append(sFile);
+	}
+
+	rtFiles.sort();
+	for (int i = 0; i < rtFiles.size(); i++)
+	{
+		QFileInfo rtInfo(rtFiles.at(i));
+		QDir rtDir = rtInfo.absoluteDir();
+
+		SampleCase sample;
+		sample.sRTStructFile = rtInfo.absoluteFilePath();
+
+		// look for a series in the folder of the RTSTRUCT first, then one level up
+		QStringList roots;
+		roots << rtDir.absolutePath();
+		QDir parentDir = rtDir;
+		if (parentDir.cdUp())
+			roots << parentDir.absolutePath();
+
+		for (int r = 0; r < roots.size() && sample.imageFiles.isEmpty(); r++)
+		{
+			QMapIterator<QString, QStringList> its(seriesFolders);
+			while (its.hasNext())
+			{
+				its.next();
+				if (QFileInfo(its.key()).absolutePath() == roots.at(r) && its.key() != rtDir.absolutePath())
+				{
+					sample.imageFiles = its.value();
+					sample.imageFiles.sort();
+					break;
+				}
+			}
+		}
+
+		// name the case after the folder directly below the data dir
+		QString sRelative = QDir(m_settings.sDataDir).relativeFilePath(sample.sRTStructFile);
+		sample.sName = sRelative.section('/', 0, 0);
+		if (sample.sName == sRelative) // file directly in the data dir
+			sample.sName = rtInfo.completeBaseName();
+
+		cases.append(sample);
+	}
+
+	return cases;
+}
+
+QString FusionBenchmark::CreateTempCaseDir(QString sName)
+{
+	QString sSafeName = sName;
+	sSafeName.replace(QRegularExpression("[^A-Za-z0-9_-]"), "_");
+
+	QString sPath = QDir::tempPath() + QString("/FusionBenchmark/case_%1_%2").arg(sSafeName).arg(m_tempCaseDirs.size());
+	RemoveDir(sPath);
+	QDir().mkpath(sPath + "/image");
+	QDir().mkpath(sPath + "/model");
+
+	m_tempCaseDirs.append(sPath);
+	return sPath;
+}
+
+void FusionBenchmark::RemoveTempCaseDirs()
+{
+	for (int i = 0; i < m_tempCaseDirs.size(); i++)
+		RemoveDir(m_tempCaseDirs.at(i));
+	m_tempCaseDirs.clear();
+}
@@ -0,0 +1,92 @@
+/******************************************************************************
+	FusionBenchmark.h
+
+	Date      : 18 Oct 2026
+******************************************************************************/
+
+#ifndef FUSION_BENCHMARK_H
+#define FUSION_BENCHMARK_H
+
+#include <functional>
+#include <QString>
+#include <QStringList>
+#include <QList>
+
+class FusionBenchmark
+{
+public:
+
+	// settings passed in from the command line
+	struct Settings
+	{
+		QString sDataDir;			// folder with the sample cases, e.g. "Siemens testing data results on RTStruct"
+		QString sDicomDirFile;		// optional DICOMDIR file for the DicomDirParser stage
+		QString sJsonFile;			// machine readable output
+		QString sFilter;			// regular expression on benchmark names, empty runs all
+		int iSyntheticSize[3];		// synthetic volume dimension in voxels
+		int iIterations;
+	};
+
+	// one line in the report
+	struct Result
+	{
+		QString sName;
+		int iIterations;
+		double fMeanMs;
+		double fMinMs;
+		double fMaxMs;
+		double fBytes;		// bytes processed per iteration
+		double fContours;	// contours processed per iteration
+		double fSlices;		// slices processed per iteration
+		bool bSkipped;
+		QString sMessage;
+	};
+
+	// a sample case is an RTSTRUCT file with the image series it references
+	struct SampleCase
+	{
+		QString sName;
+		QString sRTStructFile;
+		QStringList imageFiles;
+	};
+
+	// a function returning false aborts the benchmark and marks it as skipped
+	typedef std::function<bool()> BenchmarkFunction;
+
+	FusionBenchmark(const Settings& settings);
+	~FusionBenchmark();
+
+	int Run();
+	bool WriteJson(QString sFile);
+	void PrintSummary();
+
+	const QList<Result>& GetResults() { return m_results; }
+
+	// hooks for later suites
+	bool IsEnabled(QString sName);
+	Result& Measure(QString sName, BenchmarkFunction setup, BenchmarkFunction body, BenchmarkFunction teardown = BenchmarkFunction());
+	void Skip(QString sName, QString sMessage);
+
+protected:
+	// suites
+	void RunRTStructSuite();
+	void RunModelXmlSuite();
+	void RunImportSuite();
+	void RunSyntheticSuite();
+	void RunResliceSuite();
+	void RunBrickSuite();
+	void RunCryptoSuite();
+	void RunDicomDirSuite();
+
+	// helpers
+	QList<SampleCase> FindSampleCases();
+	QString CreateTempCaseDir(QString sName);
+	void RemoveTempCaseDirs();
+
+	Settings m_settings;
+	QList<Result> m_results;
+	QList<SampleCase> m_sampleCases;
+	QStringList m_tempCaseDirs;
+};
+
+#endif
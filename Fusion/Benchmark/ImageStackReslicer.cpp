@@ -0,0 +1,214 @@
+/******************************************************************************
+	ImageStackReslicer.cpp
+
+	Date      : 18 Oct 2026
+******************************************************************************/
+
+#include <QRunnable>
+#include <string.h>
+
+#include "ImageStackReslicer.h"
+#include "ImageStack.h"
+#include "FusionTrace.h"
+
+#define RESLICE_BLOCK 16 // rows transposed together, keeps the source rows in cache
+
+namespace
+{
+	// x, z, y from z, y, x for the slices [iFirstSlice, iLastSlice)
+	template <typename T>
+	void TransposeSagittal(const T* pSrc, T* pDst, const int dim[3], int iFirstSlice, int iLastSlice)
+	{
+		int nx = dim[0], ny = dim[1], nz = dim[2];
+		for (int z = iFirstSlice; z < iLastSlice; z++)
+		{
+			const T* pSlice = pSrc + (qint64)z * ny * nx;
+			for (int y0 = 0; y0 < ny; y0 += RESLICE_BLOCK)
+			{
+				int y1 = qMin(y0 + RESLICE_BLOCK, ny);
+				for (int x = 0; x < nx; x++)
+				{
+					T* pRow = pDst + ((qint64)x * nz + z) * ny;
+					for (int y = y0; y < y1; y++)
+						pRow[y] = pSlice[(qint64)y * nx + x];
+				}
+			}
+		}
+	}
+}
+
+/******************************************************************************/
+/* Build task
+/******************************************************************************/
+
+class ResliceBuildTask : public QRunnable
+{
+public:
+	ResliceBuildTask(ImageStackReslicer* pReslicer, const unsigned char* pPixels, int iFirstSlice, int iLastSlice)
+	{
+		m_pReslicer = pReslicer;
+		m_pPixels = pPixels;
+		m_iFirstSlice = iFirstSlice;
+		m_iLastSlice = iLastSlice;
+	}
+
+	void run()
+	{
+		// each task writes its own slices of both copies
+		m_pReslicer->BuildSagittal(m_pPixels, m_iFirstSlice, m_iLastSlice);
+		m_pReslicer->BuildCoronal(m_pPixels, m_iFirstSlice, m_iLastSlice);
+	}
+
+protected:
+	ImageStackReslicer* m_pReslicer;
+	const unsigned char* m_pPixels;
+	int m_iFirstSlice;
+	int m_iLastSlice;
+};
+
+/******************************************************************************/
+/* Constructors and destructors
+/******************************************************************************/
+
+ImageStackReslicer::ImageStackReslicer()
+{
+	m_pImageStack = NULL;
+	m_dim[0] = m_dim[1] = m_dim[2] = 0;
+	m_iPixelSize = 0;
+}
+
+ImageStackReslicer::~ImageStackReslicer()
+{
+	m_threadPool.waitForDone();
+}
+
+/******************************************************************************/
+/* Build functions
+/******************************************************************************/
+
+bool ImageStackReslicer::SetImageStack(ImageStack* pImageStack)
+{
+	Clear();
+
+	if (!pImageStack || !pImageStack->GetPixelsPtr())
+		return false;
+
+	int iPixelSize = pImageStack->GetPixelSize();
+	if (iPixelSize != 1 && iPixelSize != 2 && iPixelSize != 4)
+		return false;
+
+	FUSION_TRACE_SCOPE("BuildResliceVolumes", "render");
+
+	int* dim = pImageStack->GetDimension();
+	m_dim[0] = dim[0];
+	m_dim[1] = dim[1];
+	m_dim[2] = dim[2];
+	m_iPixelSize = iPixelSize;
+
+	int iSize = pImageStack->GetSize();
+	m_sagittal.resize(iSize);
+	m_coronal.resize(iSize);
+
+	// slices are split between the threads, the copies are written at disjoint rows
+	const unsigned char* pPixels = pImageStack->GetPixelsPtr();
+	int iNumTasks = qMax(1, qMin(m_threadPool.maxThreadCount(), m_dim[2]));
+	for (int i = 0; i < iNumTasks; i++)
+	{
+		int iFirstSlice = (qint64)m_dim[2] * i / iNumTasks;
+		int iLastSlice = (qint64)m_dim[2] * (i + 1) / iNumTasks;
+		m_threadPool.start(new ResliceBuildTask(this, pPixels, iFirstSlice, iLastSlice));
+	}
+	m_threadPool.waitForDone();
+
+	m_pImageStack = pImageStack;
+	return true;
+}
+
+void ImageStackReslicer::BuildSagittal(const unsigned char* pPixels, int iFirstSlice, int iLastSlice)
+{
+	switch (m_iPixelSize)
+	{
+		case 1:
+			TransposeSagittal((const quint8*)pPixels, (quint8*)m_sagittal.data(), m_dim, iFirstSlice, iLastSlice);
+		break;
+
+		case 2:
+			TransposeSagittal((const quint16*)pPixels, (quint16*)m_sagittal.data(), m_dim, iFirstSlice, iLastSlice);
+		break;
+
+		case 4:
+			TransposeSagittal((const quint32*)pPixels, (quint32*)m_sagittal.data(), m_dim, iFirstSlice, iLastSlice);
+		break;
+
+		default:
+		break;
+	}
+}
+
+void ImageStackReslicer::BuildCoronal(const unsigned char* pPixels, int iFirstSlice, int iLastSlice)
+{
+	// rows stay contiguous, they are only regrouped by y
+	int iRowSize = m_dim[0] * m_iPixelSize;
+	unsigned char* pDst = m_coronal.data();
+	for (int z = iFirstSlice; z < iLastSlice; z++)
+	{
+		for (int y = 0; y < m_dim[1]; y++)
+		{
+			const unsigned char* pSrcRow = pPixels + ((qint64)z * m_dim[1] + y) * iRowSize;
+			memcpy(pDst + ((qint64)y * m_dim[2] + z) * iRowSize, pSrcRow, iRowSize);
+		}
+	}
+}
+
+void ImageStackReslicer::Clear()
+{
+	m_threadPool.waitForDone();
+
+	m_pImageStack = NULL;
+	m_dim[0] = m_dim[1] = m_dim[2] = 0;
+	m_iPixelSize = 0;
+	m_sagittal.clear();
+	m_sagittal.squeeze();
+	m_coronal.clear();
+	m_coronal.squeeze();
+}
+
+/******************************************************************************/
+/* Plane functions
+/******************************************************************************/
+
+const unsigned char* ImageStackReslicer::GetSagittalPlane(int x)
+{
+	if (!m_pImageStack || x < 0 || x >= m_dim[0])
+		return NULL;
+
+	return m_sagittal.constData() + (qint64)x * m_dim[2] * m_dim[1] * m_iPixelSize;
+}
+
+const unsigned char* ImageStackReslicer::GetCoronalPlane(int y)
+{
+	if (!m_pImageStack || y < 0 || y >= m_dim[1])
+		return NULL;
+
+	return m_coronal.constData() + (qint64)y * m_dim[2] * m_dim[0] * m_iPixelSize;
+}
+
+bool ImageStackReslicer::GetSagittalSlice(int x, void* pOutput)
+{
+	const unsigned char* pPlane = GetSagittalPlane(x);
+	if (!pPlane || !pOutput)
+		return false;
+
+	memcpy(pOutput, pPlane, (size_t)m_dim[1] * m_dim[2] * m_iPixelSize);
+	return true;
+}
+
+bool ImageStackReslicer::GetCoronalSlice(int y, void* pOutput)
+{
+	const unsigned char* pPlane = GetCoronalPlane(y);
+	if (!pPlane || !pOutput)
+		return false;
+
+	memcpy(pOutput, pPlane, (size_t)m_dim[0] * m_dim[2] * m_iPixelSize);
+	return true;
+}
@@ -0,0 +1,66 @@
+/******************************************************************************
+	ImageStackReslicer.h
+
+	Date      : 18 Oct 2026
+******************************************************************************/
+
+#ifndef IMAGE_STACK_RESLICER_H
+#define IMAGE_STACK_RESLICER_H
+
+#include <QThreadPool>
+#include <QVector>
+
+class ImageStack;
+
+// Extracts axis aligned sagittal and coronal planes of an ImageStack without
+// striding through the volume. The stack is stored z, y, x, so a sagittal
+// plane touches one pixel per row of every slice. The reslicer keeps two
+// transposed copies instead, x, z, y for sagittal and y, z, x for coronal,
+// where every plane is one contiguous block.
+//
+// The copies are built once per image stack on a thread pool, the planes
+// are returned with z as rows, the first row is the first slice.
+//
+// The views do not use it yet, the sagittal and coronal slice pipelines are
+// in the visualization library. It is measured by the Reslice benchmark.
+class ImageStackReslicer
+{
+public:
+	ImageStackReslicer();
+	~ImageStackReslicer();
+
+	// builds the transposed copies, call again when the pixels of the stack change
+	bool SetImageStack(ImageStack* pImageStack);
+	ImageStack* GetImageStack() { return m_pImageStack; }
+	void Clear();
+
+	// plane size in pixels, sagittal planes are height x slices, coronal planes width x slices
+	void GetSagittalSize(int& iWidth, int& iHeight) { iWidth = m_dim[1]; iHeight = m_dim[2]; }
+	void GetCoronalSize(int& iWidth, int& iHeight) { iWidth = m_dim[0]; iHeight = m_dim[2]; }
+	int GetPixelSize() { return m_iPixelSize; }
+
+	// copy the plane at the voxel index into pOutput, which holds width x height pixels
+	bool GetSagittalSlice(int x, void* pOutput);
+	bool GetCoronalSlice(int y, void* pOutput);
+
+	// pointer to the plane inside the transposed copy, valid until the next SetImageStack
+	const unsigned char* GetSagittalPlane(int x);
+	const unsigned char* GetCoronalPlane(int y);
+
+protected:
+	void BuildSagittal(const unsigned char* pPixels, int iFirstSlice, int iLastSlice);
+	void BuildCoronal(const unsigned char* pPixels, int iFirstSlice, int iLastSlice);
+
+	ImageStack* m_pImageStack;
+	int m_dim[3];
+	int m_iPixelSize;
+
+	QVector<unsigned char> m_sagittal;	// x, z, y
+	QVector<unsigned char> m_coronal;	// y, z, x
+
+	QThreadPool m_threadPool;
+
+	friend class ResliceBuildTask;
+};
+
+#endif
@@ -0,0 +1,284 @@
+/******************************************************************************
+	CaseEncryptor.cpp
+
+	Date      : 18 Oct 2026
+******************************************************************************/
+
+#include <QRunnable>
+#include <QThreadPool>
+#include <QFile>
+#include <QFileInfo>
+#include <algorithm>
+
+#include "CaseEncryptor.h"
+#include "ChunkedCrypto.h"
+#include "FusionPdp.h"
+#include "FusionSurgery.h"
+#include "ModelBinaryFile.h"
+#include "ModelAutosave.h"
+#include "FusionTrace.h"
+#include "FusionDebugLog.h"
+#include "CommonClasses.h"
+#include "Constants.h"
+#include "PDP.h"
+
+#define CASE_ENCRYPT_PROGRESS_INTERVAL 100 // ms between progress updates
+#define CASE_ENCRYPT_STAGED_EXTENSION ".rekey" // copy encrypted with the new password
+
+/******************************************************************************/
+/* Encrypt task
+/******************************************************************************/
+
+class CaseFileEncryptTask : public QRunnable
+{
+public:
+	CaseFileEncryptTask(CaseEncryptor* pEncryptor, const CaseEncryptor::CaseFile& caseFile)
+	{
+		m_pEncryptor = pEncryptor;
+		m_caseFile = caseFile;
+	}
+
+	void run()
+	{
+		if (!m_pEncryptor->EncryptFile(m_caseFile))
+			m_pEncryptor->m_bFailed = true;
+	}
+
+protected:
+	CaseEncryptor* m_pEncryptor;
+	CaseEncryptor::CaseFile m_caseFile;
+};
+
+/******************************************************************************/
+/* Constructors and destructors
+/******************************************************************************/
+
+CaseEncryptor::CaseEncryptor(QObject* parent) : QObject(parent)
+{
+	m_bChunkedImage = false;
+	m_iTotalBytes = 0;
+	m_iDoneBytes = 0;
+	m_bFailed = false;
+}
+
+CaseEncryptor::~CaseEncryptor()
+{
+}
+
+/******************************************************************************/
+/* Encrypt functions
+/******************************************************************************/
+
+bool CaseEncryptor::Stage(QString sCaseDirPath, QString sDecryptPassword, QString sEncryptPassword)
+{
+	FUSION_TRACE_SCOPE("StageCaseEncryption", "case");
+
+	m_files.clear();
+	m_sCaseDirPath = sCaseDirPath;
+	m_sDecryptPassword = sDecryptPassword;
+	m_sEncryptPassword = sEncryptPassword;
+	m_iTotalBytes = 0;
+	m_iDoneBytes = 0;
+	m_bFailed = false;
+
+	// the files are encrypted if the case has them
+	m_bChunkedImage = AddFile(FusionSurgery::GetImageChunkedFileName(sCaseDirPath), FILE_CHUNKED);
+	AddFile(sCaseDirPath + "/model/" + MODEL_BINARY_FILE_NAME, FILE_PDP);
+	AddFile(ModelAutosave::GetFileName(sCaseDirPath), FILE_CHUNKED);
+
+	// the large image goes first, the small files fill in the other threads
+	QList<CaseFile> files = m_files;
+	std::sort(files.begin(), files.end(), [](const CaseFile& a, const CaseFile& b) { return a.iSize > b.iSize; });
+
+	emit progressChanged(0);
+
+	QThreadPool threadPool;
+	for (int i = 0; i < files.size(); i++)
+		threadPool.start(new CaseFileEncryptTask(this, files.at(i)));
+
+	while (!threadPool.waitForDone(CASE_ENCRYPT_PROGRESS_INTERVAL))
+		emit progressChanged(GetProgress());
+
+	emit progressChanged(100);
+
+	if (m_bFailed)
+	{
+		Discard();
+		return false;
+	}
+
+	return true;
+}
+
+bool CaseEncryptor::Commit()
+{
+	// the staged copies replace the files in the order they were added
+	bool bCommitted = true;
+	for (int i = 0; i < m_files.size(); i++)
+	{
+		if (!CommitFile(m_files.at(i)))
+		{
+			FUSION_DLOG(FUSION_DLOG_ERROR, "case", "encrypt-commit-failed", FusionDebugLog::Fields()
+				.Add("file", m_files.at(i).sFile));
+			bCommitted = false;
+		}
+	}
+
+	// mapped loading checks the modification time of the chunked image
+	if (m_bChunkedImage)
+		FusionSurgery::UpdateImageMapInfo(m_sCaseDirPath);
+
+	m_files.clear();
+	return bCommitted;
+}
+
+void CaseEncryptor::Discard()
+{
+	for (int i = 0; i < m_files.size(); i++)
+		RemoveStagedFile(m_files.at(i));
+	m_files.clear();
+}
+
+bool CaseEncryptor::AddFile(QString sFile, int iType)
+{
+	QFileInfo fileInfo(sFile);
+	if (iType == FILE_PDP && QFile::exists(sFile + ENCRYPTION_FILE_EXTENSION))
+		fileInfo.setFile(sFile + ENCRYPTION_FILE_EXTENSION);
+
+	if (!fileInfo.exists())
+		return false;
+
+	CaseFile caseFile;
+	caseFile.sFile = sFile;
+	caseFile.iType = iType;
+	caseFile.bPlain = iType == FILE_PDP && !QFile::exists(sFile + ENCRYPTION_FILE_EXTENSION);
+	caseFile.iSize = fileInfo.size();
+	m_files.append(caseFile);
+
+	m_iTotalBytes += caseFile.iSize;
+	return true;
+}
+
+int CaseEncryptor::GetProgress()
+{
+	if (m_iTotalBytes <= 0)
+		return 100;
+
+	return (int)qMin((qint64)100, m_iDoneBytes * 100 / m_iTotalBytes);
+}
+
+bool CaseEncryptor::EncryptFile(const CaseFile& caseFile)
+{
+	bool bEncrypted;
+	if (caseFile.iType == FILE_CHUNKED)
+		bEncrypted = EncryptChunkedFile(caseFile.sFile); // adds its progress block by block
+	else
+	{
+		bEncrypted = EncryptPdpFile(caseFile);
+		m_iDoneBytes += caseFile.iSize;
+	}
+
+	if (!bEncrypted)
+		FUSION_DLOG(FUSION_DLOG_WARNING, "case", "encrypt-file-failed", FusionDebugLog::Fields()
+			.Add("file", caseFile.sFile));
+
+	return bEncrypted;
+}
+
+bool CaseEncryptor::EncryptPdpFile(const CaseFile& caseFile)
+{
+	// the plain file is moved to the staged name, PdpEncrypt2 writes the staged
+	// name with the extension and removes the plain one
+	QString sFile = caseFile.sFile;
+	QString sStagedFile = GetStagedFileName(sFile);
+	QFile::remove(sStagedFile);
+	QFile::remove(sStagedFile + ENCRYPTION_FILE_EXTENSION);
+
+	if (caseFile.bPlain)
+	{
+		if (!QFile::rename(sFile, sStagedFile))
+			return false;
+	}
+	else
+	{
+		if (!FusionPdp::Decrypt(sFile + ENCRYPTION_FILE_EXTENSION, m_sDecryptPassword))
+			return false;
+		if (!QFile::rename(sFile, sStagedFile))
+		{
+			FusionPdp::Remove(sFile);
+			return false;
+		}
+	}
+
+	if (!FusionPdp::Encrypt(sStagedFile, m_sEncryptPassword))
+	{
+		if (caseFile.bPlain && QFile::exists(sStagedFile))
+			QFile::rename(sStagedFile, sFile);
+		else
+			FusionPdp::Remove(sStagedFile);
+		QFile::remove(sStagedFile + ENCRYPTION_FILE_EXTENSION);
+		return false;
+	}
+
+	return true;
+}
+
+bool CaseEncryptor::EncryptChunkedFile(QString sFile)
+{
+	QString sStagedFile = GetStagedFileName(sFile);
+	if (ChunkedCrypto::IsChunkedFile(sFile))
+		return ChunkedCrypto::Rekey(sFile, m_sDecryptPassword, m_sEncryptPassword, &m_iDoneBytes, sStagedFile);
+
+	// the autosave of an unencrypted case is plain
+	QFile file(sFile);
+	if (!file.open(QIODevice::ReadOnly))
+		return false;
+
+	QByteArray data = file.readAll();
+	file.close();
+
+	if (!ChunkedCrypto::EncryptToFile(data.constData(), data.size(), sStagedFile, m_sEncryptPassword))
+		return false;
+
+	m_iDoneBytes += data.size();
+	return true;
+}
+
+bool CaseEncryptor::CommitFile(const CaseFile& caseFile)
+{
+	QString sStagedFile = GetStagedFileName(caseFile.sFile);
+	if (caseFile.iType == FILE_CHUNKED)
+		return QFile::remove(caseFile.sFile) && QFile::rename(sStagedFile, caseFile.sFile);
+
+	// an unencrypted case keeps its plain file until the encrypted one is in place
+	QString sEncryptedFile = caseFile.sFile + ENCRYPTION_FILE_EXTENSION;
+	QFile::remove(sEncryptedFile);
+	if (!QFile::rename(sStagedFile + ENCRYPTION_FILE_EXTENSION, sEncryptedFile))
+		return false;
+
+	if (QFile::exists(caseFile.sFile))
+		FusionPdp::Remove(caseFile.sFile);
+	return true;
+}
+
+void CaseEncryptor::RemoveStagedFile(const CaseFile& caseFile)
+{
+	QString sStagedFile = GetStagedFileName(caseFile.sFile);
+	QString sStagedEncryptedFile = sStagedFile + ENCRYPTION_FILE_EXTENSION;
+
+	// a plain file only exists as its staged copy, it is decrypted back in place
+	if (caseFile.bPlain && !QFile::exists(caseFile.sFile) && QFile::exists(sStagedEncryptedFile))
+	{
+		if (FusionPdp::Decrypt(sStagedEncryptedFile, m_sEncryptPassword))
+			QFile::rename(sStagedFile, caseFile.sFile);
+	}
+
+	if (QFile::exists(sStagedFile))
+		FusionPdp::Remove(sStagedFile); // may be plain
+	QFile::remove(sStagedEncryptedFile);
+}
+
+QString CaseEncryptor::GetStagedFileName(QString sFile)
+{
+	return sFile + CASE_ENCRYPT_STAGED_EXTENSION;
+}
@@ -0,0 +1,78 @@
+/******************************************************************************
+	CaseEncryptor.h
+
+	Date      : 18 Oct 2026
+******************************************************************************/
+
+#ifndef CASE_ENCRYPTOR_H
+#define CASE_ENCRYPTOR_H
+
+#include <QObject>
+#include <QString>
+#include <QList>
+#include <atomic>
+
+// Encrypts the case files BaseSurgery::EncryptCase does not know with a new
+// password: the binary model copy, the chunked 16 bit image and the model
+// autosave. BaseSurgery::EncryptCase stays in charge of the files in PdpEncrypt2
+// format, the PDP library makes no thread safety promise, so those cannot be
+// split across threads.
+//
+// Stage() writes an encrypted copy next to every file. The chunked files are
+// re-keyed block by block over all cores, the binary model is moved to its
+// staged name and encrypted through FusionPdp, so no file is copied first.
+// Commit() puts the copies in place, Discard() restores the files, so a failed
+// BaseSurgery::EncryptCase leaves these files under their old password.
+// progressChanged() reports the bytes staged so far, from the thread Stage()
+// runs on.
+class CaseEncryptor : public QObject
+{
+	Q_OBJECT
+
+public:
+	CaseEncryptor(QObject* parent = 0);
+	~CaseEncryptor();
+
+	bool Stage(QString sCaseDirPath, QString sDecryptPassword, QString sEncryptPassword); // false if any file fails, nothing is staged then
+	bool Commit();
+	void Discard();
+
+protected:
+	enum { FILE_PDP, FILE_CHUNKED };
+
+	struct CaseFile
+	{
+		QString sFile; // plain file name, the encrypted one has ENCRYPTION_FILE_EXTENSION
+		int iType;
+		bool bPlain; // an unencrypted pdp file, it is moved to the staged name
+		qint64 iSize;
+	};
+
+	bool AddFile(QString sFile, int iType);
+	int GetProgress();
+	bool CommitFile(const CaseFile& caseFile);
+	void RemoveStagedFile(const CaseFile& caseFile);
+	static QString GetStagedFileName(QString sFile);
+
+	// called by the workers
+	bool EncryptFile(const CaseFile& caseFile);
+	bool EncryptPdpFile(const CaseFile& caseFile);
+	bool EncryptChunkedFile(QString sFile);
+
+	QList<CaseFile> m_files;
+	QString m_sCaseDirPath;
+	QString m_sDecryptPassword;
+	QString m_sEncryptPassword;
+	bool m_bChunkedImage;
+
+	qint64 m_iTotalBytes;
+	std::atomic<qint64> m_iDoneBytes;
+	std::atomic<bool> m_bFailed;
+
+	friend class CaseFileEncryptTask;
+
+signals:
+	void progressChanged(int value);
+};
+
+#endif
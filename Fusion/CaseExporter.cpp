@@ -0,0 +1,601 @@
+/******************************************************************************
+	CaseExporter.cpp
+
+	Date      : 18 Oct 2026
+******************************************************************************/
+
+#include <QRunnable>
+#include <QThreadPool>
+#include <QFile>
+#include <QFileInfo>
+#include <QDir>
+#include <QTemporaryDir>
+#include <QBuffer>
+#include <QRegularExpression>
+#include <QXmlStreamReader>
+#include <QXmlStreamWriter>
+#include <QVector>
+#include <algorithm>
+
+#include "CaseExporter.h"
+#include "ChunkedCrypto.h"
+#include "FusionSurgery.h"
+#include "FusionTrace.h"
+#include "FusionDebugLog.h"
+#include "FusionPdp.h"
+#include "CommonClasses.h"
+#include "Constants.h"
+
+#define CASE_EXPORT_PROGRESS_INTERVAL 100 // ms between progress updates
+#define CASE_EXPORT_MIN_IDENTIFIER 3 // shorter values are not replaced in free text
+#define CASE_EXPORT_BLOCK_SIZE (4 * 1024 * 1024) // bytes decrypted at a time from a chunked file
+#define CASE_EXPORT_TEMP_DIR "/.export-XXXXXX" // hidden folder for the decrypted files
+
+// parts of element and attribute names that carry the identity
+static const char* g_pIdentifyingKeywords[] = { "patient", "surgeon", "physician", "doctor", "clinic",
+	"hospital", "institution", "operator", "username", "login", "birth", "dob", "accession", "nationality",
+	"address", "phone" };
+#define NUM_IDENTIFYING_KEYWORDS (int)(sizeof(g_pIdentifyingKeywords) / sizeof(g_pIdentifyingKeywords[0]))
+
+// DICOM tags besides the patient group 0010, accession, institution, physicians and operators
+static const char* g_pIdentifyingDicomTags[] = { "00080050", "00080080", "00080081", "00080090",
+	"00081048", "00081050", "00081060", "00081070" };
+#define NUM_IDENTIFYING_DICOM_TAGS (int)(sizeof(g_pIdentifyingDicomTags) / sizeof(g_pIdentifyingDicomTags[0]))
+
+// identifying fields whose values are common words, they are replaced in the
+// field but not searched for in the text: sex, age, size, weight, ethnic group
+static const char* g_pUncollectedKeywords[] = { "gender", "sex", "nationality", "ethnic", "age", "weight", "size" };
+#define NUM_UNCOLLECTED_KEYWORDS (int)(sizeof(g_pUncollectedKeywords) / sizeof(g_pUncollectedKeywords[0]))
+
+static const char* g_pUncollectedDicomTags[] = { "00100040", "00101010", "00101020", "00101030", "00102160" };
+#define NUM_UNCOLLECTED_DICOM_TAGS (int)(sizeof(g_pUncollectedDicomTags) / sizeof(g_pUncollectedDicomTags[0]))
+
+/******************************************************************************/
+/* Anonymize helpers
+/******************************************************************************/
+
+// DICOM tags written as (0010,0010), 0010,0010 or 00100010, "" for other names
+static QString GetDicomTag(QString sName)
+{
+	QString sTag;
+	for (int i = 0; i < sName.size(); i++)
+	{
+		QChar c = sName.at(i);
+		if ((c >= '0' && c <= '9') || (c >= 'a' && c <= 'f'))
+			sTag += c;
+		else if (c != '(' && c != ')' && c != ',' && c != ' ')
+			return "";
+	}
+
+	return sTag.size() == 8 ? sTag : "";
+}
+
+static bool IsIdentifyingName(QString sName)
+{
+	sName = sName.toLower();
+	for (int i = 0; i < NUM_IDENTIFYING_KEYWORDS; i++)
+	{
+		if (sName.contains(g_pIdentifyingKeywords[i]))
+			return true;
+	}
+
+	QString sTag = GetDicomTag(sName);
+	if (sTag.startsWith("0010"))
+		return true;
+
+	for (int i = 0; i < NUM_IDENTIFYING_DICOM_TAGS; i++)
+	{
+		if (sTag == g_pIdentifyingDicomTags[i])
+			return true;
+	}
+
+	return false;
+}
+
+static bool IsCollectedName(QString sName)
+{
+	sName = sName.toLower();
+	for (int i = 0; i < NUM_UNCOLLECTED_KEYWORDS; i++)
+	{
+		if (sName.contains(g_pUncollectedKeywords[i]))
+			return false;
+	}
+
+	QString sTag = GetDicomTag(sName);
+	for (int i = 0; i < NUM_UNCOLLECTED_DICOM_TAGS; i++)
+	{
+		if (sTag == g_pUncollectedDicomTags[i])
+			return false;
+	}
+
+	return true;
+}
+
+static QRegularExpression GetIdentifierExpression(const QStringList& identifiers)
+{
+	if (identifiers.isEmpty())
+		return QRegularExpression();
+
+	// whole words only, a value inside a longer word or number is left alone
+	QStringList patterns;
+	for (int i = 0; i < identifiers.size(); i++)
+		patterns.append(QRegularExpression::escape(identifiers.at(i)));
+
+	return QRegularExpression("(?<!\\w)(?:" + patterns.join('|') + ")(?!\\w)",
+		QRegularExpression::CaseInsensitiveOption | QRegularExpression::UseUnicodePropertiesOption);
+}
+
+static QString ReplaceIdentifiers(QString sText, const QRegularExpression& expression)
+{
+	if (expression.pattern().isEmpty())
+		return sText;
+
+	return sText.replace(expression, CASE_EXPORT_ANONYMOUS_VALUE);
+}
+
+/******************************************************************************/
+/* Export task
+/******************************************************************************/
+
+class CaseFileExportTask : public QRunnable
+{
+public:
+	CaseFileExportTask(CaseExporter* pExporter, int iFile)
+	{
+		m_pExporter = pExporter;
+		m_iFile = iFile;
+	}
+
+	void run()
+	{
+		m_pExporter->ExportCaseFile(m_iFile);
+	}
+
+protected:
+	CaseExporter* m_pExporter;
+	int m_iFile;
+};
+
+/******************************************************************************/
+/* Constructors and destructors
+/******************************************************************************/
+
+CaseExporter::CaseExporter(QObject* parent) : QObject(parent)
+{
+	m_iTotalBytes = 0;
+	m_iDoneBytes = 0;
+}
+
+CaseExporter::~CaseExporter()
+{
+}
+
+/******************************************************************************/
+/* Export functions
+/******************************************************************************/
+
+bool CaseExporter::AddCase(QString sCaseDirPath, QString sPassword)
+{
+	// the identity is taken from surgery.xml before any other file is exported,
+	// it is decrypted in the case folder where the plain file already was
+	QTemporaryDir tempDir(sCaseDirPath + CASE_EXPORT_TEMP_DIR);
+	QByteArray surgeryXml;
+	if (!tempDir.isValid() || !ReadPdpFile(sCaseDirPath + "/surgery.xml", sPassword, tempDir.path() + "/surgery.xml", surgeryXml))
+		return false;
+
+	ExportCase exportCase;
+	exportCase.sPath = sCaseDirPath;
+	exportCase.sPassword = sPassword;
+
+	QByteArray anonymized;
+	QStringList found;
+	if (!AnonymizeXml(surgeryXml, QStringList(), anonymized, &found))
+		return false;
+
+	for (int i = 0; i < found.size(); i++)
+	{
+		QString sValue = found.at(i).trimmed();
+		if (sValue.size() >= CASE_EXPORT_MIN_IDENTIFIER && !exportCase.identifiers.contains(sValue, Qt::CaseInsensitive))
+			exportCase.identifiers.append(sValue);
+	}
+
+	// a longer value is replaced before a shorter one it contains
+	std::sort(exportCase.identifiers.begin(), exportCase.identifiers.end(), [](const QString& a, const QString& b) { return a.size() > b.size(); });
+
+	// the remarks of surgery.xml may name the patient too
+	if (!AnonymizeXml(surgeryXml, exportCase.identifiers, exportCase.surgeryXml))
+		return false;
+
+	int iCase = m_cases.size();
+	m_cases.append(exportCase);
+
+	AddFile(iCase, sCaseDirPath + "/surgery.xml", "surgery.xml", FILE_TEXT_XML);
+	AddFile(iCase, sCaseDirPath + "/tags.xml", "tags.xml", FILE_TEXT_XML);
+
+	QString sImageFolder = sCaseDirPath + "/image/";
+	AddFile(iCase, sImageFolder + XML_FILE_NAME_IMAGE, QString("image/") + XML_FILE_NAME_IMAGE, FILE_XML);
+	AddFile(iCase, sImageFolder + IMAGE_FILE_NAME, QString("image/") + IMAGE_FILE_NAME, FILE_DATA);
+
+	// the chunked copy of the 16 bit image is decrypted block by block, the PDP
+	// file only when the copy is missing or older
+	QString sImage16 = sImageFolder + IMAGE_16BIT_FILE_NAME;
+	QFileInfo chunkedInfo(FusionSurgery::GetImageChunkedFileName(sCaseDirPath));
+	QFileInfo pdpInfo(sImage16 + ENCRYPTION_FILE_EXTENSION);
+	if (sPassword != "" && chunkedInfo.exists() && (!pdpInfo.exists() || chunkedInfo.lastModified() >= pdpInfo.lastModified()) &&
+		!QFile::exists(sImage16))
+		AddFile(iCase, chunkedInfo.filePath(), QString("image/") + IMAGE_16BIT_FILE_NAME, FILE_CHUNKED);
+	else
+		AddFile(iCase, sImage16, QString("image/") + IMAGE_16BIT_FILE_NAME, FILE_DATA);
+
+	// model.xml is the model, the binary copy and the autosave are left out
+	AddFile(iCase, sCaseDirPath + "/model/" + XML_FILE_NAME_MODEL, QString("model/") + XML_FILE_NAME_MODEL, FILE_XML);
+
+	return true;
+}
+
+bool CaseExporter::Export(QString sArchiveFile, QString sPassword, QStringList* pFailedCases)
+{
+	FUSION_TRACE_SCOPE("ExportAnonymousCases", "case");
+
+	if (m_cases.isEmpty())
+		return false;
+
+	// the decrypted files stay on the drive of the archive, not in the system temp folder
+	QTemporaryDir tempDir(QFileInfo(sArchiveFile).absolutePath() + CASE_EXPORT_TEMP_DIR);
+	if (!tempDir.isValid() || !m_archive.Open(sArchiveFile))
+		return false;
+
+	m_sTempDir = tempDir.path();
+
+	m_sPassword = sPassword;
+	m_iDoneBytes = 0;
+	m_failedCases.clear();
+
+	// the large images go first, the small files fill in the other threads
+	std::sort(m_files.begin(), m_files.end(), [](const ExportFile& a, const ExportFile& b) { return a.iSize > b.iSize; });
+
+	emit progressChanged(0);
+
+	QThreadPool threadPool;
+	for (int i = 0; i < m_files.size(); i++)
+		threadPool.start(new CaseFileExportTask(this, i));
+
+	while (!threadPool.waitForDone(CASE_EXPORT_PROGRESS_INTERVAL))
+		emit progressChanged(GetProgress());
+
+	emit progressChanged(100);
+
+	// a case missing a file is not half exported, its files are left out of the archive
+	int iNumExported = 0;
+	for (int i = 0; i < m_cases.size(); i++)
+	{
+		if (!IsCaseFailed(i))
+		{
+			iNumExported++;
+			continue;
+		}
+
+		m_archive.RemoveEntries(GetCaseFolder(i) + "/");
+		if (pFailedCases)
+			pFailedCases->append(m_cases.at(i).sPath);
+
+		FUSION_DLOG(FUSION_DLOG_WARNING, "case", "export-case-failed", FusionDebugLog::Fields()
+			.Add("case", m_cases.at(i).sPath));
+	}
+
+	bool bClosed = m_archive.Close();
+	if (!bClosed || iNumExported == 0)
+	{
+		QFile::remove(sArchiveFile);
+		return false;
+	}
+
+	return true;
+}
+
+void CaseExporter::AddFile(int iCase, QString sFile, QString sEntryName, int iType)
+{
+	QFileInfo fileInfo(sFile);
+	if (iType != FILE_CHUNKED && !fileInfo.exists())
+		fileInfo.setFile(sFile + ENCRYPTION_FILE_EXTENSION);
+
+	if (!fileInfo.exists())
+		return;
+
+	ExportFile exportFile;
+	exportFile.iCase = iCase;
+	exportFile.sFile = sFile;
+	exportFile.sEntryName = GetCaseFolder(iCase) + "/" + sEntryName;
+	exportFile.iType = iType;
+	exportFile.iSize = fileInfo.size();
+	m_files.append(exportFile);
+
+	m_iTotalBytes += exportFile.iSize;
+}
+
+int CaseExporter::GetProgress()
+{
+	if (m_iTotalBytes <= 0)
+		return 100;
+
+	return (int)qMin((qint64)100, m_iDoneBytes * 100 / m_iTotalBytes);
+}
+
+QString CaseExporter::GetCaseFolder(int iCase)
+{
+	return QString("case%1").arg(iCase + 1, 3, 10, QChar('0'));
+}
+
+void CaseExporter::SetCaseFailed(int iCase)
+{
+	QMutexLocker locker(&m_failedMutex);
+	if (!m_failedCases.contains(iCase))
+		m_failedCases.append(iCase);
+}
+
+bool CaseExporter::IsCaseFailed(int iCase)
+{
+	QMutexLocker locker(&m_failedMutex);
+	return m_failedCases.contains(iCase);
+}
+
+bool CaseExporter::ExportCaseFile(int iFile)
+{
+	const ExportFile& exportFile = m_files.at(iFile);
+
+	// the other files of a failed case are skipped
+	bool bOk = !IsCaseFailed(exportFile.iCase);
+	if (bOk)
+	{
+		// each file gets its own folder, PDP keeps the file name
+		QString sTempFolder = m_sTempDir + QString("/%1").arg(iFile);
+		QString sTempFile = sTempFolder + "/" + QFileInfo(exportFile.sEntryName).fileName();
+		bOk = QDir().mkpath(sTempFolder);
+		if (bOk && (exportFile.iType == FILE_XML || exportFile.iType == FILE_TEXT_XML))
+			bOk = ExportXml(exportFile, sTempFile);
+		else if (bOk)
+			bOk = ExportData(exportFile, sTempFile);
+		QDir(sTempFolder).removeRecursively();
+	}
+
+	m_iDoneBytes += exportFile.iSize;
+
+	if (!bOk)
+	{
+		SetCaseFailed(exportFile.iCase);
+		FUSION_DLOG(FUSION_DLOG_WARNING, "case", "export-file-failed", FusionDebugLog::Fields()
+			.Add("file", exportFile.sFile));
+	}
+
+	return bOk;
+}
+
+bool CaseExporter::ExportXml(const ExportFile& exportFile, QString sTempFile)
+{
+	const ExportCase& exportCase = m_cases.at(exportFile.iCase);
+
+	QByteArray data;
+	if (exportFile.sEntryName == GetCaseFolder(exportFile.iCase) + "/surgery.xml")
+		data = exportCase.surgeryXml; // read and anonymized by AddCase
+	else
+	{
+		QByteArray xml;
+		if (!ReadPdpFile(exportFile.sFile, exportCase.sPassword, sTempFile, xml))
+			return false;
+
+		QStringList identifiers = exportFile.iType == FILE_TEXT_XML ? exportCase.identifiers : QStringList();
+		if (!AnonymizeXml(xml, identifiers, data))
+			return false;
+	}
+
+	// the plain XML is deflated, encrypted it goes through PDP like the images
+	if (m_sPassword == "")
+		return m_archive.AddFile(exportFile.sEntryName, data, true);
+
+	if (!WriteFile(sTempFile, data) || !FusionPdp::Encrypt(sTempFile, m_sPassword))
+		return false;
+
+	return m_archive.AddFile(exportFile.sEntryName + ENCRYPTION_FILE_EXTENSION, sTempFile + ENCRYPTION_FILE_EXTENSION);
+}
+
+bool CaseExporter::ExportData(const ExportFile& exportFile, QString sTempFile)
+{
+	const ExportCase& exportCase = m_cases.at(exportFile.iCase);
+	bool bPlain = exportFile.iType == FILE_DATA && QFile::exists(exportFile.sFile);
+
+	// the images are not anonymized, one already in the archive format is copied as it is
+	if (exportFile.iType == FILE_DATA && !bPlain && m_sPassword != "" && exportCase.sPassword == m_sPassword)
+		return m_archive.AddFile(exportFile.sEntryName + ENCRYPTION_FILE_EXTENSION, exportFile.sFile + ENCRYPTION_FILE_EXTENSION);
+	if (bPlain && m_sPassword == "")
+		return m_archive.AddFile(exportFile.sEntryName, exportFile.sFile);
+
+	// PdpEncrypt2 removes the file it encrypts, a plain image is encrypted from a copy
+	bool bOk = bPlain ? QFile::copy(exportFile.sFile, sTempFile) : DecryptToFile(exportFile, sTempFile);
+	if (!bOk)
+		return false;
+
+	if (m_sPassword == "")
+		return m_archive.AddFile(exportFile.sEntryName, sTempFile);
+
+	if (!FusionPdp::Encrypt(sTempFile, m_sPassword))
+		return false;
+
+	return m_archive.AddFile(exportFile.sEntryName + ENCRYPTION_FILE_EXTENSION, sTempFile + ENCRYPTION_FILE_EXTENSION);
+}
+
+/******************************************************************************/
+/* File functions
+/******************************************************************************/
+
+bool CaseExporter::ReadFile(QString sFile, QByteArray& data)
+{
+	QFile file(sFile);
+	if (!file.open(QIODevice::ReadOnly))
+		return false;
+
+	data = file.readAll();
+	bool bOk = data.size() == file.size();
+	file.close();
+	return bOk;
+}
+
+bool CaseExporter::WriteFile(QString sFile, const QByteArray& data)
+{
+	QFile file(sFile);
+	if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate))
+		return false;
+
+	bool bOk = file.write(data) == data.size();
+	file.close();
+	return bOk;
+}
+
+bool CaseExporter::ReadPdpFile(QString sFile, QString sPassword, QString sTempFile, QByteArray& data)
+{
+	// a plain file is there for unencrypted cases and the files of the open case
+	if (QFile::exists(sFile))
+		return ReadFile(sFile, data);
+
+	// PdpDecrypt2 writes the plain file next to the encrypted one, so a copy is
+	// decrypted in the temporary folder, the case keeps only its encrypted file
+	if (!QFile::copy(sFile + ENCRYPTION_FILE_EXTENSION, sTempFile + ENCRYPTION_FILE_EXTENSION))
+		return false;
+
+	bool bOk = FusionPdp::Decrypt(sTempFile + ENCRYPTION_FILE_EXTENSION, sPassword) && ReadFile(sTempFile, data);
+	QFile::remove(sTempFile + ENCRYPTION_FILE_EXTENSION);
+	FusionPdp::Remove(sTempFile);
+	return bOk;
+}
+
+bool CaseExporter::DecryptToFile(const ExportFile& exportFile, QString sTempFile)
+{
+	const ExportCase& exportCase = m_cases.at(exportFile.iCase);
+
+	if (exportFile.iType == FILE_DATA)
+	{
+		if (!QFile::copy(exportFile.sFile + ENCRYPTION_FILE_EXTENSION, sTempFile + ENCRYPTION_FILE_EXTENSION))
+			return false;
+
+		bool bOk = FusionPdp::Decrypt(sTempFile + ENCRYPTION_FILE_EXTENSION, exportCase.sPassword);
+		QFile::remove(sTempFile + ENCRYPTION_FILE_EXTENSION);
+		return bOk && QFile::exists(sTempFile);
+	}
+
+	// the chunked copy is decrypted block by block, the image is never in memory at once
+	ChunkedCryptoReader reader;
+	QFile file(sTempFile);
+	if (!reader.Open(exportFile.sFile, exportCase.sPassword) || !file.open(QIODevice::WriteOnly | QIODevice::Truncate))
+		return false;
+
+	QByteArray block(CASE_EXPORT_BLOCK_SIZE, Qt::Uninitialized);
+	bool bOk = true;
+	for (qint64 iOffset = 0; bOk && iOffset < reader.GetSize(); iOffset += block.size())
+	{
+		qint64 iSize = qMin((qint64)block.size(), reader.GetSize() - iOffset);
+		bOk = reader.Read(iOffset, block.data(), iSize) && file.write(block.constData(), iSize) == iSize;
+	}
+
+	file.close();
+	return bOk;
+}
+
+/******************************************************************************/
+/* Anonymize functions
+/******************************************************************************/
+
+bool CaseExporter::AnonymizeXml(const QByteArray& data, const QStringList& identifiers, QByteArray& output, QStringList* pFound)
+{
+	output.clear();
+	QBuffer buffer(&output);
+	buffer.open(QIODevice::WriteOnly);
+
+	QXmlStreamReader reader(data);
+	QXmlStreamWriter writer(&buffer);
+
+	QRegularExpression expression = GetIdentifierExpression(identifiers);
+
+	// the text of an identifying element and of all elements in it is replaced,
+	// collected only when no element on the way is a sex, age or nationality
+	QVector<bool> identifyingCollect;
+	while (!reader.atEnd())
+	{
+		QXmlStreamReader::TokenType token = reader.readNext();
+		if (token == QXmlStreamReader::StartDocument)
+			writer.writeStartDocument(reader.documentVersion().toString());
+		else if (token == QXmlStreamReader::EndDocument)
+			writer.writeEndDocument();
+		else if (token == QXmlStreamReader::StartElement)
+		{
+			QXmlStreamAttributes attributes = reader.attributes();
+			QString sName = reader.name().toString();
+			bool bIdentifying = !identifyingCollect.isEmpty() || IsIdentifyingName(sName);
+			bool bCollect = (identifyingCollect.isEmpty() || identifyingCollect.last()) && IsCollectedName(sName);
+
+			// DICOM tags are often written as <tag name="PatientName" value="..."/>
+			QVector<bool> keys(attributes.size(), false);
+			for (int i = 0; i < attributes.size(); i++)
+			{
+				QString sKey = attributes.at(i).value().toString();
+				keys[i] = IsIdentifyingName(sKey);
+				if (keys[i])
+				{
+					bIdentifying = true;
+					bCollect = bCollect && IsCollectedName(sKey);
+				}
+			}
+
+			writer.writeStartElement(reader.qualifiedName().toString());
+			for (int i = 0; i < attributes.size(); i++)
+			{
+				const QXmlStreamAttribute& attribute = attributes.at(i);
+				QString sValue = attribute.value().toString();
+				QString sAttributeName = attribute.name().toString();
+				bool bIdentifyingAttribute = IsIdentifyingName(sAttributeName);
+				if ((bIdentifying && !keys[i]) || bIdentifyingAttribute)
+				{
+					if (pFound && bCollect && (!bIdentifyingAttribute || IsCollectedName(sAttributeName)))
+						pFound->append(sValue);
+					sValue = CASE_EXPORT_ANONYMOUS_VALUE;
+				}
+				else
+					sValue = ReplaceIdentifiers(sValue, expression);
+
+				writer.writeAttribute(attribute.qualifiedName().toString(), sValue);
+			}
+
+			if (bIdentifying)
+				identifyingCollect.append(bCollect);
+		}
+		else if (token == QXmlStreamReader::EndElement)
+		{
+			writer.writeEndElement();
+			if (!identifyingCollect.isEmpty())
+				identifyingCollect.removeLast();
+		}
+		else if (token == QXmlStreamReader::Characters)
+		{
+			QString sText = reader.text().toString();
+			if (reader.isWhitespace())
+				writer.writeCharacters(sText);
+			else if (!identifyingCollect.isEmpty())
+			{
+				if (pFound && identifyingCollect.last())
+					pFound->append(sText);
+				writer.writeCharacters(CASE_EXPORT_ANONYMOUS_VALUE);
+			}
+			else if (reader.isCDATA())
+				writer.writeCDATA(ReplaceIdentifiers(sText, expression));
+			else
+				writer.writeCharacters(ReplaceIdentifiers(sText, expression));
+		}
+		else if (token == QXmlStreamReader::Comment)
+			writer.writeComment(ReplaceIdentifiers(reader.text().toString(), expression));
+		else if (token == QXmlStreamReader::ProcessingInstruction)
+			writer.writeProcessingInstruction(reader.processingInstructionTarget().toString(), reader.processingInstructionData().toString());
+		else if (token == QXmlStreamReader::DTD)
+			writer.writeDTD(reader.text().toString());
+	}
+
+	buffer.close();
+	return !reader.hasError();
+}
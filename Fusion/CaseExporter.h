@@ -0,0 +1,112 @@
+/******************************************************************************
+	CaseExporter.h
+
+	Date      : 18 Oct 2026
+******************************************************************************/
+
+#ifndef CASE_EXPORTER_H
+#define CASE_EXPORTER_H
+
+#include <QObject>
+#include <QString>
+#include <QStringList>
+#include <QByteArray>
+#include <QList>
+#include <QMutex>
+#include <atomic>
+
+#include "ZipArchiveWriter.h"
+
+#define CASE_EXPORT_ANONYMOUS_VALUE "Anonymous"
+
+// Exports cases without the patient and surgeon identity into one zip
+// archive, case001/, case002/, ... Each case folder in the archive is a case
+// that opens as it is: the files are PDP encrypted with the archive password,
+// or plain without one. One task per file over all cores reads the file once,
+// anonymizes it and streams it into the archive. Files that must be decrypted
+// or encrypted again go through a temporary folder next to the archive, or in
+// the case folder while the case is added, so the decrypted data stays on the
+// drive the user picked and is removed when the export ends. The PDP calls are
+// serialized by FusionPdp, and an encrypted image whose case password is the
+// archive password is copied as it is.
+// The XML files are anonymized with QXmlStreamReader: elements and attributes
+// named after the patient, surgeon, clinic or user, and the DICOM patient
+// tags, are replaced by CASE_EXPORT_ANONYMOUS_VALUE. The names, ids and dates
+// found so in surgery.xml are also replaced where they appear as whole words
+// in the other text of surgery.xml and tags.xml; model.xml and
+// image_param.xml hold numbers only and are not searched. The log and the
+// screenshots are not exported.
+class CaseExporter : public QObject
+{
+	Q_OBJECT
+
+public:
+	CaseExporter(QObject* parent = 0);
+	~CaseExporter();
+
+	// reads the identity of the case from its surgery.xml, false if it cannot be read
+	bool AddCase(QString sCaseDirPath, QString sPassword);
+	int GetNumCases() { return m_cases.size(); }
+
+	// a case with a file that fails is left out of the archive and its path
+	// added to pFailedCases. False if the archive cannot be written or no case
+	// is exported, the archive is removed then
+	bool Export(QString sArchiveFile, QString sPassword, QStringList* pFailedCases = NULL);
+
+	static bool AnonymizeXml(const QByteArray& data, const QStringList& identifiers, QByteArray& output, QStringList* pFound = NULL);
+
+protected:
+	enum { FILE_XML, FILE_TEXT_XML, FILE_DATA, FILE_CHUNKED }; // only FILE_TEXT_XML is searched for the identifiers
+
+	struct ExportCase
+	{
+		QString sPath;
+		QString sPassword;
+		QStringList identifiers; // longest first
+		QByteArray surgeryXml;   // anonymized when the case was added
+	};
+
+	struct ExportFile
+	{
+		int iCase;
+		QString sFile; // plain file name, the encrypted one has ENCRYPTION_FILE_EXTENSION
+		QString sEntryName;
+		int iType;
+		qint64 iSize;
+	};
+
+	void AddFile(int iCase, QString sFile, QString sEntryName, int iType);
+	int GetProgress();
+	void SetCaseFailed(int iCase);
+	bool IsCaseFailed(int iCase);
+
+	bool ReadPdpFile(QString sFile, QString sPassword, QString sTempFile, QByteArray& data);
+	bool DecryptToFile(const ExportFile& exportFile, QString sTempFile);
+	static bool ReadFile(QString sFile, QByteArray& data);
+	static bool WriteFile(QString sFile, const QByteArray& data);
+	static QString GetCaseFolder(int iCase);
+
+	// called by the workers
+	bool ExportCaseFile(int iFile);
+	bool ExportXml(const ExportFile& exportFile, QString sTempFile);
+	bool ExportData(const ExportFile& exportFile, QString sTempFile);
+
+	QList<ExportCase> m_cases;
+	QList<ExportFile> m_files;
+	QString m_sPassword;
+	QString m_sTempDir; // next to the archive, the decrypted files while Export runs
+	ZipArchiveWriter m_archive;
+
+	QMutex m_failedMutex;
+	QList<int> m_failedCases;
+
+	qint64 m_iTotalBytes;
+	std::atomic<qint64> m_iDoneBytes;
+
+	friend class CaseFileExportTask;
+
+signals:
+	void progressChanged(int value);
+};
+
+#endif
@@ -0,0 +1,580 @@
+/******************************************************************************
+	ChunkedCrypto.cpp
+
+	Date      : 18 Oct 2026
+******************************************************************************/
+
+#include <QRunnable>
+#include <QThreadPool>
+#include <QtEndian>
+#include <atomic>
+#include <string.h>
+#include <limits.h>
+
+#include <cryptopp/aes.h>
+#include <cryptopp/gcm.h>
+#include <cryptopp/osrng.h>
+#include <cryptopp/pwdbased.h>
+#include <cryptopp/sha.h>
+
+#include "ChunkedCrypto.h"
+#include "FusionTrace.h"
+
+#define CHUNKED_MAGIC "FCK1"
+#define CHUNKED_VERSION 1
+#define CHUNKED_ITERATIONS 100000
+#define CHUNKED_CHECK_BLOCK 0xFFFFFFFFu // nonce index of the password check, never a data block
+
+/******************************************************************************/
+/* Encrypt task
+/******************************************************************************/
+
+class ChunkedEncryptTask : public QRunnable
+{
+public:
+	ChunkedEncryptTask(const ChunkedCrypto::Header& header, const QByteArray& headerData, const unsigned char* pKey,
+		const unsigned char* pPlain, unsigned char* pOutput, quint64 iFirstBlock, quint64 iLastBlock, std::atomic<bool>* pFailed)
+		: m_header(header), m_headerData(headerData)
+	{
+		m_pKey = pKey;
+		m_pPlain = pPlain;
+		m_pOutput = pOutput;
+		m_iFirstBlock = iFirstBlock;
+		m_iLastBlock = iLastBlock;
+		m_pFailed = pFailed;
+	}
+
+	void run()
+	{
+		try
+		{
+			CryptoPP::GCM<CryptoPP::AES>::Encryption encryption;
+			encryption.SetKey(m_pKey, ChunkedCrypto::KEY_SIZE);
+
+			quint64 iBlockSize = m_header.iBlockSize;
+			for (quint64 i = m_iFirstBlock; i < m_iLastBlock; i++)
+			{
+				quint64 iOffset = i * iBlockSize;
+				size_t iLength = (size_t)qMin(iBlockSize, m_header.iPlainSize - iOffset);
+				unsigned char* pBlock = m_pOutput + i * (iBlockSize + ChunkedCrypto::TAG_SIZE);
+
+				unsigned char nonce[12];
+				ChunkedCrypto::GetNonce(m_header, i, nonce);
+				QByteArray aad = ChunkedCrypto::GetAad(m_headerData, i);
+
+				encryption.EncryptAndAuthenticate(pBlock, pBlock + iLength, ChunkedCrypto::TAG_SIZE, nonce, sizeof(nonce),
+					(const unsigned char*)aad.constData(), aad.size(), m_pPlain + iOffset, iLength);
+			}
+		}
+		catch (const CryptoPP::Exception&)
+		{
+			*m_pFailed = true;
+		}
+	}
+
+protected:
+	const ChunkedCrypto::Header& m_header;
+	const QByteArray& m_headerData;
+	const unsigned char* m_pKey;
+	const unsigned char* m_pPlain;
+	unsigned char* m_pOutput;
+	quint64 m_iFirstBlock;
+	quint64 m_iLastBlock;
+	std::atomic<bool>* m_pFailed;
+};
+
+/******************************************************************************/
+/* Rekey task
+/******************************************************************************/
+
+class ChunkedRekeyTask : public QRunnable
+{
+public:
+	ChunkedRekeyTask(const ChunkedCrypto::Header& oldHeader, const QByteArray& oldHeaderData, const unsigned char* pOldKey,
+		const ChunkedCrypto::Header& header, const QByteArray& headerData, const unsigned char* pKey,
+		unsigned char* pBlocks, quint64 iFirstBlock, quint64 iLastBlock, std::atomic<bool>* pFailed, std::atomic<qint64>* pProgress)
+		: m_oldHeader(oldHeader), m_oldHeaderData(oldHeaderData), m_header(header), m_headerData(headerData)
+	{
+		m_pOldKey = pOldKey;
+		m_pKey = pKey;
+		m_pBlocks = pBlocks;
+		m_iFirstBlock = iFirstBlock;
+		m_iLastBlock = iLastBlock;
+		m_pFailed = pFailed;
+		m_pProgress = pProgress;
+	}
+
+	void run()
+	{
+		quint64 iBlockSize = m_header.iBlockSize;
+		QByteArray plain((int)iBlockSize, Qt::Uninitialized);
+		unsigned char* pPlain = (unsigned char*)plain.data();
+
+		try
+		{
+			CryptoPP::GCM<CryptoPP::AES>::Decryption decryption;
+			decryption.SetKey(m_pOldKey, ChunkedCrypto::KEY_SIZE);
+			CryptoPP::GCM<CryptoPP::AES>::Encryption encryption;
+			encryption.SetKey(m_pKey, ChunkedCrypto::KEY_SIZE);
+
+			for (quint64 i = m_iFirstBlock; i < m_iLastBlock && !*m_pFailed; i++)
+			{
+				quint64 iOffset = i * iBlockSize;
+				size_t iLength = (size_t)qMin(iBlockSize, m_header.iPlainSize - iOffset);
+				unsigned char* pBlock = m_pBlocks + i * (iBlockSize + ChunkedCrypto::TAG_SIZE);
+
+				// both files have the same block layout, so the block is replaced where it is
+				unsigned char nonce[12];
+				ChunkedCrypto::GetNonce(m_oldHeader, i, nonce);
+				QByteArray aad = ChunkedCrypto::GetAad(m_oldHeaderData, i);
+				if (!decryption.DecryptAndVerify(pPlain, pBlock + iLength, ChunkedCrypto::TAG_SIZE, nonce, sizeof(nonce),
+					(const unsigned char*)aad.constData(), aad.size(), pBlock, iLength))
+				{
+					*m_pFailed = true;
+					break;
+				}
+
+				ChunkedCrypto::GetNonce(m_header, i, nonce);
+				aad = ChunkedCrypto::GetAad(m_headerData, i);
+				encryption.EncryptAndAuthenticate(pBlock, pBlock + iLength, ChunkedCrypto::TAG_SIZE, nonce, sizeof(nonce),
+					(const unsigned char*)aad.constData(), aad.size(), pPlain, iLength);
+
+				if (m_pProgress)
+					*m_pProgress += iLength;
+			}
+		}
+		catch (const CryptoPP::Exception&)
+		{
+			*m_pFailed = true;
+		}
+
+		plain.fill(0);
+	}
+
+protected:
+	const ChunkedCrypto::Header& m_oldHeader;
+	const QByteArray& m_oldHeaderData;
+	const ChunkedCrypto::Header& m_header;
+	const QByteArray& m_headerData;
+	const unsigned char* m_pOldKey;
+	const unsigned char* m_pKey;
+	unsigned char* m_pBlocks;
+	quint64 m_iFirstBlock;
+	quint64 m_iLastBlock;
+	std::atomic<bool>* m_pFailed;
+	std::atomic<qint64>* m_pProgress;
+};
+
+/******************************************************************************/
+/* Container functions
+/******************************************************************************/
+
+bool ChunkedCrypto::EncryptToFile(const void* pData, qint64 iSize, QString sFile, QString sPassword, int iBlockSize)
+{
+	QByteArray output;
+	if (!Encrypt(pData, iSize, sPassword, output, iBlockSize))
+		return false;
+
+	QFile file(sFile);
+	if (!file.open(QIODevice::WriteOnly))
+		return false;
+
+	bool bSuccess = file.write(output) == output.size();
+	file.close();
+
+	if (!bSuccess)
+		QFile::remove(sFile);
+	return bSuccess;
+}
+
+bool ChunkedCrypto::Encrypt(const void* pData, qint64 iSize, QString sPassword, QByteArray& output, int iBlockSize)
+{
+	if ((!pData && iSize > 0) || iSize < 0 || iBlockSize <= 0 || sPassword.isEmpty())
+		return false;
+
+	FUSION_TRACE_SCOPE("ChunkedEncrypt", "io");
+
+	Header header;
+	QByteArray headerData;
+	unsigned char key[KEY_SIZE];
+	if (!CreateHeader(sPassword, iSize, iBlockSize, header, headerData, key))
+		return false;
+
+	// the whole file is built in memory, the header first and the blocks after it
+	quint64 iNumBlocks = (iSize + iBlockSize - 1) / iBlockSize;
+	qint64 iOutputSize = HEADER_SIZE + iSize + iNumBlocks * TAG_SIZE;
+	if (iOutputSize > INT_MAX || iNumBlocks >= CHUNKED_CHECK_BLOCK)
+		return false;
+
+	output = QByteArray((int)iOutputSize, Qt::Uninitialized);
+	memcpy(output.data(), headerData.constData(), HEADER_SIZE);
+
+	std::atomic<bool> bFailed(false);
+	QThreadPool threadPool;
+	quint64 iNumTasks = qMax(1, threadPool.maxThreadCount());
+	iNumTasks = qMin(iNumTasks, iNumBlocks);
+	for (quint64 i = 0; i < iNumTasks; i++)
+	{
+		quint64 iFirstBlock = iNumBlocks * i / iNumTasks;
+		quint64 iLastBlock = iNumBlocks * (i + 1) / iNumTasks;
+		threadPool.start(new ChunkedEncryptTask(header, headerData, key, (const unsigned char*)pData,
+			(unsigned char*)output.data() + HEADER_SIZE, iFirstBlock, iLastBlock, &bFailed));
+	}
+	threadPool.waitForDone();
+	memset(key, 0, sizeof(key));
+
+	if (bFailed)
+	{
+		output.clear();
+		return false;
+	}
+
+	return true;
+}
+
+bool ChunkedCrypto::Rekey(QString sFile, QString sOldPassword, QString sNewPassword, std::atomic<qint64>* pProgress, QString sOutputFile)
+{
+	if (sNewPassword.isEmpty())
+		return false;
+
+	FUSION_TRACE_SCOPE("ChunkedRekey", "io");
+
+	QFile file(sFile);
+	if (!file.open(QIODevice::ReadOnly))
+		return false;
+
+	Header oldHeader;
+	QByteArray oldHeaderData = file.read(HEADER_SIZE);
+	if (!ReadHeader(oldHeaderData, oldHeader))
+		return false;
+
+	quint64 iNumBlocks = (oldHeader.iPlainSize + oldHeader.iBlockSize - 1) / oldHeader.iBlockSize;
+	qint64 iBlocksSize = oldHeader.iPlainSize + iNumBlocks * TAG_SIZE;
+	if (iNumBlocks >= CHUNKED_CHECK_BLOCK || iBlocksSize > INT_MAX || file.size() != HEADER_SIZE + iBlocksSize)
+		return false;
+
+	// the old password is checked before anything is read or written
+	unsigned char oldKey[KEY_SIZE];
+	if (!DeriveKey(sOldPassword, oldHeader, oldKey) || !CheckKey(oldHeader, oldHeaderData, oldKey))
+	{
+		memset(oldKey, 0, sizeof(oldKey));
+		return false;
+	}
+
+	Header header;
+	QByteArray headerData;
+	unsigned char key[KEY_SIZE];
+	if (!CreateHeader(sNewPassword, oldHeader.iPlainSize, oldHeader.iBlockSize, header, headerData, key))
+	{
+		memset(oldKey, 0, sizeof(oldKey));
+		return false;
+	}
+
+	QByteArray blocks = file.read(iBlocksSize);
+	file.close();
+
+	std::atomic<bool> bFailed(blocks.size() != iBlocksSize);
+	if (!bFailed)
+	{
+		QThreadPool threadPool;
+		quint64 iNumTasks = qMax(1, threadPool.maxThreadCount());
+		iNumTasks = qMin(iNumTasks, iNumBlocks);
+		for (quint64 i = 0; i < iNumTasks; i++)
+		{
+			quint64 iFirstBlock = iNumBlocks * i / iNumTasks;
+			quint64 iLastBlock = iNumBlocks * (i + 1) / iNumTasks;
+			threadPool.start(new ChunkedRekeyTask(oldHeader, oldHeaderData, oldKey, header, headerData, key,
+				(unsigned char*)blocks.data(), iFirstBlock, iLastBlock, &bFailed, pProgress));
+		}
+		threadPool.waitForDone();
+	}
+	memset(oldKey, 0, sizeof(oldKey));
+	memset(key, 0, sizeof(key));
+
+	if (bFailed)
+		return false;
+
+	// written next to the file and renamed, a failed write keeps the old file
+	QString sTempFile = (sOutputFile != "" ? sOutputFile : sFile) + ".tmp";
+	QFile output(sTempFile);
+	if (!output.open(QIODevice::WriteOnly | QIODevice::Truncate))
+		return false;
+
+	bool bSuccess = output.write(headerData) == HEADER_SIZE && output.write(blocks) == blocks.size();
+	output.close();
+
+	if (bSuccess && sOutputFile != "")
+	{
+		QFile::remove(sOutputFile);
+		bSuccess = QFile::rename(sTempFile, sOutputFile);
+	}
+	else if (bSuccess)
+		bSuccess = QFile::remove(sFile) && QFile::rename(sTempFile, sFile);
+	if (!bSuccess)
+		QFile::remove(sTempFile);
+	return bSuccess;
+}
+
+bool ChunkedCrypto::IsChunkedFile(QString sFile)
+{
+	QFile file(sFile);
+	if (!file.open(QIODevice::ReadOnly))
+		return false;
+
+	return file.read(4) == CHUNKED_MAGIC;
+}
+
+QByteArray ChunkedCrypto::WriteHeader(const Header& header)
+{
+	QByteArray data(HEADER_SIZE, 0);
+	unsigned char* p = (unsigned char*)data.data();
+
+	memcpy(p, CHUNKED_MAGIC, 4);
+	qToLittleEndian<quint32>(header.iVersion, p + 4);
+	qToLittleEndian<quint32>(header.iBlockSize, p + 8);
+	qToLittleEndian<quint32>(header.iIterations, p + 12);
+	qToLittleEndian<quint64>(header.iPlainSize, p + 16);
+	memcpy(p + 24, header.salt, 16);
+	memcpy(p + 40, header.noncePrefix, 8);
+	memcpy(p + 48, header.checkTag, 16);
+
+	return data;
+}
+
+bool ChunkedCrypto::ReadHeader(const QByteArray& data, Header& header)
+{
+	if (data.size() != HEADER_SIZE || !data.startsWith(CHUNKED_MAGIC))
+		return false;
+
+	const unsigned char* p = (const unsigned char*)data.constData();
+	header.iVersion = qFromLittleEndian<quint32>(p + 4);
+	header.iBlockSize = qFromLittleEndian<quint32>(p + 8);
+	header.iIterations = qFromLittleEndian<quint32>(p + 12);
+	header.iPlainSize = qFromLittleEndian<quint64>(p + 16);
+	memcpy(header.salt, p + 24, 16);
+	memcpy(header.noncePrefix, p + 40, 8);
+	memcpy(header.checkTag, p + 48, 16);
+
+	return header.iVersion == CHUNKED_VERSION && header.iBlockSize > 0 && header.iIterations > 0;
+}
+
+bool ChunkedCrypto::CreateHeader(QString sPassword, qint64 iSize, int iBlockSize, Header& header, QByteArray& headerData, unsigned char key[KEY_SIZE])
+{
+	header.iVersion = CHUNKED_VERSION;
+	header.iBlockSize = iBlockSize;
+	header.iIterations = CHUNKED_ITERATIONS;
+	header.iPlainSize = iSize;
+
+	CryptoPP::AutoSeededRandomPool rng;
+	rng.GenerateBlock(header.salt, sizeof(header.salt));
+	rng.GenerateBlock(header.noncePrefix, sizeof(header.noncePrefix));
+	memset(header.checkTag, 0, sizeof(header.checkTag));
+
+	if (!DeriveKey(sPassword, header, key))
+		return false;
+
+	// the check tag authenticates an empty message, a wrong password fails in Open() before any block is read
+	headerData = WriteHeader(header);
+	try
+	{
+		CryptoPP::GCM<CryptoPP::AES>::Encryption encryption;
+		encryption.SetKey(key, KEY_SIZE);
+
+		unsigned char nonce[12];
+		GetNonce(header, CHUNKED_CHECK_BLOCK, nonce);
+		QByteArray aad = headerData.left(HEADER_SIZE - TAG_SIZE);
+		encryption.EncryptAndAuthenticate(NULL, header.checkTag, TAG_SIZE, nonce, sizeof(nonce),
+			(const unsigned char*)aad.constData(), aad.size(), NULL, 0);
+	}
+	catch (const CryptoPP::Exception&)
+	{
+		return false;
+	}
+	headerData = WriteHeader(header);
+
+	return true;
+}
+
+bool ChunkedCrypto::CheckKey(const Header& header, const QByteArray& headerData, const unsigned char key[KEY_SIZE])
+{
+	bool bValid = false;
+	try
+	{
+		CryptoPP::GCM<CryptoPP::AES>::Decryption decryption;
+		decryption.SetKey(key, KEY_SIZE);
+
+		unsigned char nonce[12];
+		GetNonce(header, CHUNKED_CHECK_BLOCK, nonce);
+		QByteArray aad = headerData.left(HEADER_SIZE - TAG_SIZE);
+		bValid = decryption.DecryptAndVerify(NULL, header.checkTag, TAG_SIZE, nonce, sizeof(nonce),
+			(const unsigned char*)aad.constData(), aad.size(), NULL, 0);
+	}
+	catch (const CryptoPP::Exception&)
+	{
+		bValid = false;
+	}
+
+	return bValid;
+}
+
+bool ChunkedCrypto::DeriveKey(QString sPassword, const Header& header, unsigned char key[KEY_SIZE])
+{
+	QByteArray password = sPassword.toUtf8();
+
+	try
+	{
+		CryptoPP::PKCS5_PBKDF2_HMAC<CryptoPP::SHA256> pbkdf;
+		pbkdf.DeriveKey(key, KEY_SIZE, 0, (const unsigned char*)password.constData(), password.size(),
+			header.salt, sizeof(header.salt), header.iIterations);
+	}
+	catch (const CryptoPP::Exception&)
+	{
+		return false;
+	}
+
+	return true;
+}
+
+void ChunkedCrypto::GetNonce(const Header& header, quint64 iBlock, unsigned char nonce[12])
+{
+	memcpy(nonce, header.noncePrefix, 8);
+	qToBigEndian<quint32>((quint32)iBlock, nonce + 8);
+}
+
+QByteArray ChunkedCrypto::GetAad(const QByteArray& headerData, quint64 iBlock)
+{
+	QByteArray aad = headerData;
+	aad.resize(HEADER_SIZE + 8);
+	qToLittleEndian<quint64>(iBlock, (unsigned char*)aad.data() + HEADER_SIZE);
+	return aad;
+}
+
+/******************************************************************************/
+/* Reader
+/******************************************************************************/
+
+ChunkedCryptoReader::ChunkedCryptoReader()
+{
+	memset(&m_header, 0, sizeof(m_header));
+	memset(m_key, 0, sizeof(m_key));
+	m_iCachedBlock = -1;
+}
+
+ChunkedCryptoReader::~ChunkedCryptoReader()
+{
+	Close();
+}
+
+bool ChunkedCryptoReader::Open(QString sFile, QString sPassword)
+{
+	Close();
+
+	m_file.setFileName(sFile);
+	if (!m_file.open(QIODevice::ReadOnly))
+		return false;
+
+	m_headerData = m_file.read(ChunkedCrypto::HEADER_SIZE);
+	if (!ChunkedCrypto::ReadHeader(m_headerData, m_header))
+	{
+		Close();
+		return false;
+	}
+
+	// the block count is limited by the 32 bit nonce counter
+	quint64 iNumBlocks = (m_header.iPlainSize + m_header.iBlockSize - 1) / m_header.iBlockSize;
+	qint64 iExpectedSize = ChunkedCrypto::HEADER_SIZE + m_header.iPlainSize + iNumBlocks * ChunkedCrypto::TAG_SIZE;
+	if (iNumBlocks >= CHUNKED_CHECK_BLOCK || m_file.size() != iExpectedSize)
+	{
+		Close();
+		return false;
+	}
+
+	if (!ChunkedCrypto::DeriveKey(sPassword, m_header, m_key) || !ChunkedCrypto::CheckKey(m_header, m_headerData, m_key))
+	{
+		Close();
+		return false;
+	}
+
+	return true;
+}
+
+void ChunkedCryptoReader::Close()
+{
+	if (m_file.isOpen())
+		m_file.close();
+
+	memset(&m_header, 0, sizeof(m_header));
+	memset(m_key, 0, sizeof(m_key));
+	m_headerData.clear();
+
+	m_iCachedBlock = -1;
+	m_cachedBlock.fill(0);
+	m_cachedBlock.clear();
+	m_cipherBuffer.clear();
+}
+
+bool ChunkedCryptoReader::Read(qint64 iOffset, void* pData, qint64 iSize)
+{
+	if (!IsOpen() || iOffset < 0 || iSize < 0 || (quint64)(iOffset + iSize) > m_header.iPlainSize)
+		return false;
+
+	unsigned char* pOutput = (unsigned char*)pData;
+	qint64 iBlockSize = m_header.iBlockSize;
+	while (iSize > 0)
+	{
+		quint64 iBlock = iOffset / iBlockSize;
+		if (!DecryptBlock(iBlock))
+			return false;
+
+		qint64 iBlockOffset = iOffset - iBlock * iBlockSize;
+		qint64 iLength = qMin(iSize, (qint64)m_cachedBlock.size() - iBlockOffset);
+		memcpy(pOutput, m_cachedBlock.constData() + iBlockOffset, iLength);
+
+		pOutput += iLength;
+		iOffset += iLength;
+		iSize -= iLength;
+	}
+
+	return true;
+}
+
+bool ChunkedCryptoReader::DecryptBlock(quint64 iBlock)
+{
+	if ((qint64)iBlock == m_iCachedBlock)
+		return true;
+
+	quint64 iBlockSize = m_header.iBlockSize;
+	size_t iLength = (size_t)qMin(iBlockSize, m_header.iPlainSize - iBlock * iBlockSize);
+
+	m_cipherBuffer.resize((int)iLength + ChunkedCrypto::TAG_SIZE);
+	if (!m_file.seek(ChunkedCrypto::HEADER_SIZE + iBlock * (iBlockSize + ChunkedCrypto::TAG_SIZE)) ||
+		m_file.read(m_cipherBuffer.data(), m_cipherBuffer.size()) != m_cipherBuffer.size())
+		return false;
+
+	m_iCachedBlock = -1;
+	m_cachedBlock.resize((int)iLength);
+
+	unsigned char nonce[12];
+	ChunkedCrypto::GetNonce(m_header, iBlock, nonce);
+	QByteArray aad = ChunkedCrypto::GetAad(m_headerData, iBlock);
+
+	const unsigned char* pCipher = (const unsigned char*)m_cipherBuffer.constData();
+	bool bValid = false;
+	try
+	{
+		CryptoPP::GCM<CryptoPP::AES>::Decryption decryption;
+		decryption.SetKey(m_key, ChunkedCrypto::KEY_SIZE);
+		bValid = decryption.DecryptAndVerify((unsigned char*)m_cachedBlock.data(), pCipher + iLength, ChunkedCrypto::TAG_SIZE,
+			nonce, sizeof(nonce), (const unsigned char*)aad.constData(), aad.size(), pCipher, iLength);
+	}
+	catch (const CryptoPP::Exception&)
+	{
+		bValid = false;
+	}
+
+	if (!bValid)
+		return false;
+
+	m_iCachedBlock = iBlock;
+	return true;
+}
@@ -0,0 +1,100 @@
+/******************************************************************************
+	ChunkedCrypto.h
+
+	Date      : 18 Oct 2026
+******************************************************************************/
+
+#ifndef CHUNKED_CRYPTO_H
+#define CHUNKED_CRYPTO_H
+
+#include <QFile>
+#include <QString>
+#include <QByteArray>
+#include <atomic>
+
+#define CHUNKED_CRYPTO_BLOCK_SIZE (1 << 20) // default plain bytes per block
+
+// Encrypted container made of fixed size blocks, each encrypted and
+// authenticated on its own with AES-256-GCM. Unlike PdpEncrypt2 the data is
+// never written to disk in plain, blocks can be encrypted in parallel and
+// any byte range can be decrypted without reading the blocks before it.
+//
+// Layout, little endian:
+//   header    "FCK1", version, block size, PBKDF2 iterations, plain size,
+//             salt[16], nonce prefix[8], password check tag[16]
+//   block i   ciphertext (block size, the last one shorter), tag[16]
+//
+// The key is derived from the password with PBKDF2-HMAC-SHA256. The nonce
+// of block i is the file nonce prefix and i, the header and i are the
+// additional authenticated data, so blocks cannot be swapped or moved
+// between files.
+class ChunkedCrypto
+{
+public:
+	struct Header
+	{
+		quint32 iVersion;
+		quint32 iBlockSize;
+		quint32 iIterations;
+		quint64 iPlainSize;
+		unsigned char salt[16];
+		unsigned char noncePrefix[8];
+		unsigned char checkTag[16];
+	};
+
+	enum { HEADER_SIZE = 64, TAG_SIZE = 16, KEY_SIZE = 32 };
+
+	// encrypts the buffer into sFile, the blocks are spread over the cores
+	static bool EncryptToFile(const void* pData, qint64 iSize, QString sFile, QString sPassword, int iBlockSize = CHUNKED_CRYPTO_BLOCK_SIZE);
+	static bool Encrypt(const void* pData, qint64 iSize, QString sPassword, QByteArray& output, int iBlockSize = CHUNKED_CRYPTO_BLOCK_SIZE); // the file contents in memory
+	static bool IsChunkedFile(QString sFile);
+
+	// re-encrypts sFile with a new password, each block is decrypted and encrypted
+	// again in place and the blocks are spread over the cores, the plain bytes
+	// done are added to pProgress. With sOutputFile the result is written there
+	// and sFile is left as it is
+	static bool Rekey(QString sFile, QString sOldPassword, QString sNewPassword, std::atomic<qint64>* pProgress = NULL, QString sOutputFile = "");
+
+	// helpers shared with ChunkedCryptoReader
+	static QByteArray WriteHeader(const Header& header);
+	static bool ReadHeader(const QByteArray& data, Header& header);
+	static bool CreateHeader(QString sPassword, qint64 iSize, int iBlockSize, Header& header, QByteArray& headerData, unsigned char key[KEY_SIZE]);
+	static bool CheckKey(const Header& header, const QByteArray& headerData, const unsigned char key[KEY_SIZE]); // false for a wrong password
+	static bool DeriveKey(QString sPassword, const Header& header, unsigned char key[KEY_SIZE]);
+	static void GetNonce(const Header& header, quint64 iBlock, unsigned char nonce[12]);
+	static QByteArray GetAad(const QByteArray& headerData, quint64 iBlock);
+};
+
+// Random access reader, the blocks are decrypted as they are read and the
+// last one is kept for reads in the same block.
+class ChunkedCryptoReader
+{
+public:
+	ChunkedCryptoReader();
+	~ChunkedCryptoReader();
+
+	bool Open(QString sFile, QString sPassword); // false for a wrong password or a damaged header
+	void Close();
+	bool IsOpen() { return m_file.isOpen(); }
+
+	qint64 GetSize() { return m_header.iPlainSize; }
+	int GetBlockSize() { return m_header.iBlockSize; }
+
+	// false if any block in the range fails authentication
+	bool Read(qint64 iOffset, void* pData, qint64 iSize);
+	bool ReadAll(void* pData) { return Read(0, pData, GetSize()); }
+
+protected:
+	bool DecryptBlock(quint64 iBlock);
+
+	QFile m_file;
+	Header m_header;
+	QByteArray m_headerData;
+	unsigned char m_key[ChunkedCrypto::KEY_SIZE];
+
+	qint64 m_iCachedBlock;
+	QByteArray m_cachedBlock;
+	QByteArray m_cipherBuffer;
+};
+
+#endif
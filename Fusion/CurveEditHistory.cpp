@@ -0,0 +1,215 @@
+/******************************************************************************
+	CurveEditHistory.cpp
+
+	Date      : 18 Oct 2026
+******************************************************************************/
+
+#include <algorithm>
+
+#include "CurveEditHistory.h"
+#include "inurbsSubModel.h"
+
+/******************************************************************************/
+/* Constructors and destructors
+/******************************************************************************/
+
+CurveEditHistory::CurveEditHistory()
+{
+	m_bEditing = false;
+}
+
+CurveEditHistory::~CurveEditHistory()
+{
+}
+
+/******************************************************************************/
+/* Edit functions
+/******************************************************************************/
+
+void CurveEditHistory::BeginEdit(inurbsSubModel* pLesion, double z)
+{
+	if (!pLesion)
+		return;
+
+	if (m_bEditing)
+		EndEdit();
+
+	// a new edit ends the redo branch, the arena keeps its capacity
+	m_redo.entries.clear();
+	m_redo.points.clear();
+
+	Push(m_undo, pLesion, z);
+	Trim(m_undo);
+	m_bEditing = true;
+}
+
+bool CurveEditHistory::EndEdit()
+{
+	if (!m_bEditing)
+		return false;
+
+	m_bEditing = false;
+
+	// clicks that only selected a point, or edits that were restored, leave no step
+	const Entry& entry = m_undo.entries.back();
+	if (IsCurveEqual(entry, m_undo.points))
+	{
+		m_undo.points.resize(entry.iOffset);
+		m_undo.entries.pop_back();
+		return false;
+	}
+
+	return true;
+}
+
+int CurveEditHistory::GetEditNumPoints()
+{
+	return m_bEditing ? m_undo.entries.back().iNumPoints : 0;
+}
+
+inurbsPoint* CurveEditHistory::GetEditPoints()
+{
+	if (!m_bEditing || m_undo.entries.back().iNumPoints == 0)
+		return NULL;
+
+	return &m_undo.points[m_undo.entries.back().iOffset];
+}
+
+/******************************************************************************/
+/* Undo functions
+/******************************************************************************/
+
+bool CurveEditHistory::Undo(inurbsSubModel*& pLesion, double& z, inurbsPoint*& pPoints, int& iNumPoints)
+{
+	return !m_bEditing && Pop(m_undo, m_redo, pLesion, z, pPoints, iNumPoints);
+}
+
+bool CurveEditHistory::Redo(inurbsSubModel*& pLesion, double& z, inurbsPoint*& pPoints, int& iNumPoints)
+{
+	return !m_bEditing && Pop(m_redo, m_undo, pLesion, z, pPoints, iNumPoints);
+}
+
+void CurveEditHistory::RemoveLesion(inurbsSubModel* pLesion)
+{
+	// an edit in progress on the lesion has nothing left to end
+	if (m_bEditing && m_undo.entries.back().pLesion == pLesion)
+		m_bEditing = false;
+
+	RemoveEntries(m_undo, pLesion);
+	RemoveEntries(m_redo, pLesion);
+}
+
+void CurveEditHistory::Clear()
+{
+	m_undo.entries.clear();
+	m_undo.points.clear();
+	m_redo.entries.clear();
+	m_redo.points.clear();
+	m_bEditing = false;
+}
+
+/******************************************************************************/
+/* Stack functions
+/******************************************************************************/
+
+void CurveEditHistory::Push(Stack& stack, inurbsSubModel* pLesion, double z)
+{
+	Entry entry;
+	entry.pLesion = pLesion;
+	entry.z = z;
+	entry.iOffset = stack.points.size();
+	entry.iNumPoints = 0;
+
+	inurbsPlanarCurve* pCurve = pLesion->GetCurve(z);
+	if (pCurve)
+	{
+		QList<inurbsPoint*>* pPoints = pCurve->GetPoints();
+		entry.iNumPoints = pPoints->size();
+		for (int i = 0; i < entry.iNumPoints; i++)
+		{
+			const inurbsPoint* pPoint = pPoints->at(i);
+			stack.points.push_back(inurbsPoint(pPoint->x, pPoint->y, pPoint->z));
+		}
+	}
+
+	stack.entries.push_back(entry);
+}
+
+bool CurveEditHistory::Pop(Stack& from, Stack& to, inurbsSubModel*& pLesion, double& z, inurbsPoint*& pPoints, int& iNumPoints)
+{
+	if (from.entries.empty())
+		return false;
+
+	Entry entry = from.entries.back();
+	from.entries.pop_back();
+
+	// the points are copied out before the arena is truncated
+	m_applyPoints.assign(from.points.begin() + entry.iOffset, from.points.begin() + entry.iOffset + entry.iNumPoints);
+	from.points.resize(entry.iOffset);
+
+	// the state being replaced is what the opposite step restores
+	Push(to, entry.pLesion, entry.z);
+	Trim(to);
+
+	pLesion = entry.pLesion;
+	z = entry.z;
+	iNumPoints = entry.iNumPoints;
+	pPoints = iNumPoints > 0 ? &m_applyPoints[0] : NULL;
+	return true;
+}
+
+bool CurveEditHistory::IsCurveEqual(const Entry& entry, const std::vector<inurbsPoint>& points)
+{
+	inurbsPlanarCurve* pCurve = entry.pLesion->GetCurve(entry.z);
+	int iNumPoints = pCurve ? pCurve->GetNumOfPoints() : 0;
+	if (iNumPoints != entry.iNumPoints)
+		return false;
+
+	for (int i = 0; i < iNumPoints; i++)
+	{
+		const inurbsPoint* pPoint = pCurve->GetPoints()->at(i);
+		const inurbsPoint& point = points[entry.iOffset + i];
+		if (pPoint->x != point.x || pPoint->y != point.y || pPoint->z != point.z)
+			return false;
+	}
+
+	return true;
+}
+
+void CurveEditHistory::Trim(Stack& stack)
+{
+	if (stack.entries.size() <= CURVE_EDIT_HISTORY_LEVELS)
+		return;
+
+	// drop the oldest half at once, so the points are only moved every few edits
+	size_t iNumDropped = stack.entries.size() / 2;
+	size_t iPointOffset = stack.entries[iNumDropped].iOffset;
+
+	stack.entries.erase(stack.entries.begin(), stack.entries.begin() + iNumDropped);
+	stack.points.erase(stack.points.begin(), stack.points.begin() + iPointOffset);
+	for (size_t i = 0; i < stack.entries.size(); i++)
+		stack.entries[i].iOffset -= iPointOffset;
+}
+
+void CurveEditHistory::RemoveEntries(Stack& stack, inurbsSubModel* pLesion)
+{
+	// each snapshot holds a whole curve, so the steps of the other lesions still
+	// apply without the removed ones. They are moved down in place, in order.
+	size_t iNumEntries = 0;
+	size_t iNumPoints = 0;
+	for (size_t i = 0; i < stack.entries.size(); i++)
+	{
+		Entry entry = stack.entries[i];
+		if (entry.pLesion == pLesion)
+			continue;
+
+		std::copy(stack.points.begin() + entry.iOffset, stack.points.begin() + entry.iOffset + entry.iNumPoints,
+			stack.points.begin() + iNumPoints);
+		entry.iOffset = iNumPoints;
+		iNumPoints += entry.iNumPoints;
+		stack.entries[iNumEntries++] = entry;
+	}
+
+	stack.entries.resize(iNumEntries);
+	stack.points.resize(iNumPoints);
+}
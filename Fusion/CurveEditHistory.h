@@ -0,0 +1,77 @@
+/******************************************************************************
+	CurveEditHistory.h
+
+	Date      : 18 Oct 2026
+******************************************************************************/
+
+#ifndef CURVE_EDIT_HISTORY_H
+#define CURVE_EDIT_HISTORY_H
+
+#include <vector>
+
+#include "inurbsPlanarCurve.h" // inurbsPoint
+
+class inurbsSubModel;
+
+#define CURVE_EDIT_HISTORY_LEVELS 100 // undo steps kept, the oldest half is dropped when exceeded
+
+// Undo and redo of lesion curve edits. Every edit stores the points of one
+// curve, identified by its lesion and slice position, as they were before
+// the edit. The points of all snapshots are kept back to back in one arena
+// per stack, which is only truncated and appended to, so after the first
+// few edits no memory is allocated per click.
+//
+// A snapshot with no points stands for a curve that did not exist.
+class CurveEditHistory
+{
+public:
+	CurveEditHistory();
+	~CurveEditHistory();
+
+	// bracket of one edit, EndEdit() drops the snapshot if the curve did not change
+	void BeginEdit(inurbsSubModel* pLesion, double z);
+	bool EndEdit();
+	bool IsEditing() { return m_bEditing; }
+
+	// curve before the current edit, for restoring it when the edit is refused
+	int GetEditNumPoints();
+	inurbsPoint* GetEditPoints();
+
+	// the curve state to apply, valid until the next call to this class. The
+	// current state of that curve is moved to the opposite stack.
+	bool CanUndo() { return !m_undo.entries.empty(); }
+	bool CanRedo() { return !m_redo.entries.empty(); }
+	bool Undo(inurbsSubModel*& pLesion, double& z, inurbsPoint*& pPoints, int& iNumPoints);
+	bool Redo(inurbsSubModel*& pLesion, double& z, inurbsPoint*& pPoints, int& iNumPoints);
+
+	void RemoveLesion(inurbsSubModel* pLesion); // the lesion was deleted, the steps of the others stay
+	void Clear(); // all lesions or their curves were deleted
+
+protected:
+	struct Entry
+	{
+		inurbsSubModel* pLesion;
+		double z;
+		size_t iOffset;
+		int iNumPoints;
+	};
+
+	struct Stack
+	{
+		std::vector<Entry> entries;
+		std::vector<inurbsPoint> points;
+	};
+
+	void Push(Stack& stack, inurbsSubModel* pLesion, double z);
+	bool Pop(Stack& from, Stack& to, inurbsSubModel*& pLesion, double& z, inurbsPoint*& pPoints, int& iNumPoints);
+	bool IsCurveEqual(const Entry& entry, const std::vector<inurbsPoint>& points);
+	void Trim(Stack& stack);
+	static void RemoveEntries(Stack& stack, inurbsSubModel* pLesion);
+
+	Stack m_undo;
+	Stack m_redo;
+	std::vector<inurbsPoint> m_applyPoints;
+	bool m_bEditing;
+};
+
+#endif
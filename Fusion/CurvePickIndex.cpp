@@ -0,0 +1,248 @@
+/******************************************************************************
+	CurvePickIndex.cpp
+
+	Date      : 18 Oct 2026
+******************************************************************************/
+
+#include <math.h>
+
+#include "CurvePickIndex.h"
+#include "inurbsPlanarCurve.h"
+
+/******************************************************************************/
+/* Constructors and destructors
+/******************************************************************************/
+
+CurvePickIndex::CurvePickIndex()
+{
+}
+
+CurvePickIndex::~CurvePickIndex()
+{
+	Clear();
+}
+
+/******************************************************************************/
+/* Pick functions
+/******************************************************************************/
+
+int CurvePickIndex::GetPickedPointIndex(inurbsPlanarCurve* pCurve, double x, double y)
+{
+	if (!pCurve || pCurve->GetNumOfPoints() == 0)
+		return -1;
+
+	Grid* pGrid = GetGrid(pCurve, true);
+	int iIndex = FindNearest(pGrid, x, y);
+	if (iIndex < 0)
+		return -1;
+
+	// the point was moved by an edit that was not reported, start over from the curve
+	double px, py;
+	GetCurvePoint(pCurve, iIndex, px, py);
+	if (px != pGrid->points.at(iIndex * 2) || py != pGrid->points.at(iIndex * 2 + 1))
+	{
+		BuildGrid(pGrid, pCurve);
+		iIndex = FindNearest(pGrid, x, y);
+	}
+
+	return iIndex;
+}
+
+int CurvePickIndex::FindNearest(Grid* pGrid, double x, double y)
+{
+	qint64 cx = (qint64)floor(x / CURVE_PICK_TOLERANCE);
+	qint64 cy = (qint64)floor(y / CURVE_PICK_TOLERANCE);
+
+	int iNearest = -1;
+	double fNearestDist2 = CURVE_PICK_TOLERANCE * CURVE_PICK_TOLERANCE;
+	for (qint64 i = cx - 1; i <= cx + 1; i++)
+	{
+		for (qint64 j = cy - 1; j <= cy + 1; j++)
+		{
+			QHash<quint64, QVector<int> >::const_iterator it = pGrid->cells.constFind(((quint64)(quint32)i << 32) | (quint32)j);
+			if (it == pGrid->cells.constEnd())
+				continue;
+
+			const QVector<int>& indices = it.value();
+			for (int k = 0; k < indices.size(); k++)
+			{
+				int iIndex = indices.at(k);
+				double dx = pGrid->points.at(iIndex * 2) - x;
+				double dy = pGrid->points.at(iIndex * 2 + 1) - y;
+				double fDist2 = dx * dx + dy * dy;
+
+				// ties go to the lower index, the first point of the curve wins as before
+				if (fDist2 < fNearestDist2 || (fDist2 == fNearestDist2 && iIndex < iNearest))
+				{
+					fNearestDist2 = fDist2;
+					iNearest = iIndex;
+				}
+			}
+		}
+	}
+
+	return iNearest;
+}
+
+/******************************************************************************/
+/* Update functions
+/******************************************************************************/
+
+void CurvePickIndex::PointAdded(inurbsPlanarCurve* pCurve, int iIndex)
+{
+	Grid* pGrid = GetGrid(pCurve, false);
+	if (!pGrid)
+		return;
+
+	int iNumPoints = pGrid->points.size() / 2;
+	if (iIndex < 0 || iIndex > iNumPoints || pCurve->GetNumOfPoints() != iNumPoints + 1)
+	{
+		Invalidate(pCurve);
+		return;
+	}
+
+	// points inserted between others move the ones after them up
+	if (iIndex < iNumPoints)
+		ShiftIndices(pGrid, iIndex, 1);
+
+	double x, y;
+	GetCurvePoint(pCurve, iIndex, x, y);
+	pGrid->points.insert(iIndex * 2, y);
+	pGrid->points.insert(iIndex * 2, x);
+	pGrid->cells[GetCellKey(x, y)].append(iIndex);
+}
+
+void CurvePickIndex::PointMoved(inurbsPlanarCurve* pCurve, int iIndex)
+{
+	Grid* pGrid = GetGrid(pCurve, false);
+	if (!pGrid)
+		return;
+
+	int iNumPoints = pGrid->points.size() / 2;
+	if (iIndex < 0 || iIndex >= iNumPoints || pCurve->GetNumOfPoints() != iNumPoints)
+	{
+		Invalidate(pCurve);
+		return;
+	}
+
+	double fOldX = pGrid->points.at(iIndex * 2);
+	double fOldY = pGrid->points.at(iIndex * 2 + 1);
+	double x, y;
+	GetCurvePoint(pCurve, iIndex, x, y);
+
+	quint64 iOldKey = GetCellKey(fOldX, fOldY);
+	quint64 iNewKey = GetCellKey(x, y);
+	if (iOldKey != iNewKey)
+	{
+		QVector<int>& oldCell = pGrid->cells[iOldKey];
+		oldCell.removeOne(iIndex);
+		if (oldCell.isEmpty())
+			pGrid->cells.remove(iOldKey);
+		pGrid->cells[iNewKey].append(iIndex);
+	}
+
+	pGrid->points[iIndex * 2] = x;
+	pGrid->points[iIndex * 2 + 1] = y;
+}
+
+void CurvePickIndex::PointRemoved(inurbsPlanarCurve* pCurve, int iIndex)
+{
+	Grid* pGrid = GetGrid(pCurve, false);
+	if (!pGrid)
+		return;
+
+	int iNumPoints = pGrid->points.size() / 2;
+	if (iIndex < 0 || iIndex >= iNumPoints || pCurve->GetNumOfPoints() != iNumPoints - 1)
+	{
+		Invalidate(pCurve);
+		return;
+	}
+
+	quint64 iKey = GetCellKey(pGrid->points.at(iIndex * 2), pGrid->points.at(iIndex * 2 + 1));
+	QVector<int>& cell = pGrid->cells[iKey];
+	cell.removeOne(iIndex);
+	if (cell.isEmpty())
+		pGrid->cells.remove(iKey);
+
+	pGrid->points.remove(iIndex * 2, 2);
+	ShiftIndices(pGrid, iIndex + 1, -1);
+}
+
+void CurvePickIndex::Invalidate(inurbsPlanarCurve* pCurve)
+{
+	delete m_grids.take(pCurve);
+}
+
+void CurvePickIndex::Clear()
+{
+	qDeleteAll(m_grids);
+	m_grids.clear();
+}
+
+/******************************************************************************/
+/* Grid functions
+/******************************************************************************/
+
+CurvePickIndex::Grid* CurvePickIndex::GetGrid(inurbsPlanarCurve* pCurve, bool bCreate)
+{
+	Grid* pGrid = m_grids.value(pCurve);
+	if (!pGrid)
+	{
+		// curves nobody picked from are not indexed, their edits are ignored
+		if (!bCreate)
+			return NULL;
+
+		pGrid = new Grid;
+		m_grids.insert(pCurve, pGrid);
+		BuildGrid(pGrid, pCurve);
+	}
+	else if (bCreate && pGrid->points.size() / 2 != pCurve->GetNumOfPoints())
+		BuildGrid(pGrid, pCurve);
+
+	return pGrid;
+}
+
+void CurvePickIndex::BuildGrid(Grid* pGrid, inurbsPlanarCurve* pCurve)
+{
+	int iNumPoints = pCurve->GetNumOfPoints();
+	pGrid->points.resize(iNumPoints * 2);
+	pGrid->cells.clear();
+
+	for (int i = 0; i < iNumPoints; i++)
+	{
+		double x, y;
+		GetCurvePoint(pCurve, i, x, y);
+		pGrid->points[i * 2] = x;
+		pGrid->points[i * 2 + 1] = y;
+		pGrid->cells[GetCellKey(x, y)].append(i);
+	}
+}
+
+void CurvePickIndex::ShiftIndices(Grid* pGrid, int iFromIndex, int iDelta)
+{
+	// only integers are touched, no distances
+	QHash<quint64, QVector<int> >::iterator it;
+	for (it = pGrid->cells.begin(); it != pGrid->cells.end(); ++it)
+	{
+		QVector<int>& indices = it.value();
+		for (int k = 0; k < indices.size(); k++)
+		{
+			if (indices.at(k) >= iFromIndex)
+				indices[k] += iDelta;
+		}
+	}
+}
+
+quint64 CurvePickIndex::GetCellKey(double x, double y)
+{
+	qint64 cx = (qint64)floor(x / CURVE_PICK_TOLERANCE);
+	qint64 cy = (qint64)floor(y / CURVE_PICK_TOLERANCE);
+	return ((quint64)(quint32)cx << 32) | (quint32)cy;
+}
+
+void CurvePickIndex::GetCurvePoint(inurbsPlanarCurve* pCurve, int iIndex, double& x, double& y)
+{
+	const inurbsPoint* pPoint = pCurve->GetPoints()->at(iIndex);
+	x = pPoint->x;
+	y = pPoint->y;
+}
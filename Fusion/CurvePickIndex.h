@@ -0,0 +1,61 @@
+/******************************************************************************
+	CurvePickIndex.h
+
+	Date      : 18 Oct 2026
+******************************************************************************/
+
+#ifndef CURVE_PICK_INDEX_H
+#define CURVE_PICK_INDEX_H
+
+#include <QHash>
+#include <QVector>
+
+class inurbsPlanarCurve;
+
+#define CURVE_PICK_TOLERANCE 2.0 // mm, a click within this distance of a curve point picks it
+
+// Uniform grid over the points of each planar curve, with cells the size of
+// the pick tolerance, so a pick only looks at the 3x3 cells around the click
+// instead of every point of the curve. Dense RTSTRUCT curves have hundreds
+// of points per slice.
+//
+// The grid of a curve is built on its first pick and then kept in step with
+// the Point*() calls made wherever the points are edited. A grid whose point
+// count no longer matches the curve, or whose picked point has moved, is
+// rebuilt, so edits made elsewhere only cost one rebuild.
+class CurvePickIndex
+{
+public:
+	CurvePickIndex();
+	~CurvePickIndex();
+
+	// index of the nearest point within the tolerance, -1 if none
+	int GetPickedPointIndex(inurbsPlanarCurve* pCurve, double x, double y);
+
+	// incremental updates, the index is the one of the point in the curve after the edit
+	void PointAdded(inurbsPlanarCurve* pCurve, int iIndex);
+	void PointMoved(inurbsPlanarCurve* pCurve, int iIndex);
+	void PointRemoved(inurbsPlanarCurve* pCurve, int iIndex); // index before the removal
+
+	void Invalidate(inurbsPlanarCurve* pCurve); // points replaced or curve deleted
+	void Clear();
+
+protected:
+	struct Grid
+	{
+		QVector<double> points; // x, y
+		QHash<quint64, QVector<int> > cells;
+	};
+
+	Grid* GetGrid(inurbsPlanarCurve* pCurve, bool bCreate);
+	void BuildGrid(Grid* pGrid, inurbsPlanarCurve* pCurve);
+	int FindNearest(Grid* pGrid, double x, double y);
+	void ShiftIndices(Grid* pGrid, int iFromIndex, int iDelta);
+
+	static quint64 GetCellKey(double x, double y);
+	static void GetCurvePoint(inurbsPlanarCurve* pCurve, int iIndex, double& x, double& y);
+
+	QHash<inurbsPlanarCurve*, Grid*> m_grids;
+};
+
+#endif
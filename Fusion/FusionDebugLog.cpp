@@ -0,0 +1,281 @@
+/******************************************************************************
+	FusionDebugLog.cpp
+
+	Date      : 18 Oct 2026
+******************************************************************************/
+
+#include <QDateTime>
+#include <QDir>
+#include <QFile>
+#include <QMutex>
+#include <QMutexLocker>
+#include <QThread>
+#include <QWaitCondition>
+
+#include "FusionDebugLog.h"
+
+#define DEBUG_LOG_FLUSH_INTERVAL	200		// ms
+#define DEBUG_LOG_FLUSH_COUNT		1024	// wake the writer early when this many records are queued
+#define DEBUG_LOG_MAX_QUEUED		65536	// records posted beyond this are dropped and counted
+#define DEBUG_LOG_RETRY_INTERVAL	5000	// ms before the file is opened again after a failure
+
+namespace
+{
+	const char* g_levelNames[] = { "trace", "debug", "info", "warning", "error" };
+
+	struct Record
+	{
+		qint64 iTime;
+		int iLevel;
+		quintptr iThreadId;
+		const char* pChannel;
+		const char* pEvent;
+		QVector<FusionDebugLog::Field> fields;
+	};
+
+	QString EscapeJson(QString sText)
+	{
+		sText.replace("\\", "\\\\");
+		sText.replace("\"", "\\\"");
+		sText.replace("\n", "\\n");
+		sText.replace("\r", "\\r");
+		sText.replace("\t", "\\t");
+		return sText;
+	}
+
+	class DebugLogWriter : public QThread
+	{
+	public:
+		DebugLogWriter()
+		{
+			m_bStop = false;
+			m_iDropped = 0;
+			setObjectName("FusionDebugLog");
+		}
+
+		void Enqueue(Record& record)
+		{
+			QMutexLocker locker(&m_mutex);
+			if (m_queue.size() >= DEBUG_LOG_MAX_QUEUED)
+			{
+				m_iDropped++;
+				return;
+			}
+
+			m_queue.append(record);
+			if (m_queue.size() >= DEBUG_LOG_FLUSH_COUNT)
+				m_condition.wakeOne();
+		}
+
+		void Stop()
+		{
+			{
+				QMutexLocker locker(&m_mutex);
+				m_bStop = true;
+				m_condition.wakeOne();
+			}
+			wait();
+		}
+
+	protected:
+		void run()
+		{
+			QString sFilePath = QString::fromLocal8Bit(qgetenv("FUSION_DEBUG_LOG_FILE"));
+			if (sFilePath.isEmpty())
+				sFilePath = QDir::tempPath() + "/fusion_debug.jsonl";
+
+			// while the file cannot be opened or written the records are dropped
+			// and counted, the file is tried again after DEBUG_LOG_RETRY_INTERVAL
+			QFile file(sFilePath);
+			bool bOpened = false;
+			qint64 iRetryTime = 0;
+			qint64 iDropped = 0;
+
+			bool bStop = false;
+			QVector<Record> records;
+			while (!bStop)
+			{
+				{
+					QMutexLocker locker(&m_mutex);
+					if ((m_queue.isEmpty() || !bOpened) && !m_bStop)
+						m_condition.wait(&m_mutex, DEBUG_LOG_FLUSH_INTERVAL);
+					records.swap(m_queue);
+					iDropped += m_iDropped;
+					m_iDropped = 0;
+					bStop = m_bStop;
+				}
+
+				qint64 iNow = QDateTime::currentMSecsSinceEpoch();
+				if (!bOpened && iNow >= iRetryTime)
+				{
+					bOpened = file.open(QIODevice::WriteOnly | QIODevice::Append | QIODevice::Text);
+					if (!bOpened)
+						iRetryTime = iNow + DEBUG_LOG_RETRY_INTERVAL;
+				}
+
+				if (!bOpened)
+				{
+					iDropped += records.size();
+					records.clear();
+					continue;
+				}
+
+				if (records.isEmpty() && iDropped == 0)
+					continue;
+
+				QByteArray buffer;
+				if (iDropped > 0)
+					buffer += FormatDropped(iDropped);
+				for (int i = 0; i < records.size(); i++)
+					buffer += Format(records.at(i));
+
+				if (file.write(buffer) == buffer.size() && file.flush())
+					iDropped = 0;
+				else
+				{
+					iDropped += records.size();
+					file.close();
+					bOpened = false;
+					iRetryTime = iNow + DEBUG_LOG_RETRY_INTERVAL;
+				}
+				records.clear();
+			}
+
+			// drain whatever came in while stopping
+			QMutexLocker locker(&m_mutex);
+			if (bOpened)
+			{
+				for (int i = 0; i < m_queue.size(); i++)
+					file.write(Format(m_queue.at(i)));
+				file.close();
+			}
+			m_queue.clear();
+		}
+
+		QByteArray FormatDropped(qint64 iDropped)
+		{
+			Record record;
+			record.iTime = QDateTime::currentMSecsSinceEpoch();
+			record.iLevel = FUSION_DLOG_WARNING;
+			record.iThreadId = (quintptr)QThread::currentThreadId();
+			record.pChannel = "debuglog";
+			record.pEvent = "records-dropped";
+			record.fields = FusionDebugLog::Fields().Add("count", (double)iDropped).fields;
+			return Format(record);
+		}
+
+		QByteArray Format(const Record& record)
+		{
+			QString sLine = QString("{\"time\":%1,\"level\":\"%2\",\"thread\":%3,\"channel\":\"%4\",\"event\":\"%5\"")
+				.arg(record.iTime)
+				.arg(g_levelNames[record.iLevel])
+				.arg(record.iThreadId)
+				.arg(record.pChannel)
+				.arg(record.pEvent);
+
+			for (int i = 0; i < record.fields.size(); i++)
+			{
+				const FusionDebugLog::Field& field = record.fields.at(i);
+				sLine += QString(",\"%1\":").arg(field.pKey);
+				if (field.bText)
+					sLine += "\"" + EscapeJson(field.sText) + "\"";
+				else
+					sLine += QString::number(field.fValue, 'g', 10);
+			}
+
+			sLine += "}\n";
+			return sLine.toUtf8();
+		}
+
+		QMutex m_mutex;
+		QWaitCondition m_condition;
+		QVector<Record> m_queue;
+		qint64 m_iDropped; // posted while the queue was full
+		bool m_bStop;
+	};
+
+	QMutex g_writerMutex;
+	DebugLogWriter* g_pWriter = NULL;
+
+	int GetInitialLevel()
+	{
+		bool bOk = false;
+		int iLevel = qEnvironmentVariableIntValue("FUSION_DEBUG_LOG", &bOk);
+		if (!bOk || iLevel < FUSION_DLOG_TRACE || iLevel > FUSION_DLOG_OFF)
+			return FUSION_DLOG_OFF;
+		return iLevel;
+	}
+}
+
+std::atomic<int> FusionDebugLog::m_iLevel(GetInitialLevel());
+
+/******************************************************************************/
+/* Fields
+/******************************************************************************/
+
+FusionDebugLog::Fields& FusionDebugLog::Fields::Add(const char* pKey, double fValue)
+{
+	Field field;
+	field.pKey = pKey;
+	field.fValue = fValue;
+	field.bText = false;
+	fields.append(field);
+	return *this;
+}
+
+FusionDebugLog::Fields& FusionDebugLog::Fields::Add(const char* pKey, QString sText)
+{
+	Field field;
+	field.pKey = pKey;
+	field.fValue = 0.0;
+	field.sText = sText;
+	field.bText = true;
+	fields.append(field);
+	return *this;
+}
+
+/******************************************************************************/
+/* Log functions
+/******************************************************************************/
+
+void FusionDebugLog::SetLevel(int iLevel)
+{
+	if (iLevel < FUSION_DLOG_TRACE)
+		iLevel = FUSION_DLOG_TRACE;
+	if (iLevel > FUSION_DLOG_OFF)
+		iLevel = FUSION_DLOG_OFF;
+	m_iLevel.store(iLevel, std::memory_order_relaxed);
+}
+
+void FusionDebugLog::Post(int iLevel, const char* pChannel, const char* pEvent, const Fields& fields)
+{
+	if (!IsEnabled(iLevel) || iLevel >= FUSION_DLOG_OFF)
+		return;
+
+	Record record;
+	record.iTime = QDateTime::currentMSecsSinceEpoch();
+	record.iLevel = iLevel;
+	record.iThreadId = (quintptr)QThread::currentThreadId();
+	record.pChannel = pChannel;
+	record.pEvent = pEvent;
+	record.fields = fields.fields;
+
+	QMutexLocker locker(&g_writerMutex);
+	if (!g_pWriter)
+	{
+		g_pWriter = new DebugLogWriter;
+		g_pWriter->start(QThread::LowPriority);
+	}
+	g_pWriter->Enqueue(record);
+}
+
+void FusionDebugLog::Shutdown()
+{
+	QMutexLocker locker(&g_writerMutex);
+	if (!g_pWriter)
+		return;
+
+	g_pWriter->Stop();
+	delete g_pWriter;
+	g_pWriter = NULL;
+}
@@ -0,0 +1,82 @@
+/******************************************************************************
+	FusionDebugLog.h
+
+	Date      : 18 Oct 2026
+******************************************************************************/
+
+#ifndef FUSION_DEBUG_LOG_H
+#define FUSION_DEBUG_LOG_H
+
+#include <atomic>
+#include <QString>
+#include <QVector>
+
+// debug log levels, plain macros so they can be used in #if
+#define FUSION_DLOG_TRACE		0
+#define FUSION_DLOG_DEBUG		1
+#define FUSION_DLOG_INFO		2
+#define FUSION_DLOG_WARNING		3
+#define FUSION_DLOG_ERROR		4
+#define FUSION_DLOG_OFF			5
+
+// records below this level are removed by the compiler
+#ifndef FUSION_DEBUG_LOG_MIN_LEVEL
+#ifdef NDEBUG
+#define FUSION_DEBUG_LOG_MIN_LEVEL FUSION_DLOG_INFO
+#else
+#define FUSION_DEBUG_LOG_MIN_LEVEL FUSION_DLOG_TRACE
+#endif
+#endif
+
+// Structured diagnostic channel for developers. Unlike UtlLogger it is not
+// part of the case log, records are name/value data written as JSON lines by
+// a background thread, so the calling thread never waits on the console or
+// the disk.
+//
+// The runtime level is set with SetLevel() or the environment variable
+// FUSION_DEBUG_LOG=<0..5>, output goes to FUSION_DEBUG_LOG_FILE or
+// fusion_debug.jsonl in the temp folder. Default is off.
+class FusionDebugLog
+{
+public:
+	struct Field
+	{
+		const char* pKey;
+		double fValue;
+		QString sText;
+		bool bText;
+	};
+
+	class Fields
+	{
+	public:
+		Fields& Add(const char* pKey, double fValue);
+		Fields& Add(const char* pKey, int iValue) { return Add(pKey, (double)iValue); }
+		Fields& Add(const char* pKey, QString sText);
+		Fields& Add(const char* pKey, const char* pText) { return Add(pKey, QString::fromLatin1(pText)); }
+
+		QVector<Field> fields;
+	};
+
+	static bool IsEnabled(int iLevel) { return iLevel >= m_iLevel.load(std::memory_order_relaxed); }
+	static void SetLevel(int iLevel);
+	static int GetLevel() { return m_iLevel.load(std::memory_order_relaxed); }
+
+	// channel and event must be string literals
+	static void Post(int iLevel, const char* pChannel, const char* pEvent, const Fields& fields);
+
+	// write out everything queued and stop the writer thread
+	static void Shutdown();
+
+protected:
+	static std::atomic<int> m_iLevel;
+};
+
+#define FUSION_DLOG_ENABLED(level) ((level) >= FUSION_DEBUG_LOG_MIN_LEVEL && FusionDebugLog::IsEnabled(level))
+
+// FUSION_DLOG(FUSION_DLOG_DEBUG, "rtstruct", "roi", FusionDebugLog::Fields().Add("index", i));
+// the fields expression is not evaluated unless the level is enabled
+#define FUSION_DLOG(level, channel, event, fields) \
+	do { if (FUSION_DLOG_ENABLED(level)) FusionDebugLog::Post(level, channel, event, fields); } while (0)
+
+#endif
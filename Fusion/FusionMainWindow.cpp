@@ -6,6 +6,13 @@
 
 #include <QApplication>
 #include <QFiledialog>
+#include <QDateTime>
+#include <QDialogButtonBox>
+#include <QLabel>
+#include <QLineEdit>
+#include <QListWidget>
+#include <QPushButton>
+#include <QVBoxLayout>
 #include <itkTextOutput.h>
 #include <vtkResliceImageViewer.h>
 
@@ -1028,8 +1035,15 @@ void FusionMainWindow::on_startOpenCase_clicked()
 
 	QString sCaseFolder = dialog.GetSelectedFolderPath();
 
+	// lesions autosaved after the last save, e.g. before the application crashed
+	bool bRecoverAutosave = false;
+	if (m_pSurgeryController->HasModelAutosave(sCaseFolder))
+		bRecoverAutosave = QMessageBox::question(this, tr("Recover Lesions"),
+			tr("This case has lesion changes that were not saved. Do you want to recover them?"),
+			QMessageBox::Yes | QMessageBox::No) == QMessageBox::Yes;
+
 	// load UroFusion case		
-	if (!m_pSurgeryController->OpenCase(sCaseFolder, sDecryptCasePassword))
+	if (!m_pSurgeryController->OpenCase(sCaseFolder, sDecryptCasePassword, bRecoverAutosave))
 		ShowMessageBox(MSGBOX_INVALID_CASE);
 
 	// show patient details
@@ -2280,11 +2294,17 @@ void FusionMainWindow::UpdateRemarksControl()
 	if (!pSurgery)
 		return;
 
-	UrologyModel* pUrologyModel = pSurgery->GetUrologyModel();
-	if (!pUrologyModel)
+	if (!pSurgery->GetUrologyModel())
 		return;
 
-	ui->lesionRemarks->setPlainText(pUrologyModel->GetRemarks());
+	ui->lesionRemarks->setPlainText(pSurgery->GetLesionRemarks());
+}
+
+void FusionMainWindow::SetImageStackLoading(bool bLoading)
+{
+	ui->sagittalImageContextWidget->setEnabled(!bLoading);
+	ui->coronalImageContextWidget->setEnabled(!bLoading);
+	ui->threeDViewWidget->setEnabled(!bLoading);
 }
 
 bool FusionMainWindow::ChangeActiveLesionCheck() // return true to continue
@@ -2435,7 +2455,21 @@ void FusionMainWindow::on_finishExportCase_clicked()
 void FusionMainWindow::on_finishExportAnonymousCase_clicked()
 {
 	Log("on_finishExportAnonymousCase_clicked");
-	
+
+	// the open case alone, or several cases into one archive
+	QMessageBox box(QMessageBox::Question, tr("Export Anonymous Case"),
+		tr("Export the open case, or select several cases to export into one archive?"), QMessageBox::Cancel, this);
+	QPushButton* pThisCase = box.addButton(tr("This Case"), QMessageBox::AcceptRole);
+	QPushButton* pSeveralCases = box.addButton(tr("Several Cases..."), QMessageBox::ActionRole);
+	box.exec();
+	if (box.clickedButton() == pSeveralCases)
+	{
+		ExportAnonymousCases();
+		return;
+	}
+	if (box.clickedButton() != pThisCase)
+		return;
+
 	QString sPath = GetExportPath();
 	if(sPath.isNull() || sPath == "") return;
 
@@ -2446,6 +2480,91 @@ void FusionMainWindow::on_finishExportAnonymousCase_clicked()
 
 }
 
+void FusionMainWindow::ExportAnonymousCases()
+{
+	Log("ExportAnonymousCases");
+
+	QStringList caseDirPaths;
+	QString sPassword;
+	if (!SelectExportCases(caseDirPaths, sPassword))
+		return;
+
+	QString sPath = GetExportPath();
+	if(sPath.isNull() || sPath == "") return;
+
+	// the cases share the password, it is also the archive password
+	QStringList passwords;
+	for (int i = 0; i < caseDirPaths.size(); i++)
+		passwords.append(sPassword);
+
+	QString sArchiveFile = sPath + "/AnonymousCases_" + QDateTime::currentDateTime().toString("yyyyMMdd_hhmmss") + ".zip";
+	QStringList failedCases;
+	if (!m_pSurgeryController->ExportAnonymousCases(caseDirPaths, passwords, sArchiveFile, sPassword, &failedCases))
+	{
+		ShowMessageBox(MSGBOX_FINISH_EXPORT_ANONYMOUS_CASE_FAILED);
+		return;
+	}
+
+	if (failedCases.isEmpty())
+	{
+		ShowMessageBox(MSGBOX_FINISH_EXPORT_ANONYMOUS_CASE_DONE);
+		return;
+	}
+
+	QStringList caseNames;
+	for (int i = 0; i < failedCases.size(); i++)
+		caseNames.append(QFileInfo(failedCases.at(i)).fileName());
+
+	QMessageBox::warning(this, tr("Export Anonymous Case"),
+		tr("These cases could not be exported, the other cases are in the archive:") + "\n\n" + caseNames.join("\n"));
+}
+
+bool FusionMainWindow::SelectExportCases(QStringList& caseDirPaths, QString& sPassword)
+{
+	// the cases are the folders of the patient data folder with a surgery.xml
+	QDir dataDir(m_pSurgeryController->GetPatientDataFolder());
+	QStringList caseFolders;
+	QStringList folders = dataDir.entryList(QDir::Dirs | QDir::NoDotAndDotDot, QDir::Name);
+	for (int i = 0; i < folders.size(); i++)
+	{
+		QString sSurgeryFile = dataDir.filePath(folders.at(i)) + "/surgery.xml";
+		if (QFile::exists(sSurgeryFile) || QFile::exists(sSurgeryFile + ENCRYPTION_FILE_EXTENSION))
+			caseFolders.append(folders.at(i));
+	}
+
+	QDialog dialog(this);
+	dialog.setWindowFlags(dialog.windowFlags() & ~Qt::WindowContextHelpButtonHint);
+	dialog.setWindowTitle(tr("Export Anonymous Case"));
+
+	QListWidget* pCaseList = new QListWidget(&dialog);
+	pCaseList->setSelectionMode(QAbstractItemView::ExtendedSelection);
+	pCaseList->addItems(caseFolders);
+
+	QLineEdit* pPassword = new QLineEdit(&dialog);
+	pPassword->setEchoMode(QLineEdit::Password);
+	pPassword->setPlaceholderText(tr("Case password, empty for unencrypted cases"));
+
+	QDialogButtonBox* pButtons = new QDialogButtonBox(QDialogButtonBox::Ok | QDialogButtonBox::Cancel, &dialog);
+	connect(pButtons, SIGNAL(accepted()), &dialog, SLOT(accept()));
+	connect(pButtons, SIGNAL(rejected()), &dialog, SLOT(reject()));
+
+	QVBoxLayout* pLayout = new QVBoxLayout(&dialog);
+	pLayout->addWidget(new QLabel(tr("Select the cases to export:"), &dialog));
+	pLayout->addWidget(pCaseList);
+	pLayout->addWidget(pPassword);
+	pLayout->addWidget(pButtons);
+
+	if (dialog.exec() == QDialog::Rejected)
+		return false;
+
+	QList<QListWidgetItem*> items = pCaseList->selectedItems();
+	for (int i = 0; i < items.size(); i++)
+		caseDirPaths.append(dataDir.filePath(items.at(i)->text()));
+	sPassword = pPassword->text();
+
+	return !caseDirPaths.isEmpty();
+}
+
 void FusionMainWindow::PopupApplicationSetting()
 {
 	FusionSettingDialog fsd(this);
@@ -108,10 +108,18 @@ public:
 	void UpdatePiradsControl();
 	void UpdateRemarksControl();
 
+	// the sagittal, coronal and 3D views read the whole image stack, they take
+	// no input while its slices are still being copied in
+	void SetImageStackLoading(bool bLoading);
+
 	void PopupApplicationSetting();
 
 	QStringList SelectFiles(QString &password);
 
+	// export of several cases of the patient data folder into one anonymous archive
+	void ExportAnonymousCases();
+	bool SelectExportCases(QStringList& caseDirPaths, QString& sPassword);
+
 	int m_currentSelectedSeriesId = 0;
 protected:
 	// resize functions
@@ -0,0 +1,32 @@
+/******************************************************************************
+	FusionPdp.cpp
+
+	Date      : 18 Oct 2026
+******************************************************************************/
+
+#include <QMutex>
+
+#include "FusionPdp.h"
+#include "CommonClasses.h"
+#include "Constants.h"
+#include "PDP.h"
+
+static QMutex g_pdpMutex;
+
+bool FusionPdp::Encrypt(QString sFile, QString sPassword)
+{
+	QMutexLocker locker(&g_pdpMutex);
+	return PdpEncrypt2(sFile, sPassword);
+}
+
+bool FusionPdp::Decrypt(QString sEncryptedFile, QString sPassword)
+{
+	QMutexLocker locker(&g_pdpMutex);
+	return PdpDecrypt2(sEncryptedFile, sPassword);
+}
+
+void FusionPdp::Remove(QString sFile)
+{
+	QMutexLocker locker(&g_pdpMutex);
+	PdpRemove(sFile);
+}
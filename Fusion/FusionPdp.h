@@ -0,0 +1,23 @@
+/******************************************************************************
+	FusionPdp.h
+
+	Date      : 18 Oct 2026
+******************************************************************************/
+
+#ifndef FUSION_PDP_H
+#define FUSION_PDP_H
+
+#include <QString>
+
+// PdpEncrypt2, PdpDecrypt2 and PdpRemove for worker threads. The PDP library
+// makes no thread safety promise, so the calls are made one at a time under
+// one lock. The main thread calls the library directly while no case job runs.
+class FusionPdp
+{
+public:
+	static bool Encrypt(QString sFile, QString sPassword); // writes sFile.enc and removes sFile
+	static bool Decrypt(QString sEncryptedFile, QString sPassword); // writes the file without the extension
+	static void Remove(QString sFile);
+};
+
+#endif
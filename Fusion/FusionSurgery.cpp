@@ -8,7 +8,11 @@
 
 #include <QFileinfo>
 #include <QDir>
+#include <QSet>
+#include <QDateTime>
+#include <QRunnable>
 #include <QMath.h>
+#include <vector>
 #include <gdcmAttribute.h>
 
 #include "FusionSurgery.h"
@@ -17,10 +21,49 @@
 #include "inurbsPlanarCurve.h"
 #include "inurbsPlanarCurveStack.h"
 #include "CommonClasses.h"
+#include "UtlMetaRecord.h"
+#include "FusionTrace.h"
+#include "FusionDebugLog.h"
+#include "ChunkedCrypto.h"
+#include "ModelBinaryFile.h"
+#include "ModelAutosave.h"
+#include "LesionSurfaceBuilder.h"
 #include "Crypto.h"
 #include "Constants.h"
+#include "PDP.h"
 
+#define IMAGE_MAP_FILE_NAME "image_map.xml"	// layout of the 16 bit image file for mapped loading
+#define IMAGE_CHUNKED_FILE_NAME "image16.fck"	// 16 bit image in chunked encryption, one block per slice
+#define XML_FILE_VERSION_IMAGE_MAP 2
 
+// keys of the image map info in the order they are written
+static const char* g_pImageMapKeys[] = { "file-version", "width", "height", "slices", "pixel-size", "spacing-x", "spacing-y", "spacing-z",
+	"origin-x", "origin-y", "origin-z", "window-center-dicom", "window-width-dicom", "window-center-user", "window-width-user",
+	"data-size", "data-modified", "data-file" };
+#define IMAGE_MAP_NUM_KEYS (int)(sizeof(g_pImageMapKeys) / sizeof(g_pImageMapKeys[0]))
+
+/******************************************************************************/
+/* Mapped slice copy task
+/******************************************************************************/
+
+class MappedSliceCopyTask : public QRunnable
+{
+public:
+	MappedSliceCopyTask(FusionSurgery* pSurgery, int iFirstSlice)
+	{
+		m_pSurgery = pSurgery;
+		m_iFirstSlice = iFirstSlice;
+	}
+
+	void run()
+	{
+		m_pSurgery->CopyMappedSlices(m_iFirstSlice);
+	}
+
+protected:
+	FusionSurgery* m_pSurgery;
+	int m_iFirstSlice;
+};
 
 /******************************************************************************/
 /* Constructos and Destructors                                                                           
@@ -35,6 +78,12 @@ FusionSurgery::FusionSurgery()
 	//m_iDicomWindowCenter = 0;
 	//m_iDicomWindowWidth = 0;
 	m_pRTStruct = NULL;
+	m_pLesionRemarksModel = NULL;
+
+	m_pMappedPixels = NULL;
+	m_bImageStackLoading = false;
+	m_bCancelImageLoad = false;
+	m_imageLoadPool.setMaxThreadCount(1);
 
 	//for (int i=0;i<6;i++)
 	//	m_fDirCosines[i] = 0.0;
@@ -42,6 +91,7 @@ FusionSurgery::FusionSurgery()
 
 FusionSurgery::~FusionSurgery()
 {
+	CancelImageLoad();
 
 
 	if (m_pRTStruct)
@@ -54,6 +104,17 @@ FusionSurgery::~FusionSurgery()
 
 bool FusionSurgery::LoadImageStack(QString sCasePath, QString sPassword)
 {
+	FUSION_TRACE_SCOPE("LoadImageStack", "case");
+
+	CancelImageLoad(); // the image stack is replaced
+
+	// legacy encrypted image files have to be decrypted as a whole by the base class
+	if (LoadMappedImageStack(sCasePath, sPassword))
+	{
+		m_pImageStack->SetModality(ImageStack::MODALITY_MRI);
+		return true;
+	}
+
 	if(BaseSurgery::LoadImageStack(sCasePath, sPassword))
 	{
 		m_pImageStack->SetModality(ImageStack::MODALITY_MRI);
@@ -63,18 +124,343 @@ bool FusionSurgery::LoadImageStack(QString sCasePath, QString sPassword)
 	return false;
 }
 
-bool FusionSurgery::LoadModel(QString sCasePath, QString sPassword)
+bool FusionSurgery::LoadMappedImageStack(QString sCasePath, QString sPassword)
 {
-	if (!m_pUrologyModel)
+	QString sImageFolder = sCasePath + "/image";
+
+	UtlMetaRecordReader reader;
+	reader.read(sImageFolder + "/" + IMAGE_MAP_FILE_NAME);
+
+	const UtlMetaRecordItem* pItemRoot = reader.getResult();
+	if (!pItemRoot)
+		return false;
+
+	QString values[IMAGE_MAP_NUM_KEYS];
+	for (int i = 0; i < IMAGE_MAP_NUM_KEYS; i++)
+	{
+		UtlMetaRecordItem* pItem = pItemRoot->getChildItem(g_pImageMapKeys[i]);
+		if (!pItem)
+			return false;
+		values[i] = pItem->getValue();
+	}
+
+	if (values[0].toInt() != XML_FILE_VERSION_IMAGE_MAP)
+		return false;
+
+	int size[3] = { values[1].toInt(), values[2].toInt(), values[3].toInt() };
+	int iPixelSize = values[4].toInt();
+	double spacing[3] = { values[5].toDouble(), values[6].toDouble(), values[7].toDouble() };
+	double origin[3] = { values[8].toDouble(), values[9].toDouble(), values[10].toDouble() };
+	qint64 iSliceSize = (qint64)size[0] * size[1] * iPixelSize;
+	qint64 iDataSize = iSliceSize * size[2];
+	if (iSliceSize <= 0 || size[2] <= 0 || iDataSize != values[15].toLongLong())
+		return false;
+
+	// encrypted cases read the chunked copy, plain cases map the 16 bit file
+	bool bEncrypted = !sPassword.isEmpty();
+	if (values[17] != (bEncrypted ? IMAGE_CHUNKED_FILE_NAME : IMAGE_16BIT_FILE_NAME))
+		return false;
+
+	// the image file must still be the one the info was written for
+	QString sFileDat = sImageFolder + "/" + values[17];
+	QFileInfo fileInfo(sFileDat);
+	if (!fileInfo.exists() || fileInfo.lastModified().toMSecsSinceEpoch() != values[16].toLongLong())
+		return false;
+
+	if (bEncrypted)
+	{
+		// a wrong password fails here, before the image stack is touched
+		if (!m_chunkedImageReader.Open(sFileDat, sPassword) || m_chunkedImageReader.GetSize() != iDataSize)
+		{
+			m_chunkedImageReader.Close();
+			return false;
+		}
+	}
+	else
+	{
+		if (fileInfo.size() != iDataSize)
+			return false;
+
+		m_mappedImageFile.setFileName(sFileDat);
+		if (!m_mappedImageFile.open(QIODevice::ReadOnly))
+			return false;
+
+		m_pMappedPixels = m_mappedImageFile.map(0, iDataSize);
+	}
+
+	if ((!bEncrypted && !m_pMappedPixels) || !CreateImageStack(size, origin, spacing, iPixelSize))
+	{
+		CloseImageSource();
+		return false;
+	}
+
+	m_pImageStack->SetWindowCenterWidthDicom(values[11].toInt(), values[12].toInt());
+	m_pImageStack->SetWindowCenterWidthUser(values[13].toInt(), values[14].toInt());
+
+	// the transversal views open at the middle slice, it is copied before returning
+	int iFirstSlice = size[2] / 2;
+	m_copiedSlices.fill(false, size[2]);
+	if (!CopySourceSlice(iFirstSlice, iSliceSize))
+	{
+		CloseImageSource();
+		return false;
+	}
+	m_copiedSlices[iFirstSlice] = true;
+
+	FUSION_DLOG(FUSION_DLOG_INFO, "image", "mapped-load", FusionDebugLog::Fields()
+		.Add("bytes", (double)iDataSize).Add("slices", size[2]).Add("first-slice", iFirstSlice).Add("encrypted", (int)bEncrypted));
+
+	m_bCancelImageLoad = false;
+	m_bImageStackLoading = true;
+	m_imageLoadPool.start(new MappedSliceCopyTask(this, iFirstSlice));
+	return true;
+}
+
+void FusionSurgery::CopyMappedSlices(int iFirstSlice)
+{
+	FUSION_TRACE_SCOPE("CopyMappedSlices", "case");
+
+	int* dim = m_pImageStack->GetDimension();
+	qint64 iSliceSize = (qint64)dim[0] * dim[1] * m_pImageStack->GetPixelSize();
+	bool bValid = true;
+
+	// outwards from the first slice, the neighbours are the next ones to be viewed,
+	// slices the views asked for in the meantime are already in
+	for (int d = 1; d < dim[2] && bValid && !m_bCancelImageLoad; d++)
+	{
+		int iSlices[2] = { iFirstSlice + d, iFirstSlice - d };
+		for (int i = 0; i < 2 && bValid; i++)
+		{
+			if (iSlices[i] < 0 || iSlices[i] >= dim[2])
+				continue;
+
+			QMutexLocker locker(&m_imageSliceMutex);
+			if (!m_copiedSlices[iSlices[i]])
+			{
+				bValid = CopySourceSlice(iSlices[i], iSliceSize);
+				m_copiedSlices[iSlices[i]] = bValid;
+			}
+		}
+	}
+
+	if (!bValid)
+		FUSION_DLOG(FUSION_DLOG_ERROR, "image", "slice-copy-failed", FusionDebugLog::Fields().Add("slices", dim[2]));
+
+	// the file is not kept open, so the case can be saved or encrypted
+	m_imageSliceMutex.lock();
+	CloseImageSource();
+	m_imageSliceMutex.unlock();
+
+	bool bCancelled = m_bCancelImageLoad;
+	m_bImageStackLoading = false;
+	if (!bCancelled)
+		emit imageStackLoaded();
+}
+
+bool FusionSurgery::CopySourceSlice(int iSlice, qint64 iSliceSize)
+{
+	unsigned char* pDst = m_pImageStack->GetPixelsPtr() + iSlice * iSliceSize;
+
+	// one block per slice, so each slice is decrypted and authenticated on its own
+	if (m_chunkedImageReader.IsOpen())
+		return m_chunkedImageReader.Read(iSlice * iSliceSize, pDst, iSliceSize);
+
+	if (!m_pMappedPixels)
+		return false;
+
+	memcpy(pDst, m_pMappedPixels + iSlice * iSliceSize, iSliceSize);
+	return true;
+}
+
+void FusionSurgery::CloseImageSource()
+{
+	if (m_pMappedPixels)
+		m_mappedImageFile.unmap(m_pMappedPixels);
+	m_pMappedPixels = NULL;
+	if (m_mappedImageFile.isOpen())
+		m_mappedImageFile.close();
+
+	m_chunkedImageReader.Close();
+}
+
+void FusionSurgery::WaitForImageStack()
+{
+	m_imageLoadPool.waitForDone();
+}
+
+void FusionSurgery::CancelImageLoad()
+{
+	m_bCancelImageLoad = true;
+	m_imageLoadPool.waitForDone();
+}
+
+void FusionSurgery::LoadImageSlice(double z)
+{
+	if (!m_bImageStackLoading || !m_pImageStack)
+		return;
+
+	int* dim = m_pImageStack->GetDimension();
+	int iSlice = qRound((z - m_pImageStack->GetOrigin()[2]) / m_pImageStack->GetSpacing()[2]);
+	if (iSlice < 0 || iSlice >= dim[2])
+		return;
+
+	// the source is closed once the worker is done, then all slices are in
+	QMutexLocker locker(&m_imageSliceMutex);
+	if (m_copiedSlices[iSlice] || (!m_pMappedPixels && !m_chunkedImageReader.IsOpen()))
+		return;
+
+	qint64 iSliceSize = (qint64)dim[0] * dim[1] * m_pImageStack->GetPixelSize();
+	m_copiedSlices[iSlice] = CopySourceSlice(iSlice, iSliceSize);
+}
+
+void FusionSurgery::DeleteImageStack()
+{
+	// the worker would keep copying into the freed pixels
+	CancelImageLoad();
+	BaseSurgery::DeleteImageStack();
+}
+
+bool FusionSurgery::SaveImageStack(bool bUpdate, QString sPassword)
+{
+	WaitForImageStack();
+	return BaseSurgery::SaveImageStack(bUpdate, sPassword);
+}
+
+QString FusionSurgery::GetImageChunkedFileName(QString sCasePath)
+{
+	return sCasePath + "/image/" + IMAGE_CHUNKED_FILE_NAME;
+}
+
+bool FusionSurgery::UpdateImageMapInfo(QString sCasePath)
+{
+	QString sImageFolder = sCasePath + "/image";
+	QString sFileMap = sImageFolder + "/" + IMAGE_MAP_FILE_NAME;
+
+	UtlMetaRecordReader reader;
+	reader.read(sFileMap);
+
+	const UtlMetaRecordItem* pItemRoot = reader.getResult();
+	if (!pItemRoot)
+		return false;
+
+	UtlMetaRecordItem* pDataFile = pItemRoot->getChildItem("data-file");
+	if (!pDataFile)
 		return false;
 
-	if (!m_pUrologyModel->ReadModel(sCasePath, sPassword, XML_FILE_NAME_MODEL))
+	QFileInfo fileInfo(sImageFolder + "/" + pDataFile->getValue());
+	if (!fileInfo.exists())
+		return false;
+
+	// only the modification time changes, the pixels are the same
+	UtlMetaRecord root("image-map");
+	for (int i = 0; i < IMAGE_MAP_NUM_KEYS; i++)
 	{
-		delete m_pUrologyModel;
-		m_pUrologyModel = NULL;
+		UtlMetaRecordItem* pItem = pItemRoot->getChildItem(g_pImageMapKeys[i]);
+		if (!pItem)
+			return false;
+
+		if (QString(g_pImageMapKeys[i]) == "data-modified")
+			root.createChildItem(g_pImageMapKeys[i], QString::number(fileInfo.lastModified().toMSecsSinceEpoch()));
+		else
+			root.createChildItem(g_pImageMapKeys[i], pItem->getValue());
+	}
+
+	UtlMetaRecordWriter writer;
+	return writer.write(sFileMap, &root);
+}
+
+bool FusionSurgery::WriteImageMapInfo()
+{
+	QString sImageFolder = m_sCasePath + "/image";
+	QString sFileMap = sImageFolder + "/" + IMAGE_MAP_FILE_NAME;
+	QString sFileChunked = sImageFolder + "/" + IMAGE_CHUNKED_FILE_NAME;
+
+	int* dim = m_pImageStack->GetDimension();
+	qint64 iSliceSize = (qint64)dim[0] * dim[1] * m_pImageStack->GetPixelSize();
+	qint64 iDataSize = iSliceSize * dim[2];
+
+	// encrypted cases get a chunked copy of the pixels, the plain data never reaches the disk
+	bool bEncrypted = !m_sEncryptCasePassword.isEmpty();
+	QString sDataFile = bEncrypted ? IMAGE_CHUNKED_FILE_NAME : IMAGE_16BIT_FILE_NAME;
+	bool bDataValid = false;
+	if (bEncrypted)
+		bDataValid = ChunkedCrypto::EncryptToFile(m_pImageStack->GetPixelsPtr(), iDataSize, sFileChunked, m_sEncryptCasePassword, (int)iSliceSize);
+	else
+	{
+		QFile::remove(sFileChunked);
+		bDataValid = QFileInfo(sImageFolder + "/" + IMAGE_16BIT_FILE_NAME).size() == iDataSize;
+	}
+
+	QFileInfo fileInfo(sImageFolder + "/" + sDataFile);
+	if (!bDataValid || !fileInfo.exists())
+	{
+		QFile::remove(sFileMap);
+		QFile::remove(sFileChunked);
+		return false;
+	}
+
+	double* spacing = m_pImageStack->GetSpacing();
+	double* origin = m_pImageStack->GetOrigin();
+	int iCenterDicom, iWidthDicom, iCenterUser, iWidthUser;
+	m_pImageStack->GetWindowCenterWidthDicom(iCenterDicom, iWidthDicom);
+	m_pImageStack->GetWindowCenterWidthUser(iCenterUser, iWidthUser);
+
+	UtlMetaRecord root("image-map");
+	root.createChildItem("file-version", XML_FILE_VERSION_IMAGE_MAP);
+	root.createChildItem("width", dim[0]);
+	root.createChildItem("height", dim[1]);
+	root.createChildItem("slices", dim[2]);
+	root.createChildItem("pixel-size", m_pImageStack->GetPixelSize());
+	root.createChildItem("spacing-x", QString::number(spacing[0], 'g', 17));
+	root.createChildItem("spacing-y", QString::number(spacing[1], 'g', 17));
+	root.createChildItem("spacing-z", QString::number(spacing[2], 'g', 17));
+	root.createChildItem("origin-x", QString::number(origin[0], 'g', 17));
+	root.createChildItem("origin-y", QString::number(origin[1], 'g', 17));
+	root.createChildItem("origin-z", QString::number(origin[2], 'g', 17));
+	root.createChildItem("window-center-dicom", iCenterDicom);
+	root.createChildItem("window-width-dicom", iWidthDicom);
+	root.createChildItem("window-center-user", iCenterUser);
+	root.createChildItem("window-width-user", iWidthUser);
+	root.createChildItem("data-size", QString::number(iDataSize));
+	root.createChildItem("data-modified", QString::number(fileInfo.lastModified().toMSecsSinceEpoch()));
+	root.createChildItem("data-file", sDataFile);
+
+	UtlMetaRecordWriter writer;
+	return writer.write(sFileMap, &root);
+}
+
+bool FusionSurgery::LoadModel(QString sCasePath, QString sPassword, bool bRecoverAutosave)
+{
+	FUSION_TRACE_SCOPE("LoadModel", "case");
+
+	if (!m_pUrologyModel)
 		return false;
+
+	// the binary copy is used while model.xml is the file written with it, the
+	// meta record DOM only for files the stream does not map
+	bool bRead = bRecoverAutosave && ReadModelAutosave(sCasePath, sPassword);
+	if (!bRead)
+		bRead = ReadModelXml(sCasePath, sPassword);
+	if (!bRead)
+	{
+		if (!m_pUrologyModel->ReadModel(sCasePath, sPassword, XML_FILE_NAME_MODEL))
+		{
+			delete m_pUrologyModel;
+			m_pUrologyModel = NULL;
+			return false;
+		}
+		m_sLesionRemarks = m_pUrologyModel->GetRemarks();
+		m_pLesionRemarksModel = m_pUrologyModel;
 	}
-	m_pUrologyModel->BuildAllSurfaces();
+	{
+		FUSION_TRACE_SCOPE("BuildAllSurfaces", "model");
+		QMutexLocker locker(LesionSurfaceBuilder::GetBuildMutex());
+		m_pUrologyModel->BuildAllSurfaces();
+	}
+
+	InvalidateLesionSurface();
+	for (int i = 0; i < m_pUrologyModel->GetNumLesionSubModels(); i++)
+		SetLesionSurfaceBuilt(m_pUrologyModel->GetLesionModel(i));
 
 	return true;
 }
@@ -86,6 +472,10 @@ bool FusionSurgery::LoadModel(QString sCasePath, QString sPassword)
 
 bool FusionSurgery::ImportDICOMImages(QStringList& files, int nDicomFlip,int nDicomWindowCenter, int nDicomWindowWidth, QString sPassword)
 {
+	FUSION_TRACE_SCOPE("ImportDICOMImages", "import");
+
+	CancelImageLoad(); // the image stack is replaced
+
 	ReaderType::Pointer reader;
 	ImageIOType::Pointer dicomIO;
 	ImageType::Pointer image;
@@ -262,9 +652,13 @@ bool FusionSurgery::ImportDICOMImages(QVector<QStringList>& vecSeriesFileList, i
 
 void FusionSurgery::FlipImageStack(int iFlip)
 {
+	FUSION_TRACE_SCOPE("FlipImageStack", "import");
+
 	if (!m_pImageStack)
 		return;
 
+	WaitForImageStack();
+
 	unsigned char* pImage = m_pImageStack->GetPixelsPtr();
 	int* size = m_pImageStack->GetDimension();
 	int iPixelSize = m_pImageStack->GetPixelSize();
@@ -356,6 +750,64 @@ void FusionSurgery::ResetToDicomFlip()
 	m_iCurrentFlip = FLIP_NONE;
 }
 
+bool FusionSurgery::SaveImageStack8Bit(QString sPassword)
+{
+	if(!m_pImageStack || m_pImageStack->GetPixelSize() != 2) return false;
+
+	WaitForImageStack();
+	m_pImageStack->WriteImage(m_sCasePath, true, m_sEncryptCasePassword);
+	WriteImageMapInfo();
+
+	int iPixelSize = m_pImageStack->GetPixelSize();
+	int *dim = m_pImageStack->GetDimension();
+	int iImageSize = dim[0]*dim[1]*dim[2];
+	unsigned char *pPixels = m_pImageStack->GetPixelsPtr();
+
+	int iWindowCenter, iWindowWidth;
+	m_pImageStack->GetWindowCenterWidthUser(iWindowCenter, iWindowWidth);
+	if(iWindowCenter == 0 && iWindowWidth == 0)
+		m_pImageStack->GetWindowCenterWidthDicom(iWindowCenter, iWindowWidth);
+
+	ImageType::SizeType size;
+	size[0] = dim[0];
+	size[1] = dim[1];
+	size[2] = dim[2];
+
+	ImageType::RegionType region;
+	region.SetSize(size);
+
+	ImageType::Pointer image = ImageType::New();
+	image->SetRegions(region);
+	image->Allocate();
+	memcpy(image->GetBufferPointer(), pPixels, iImageSize*iPixelSize);
+
+	WindowingFilterType::Pointer filter = WindowingFilterType::New();
+	filter->SetInput(image);
+
+	filter->SetWindowLevel(iWindowWidth, iWindowCenter);
+	filter->SetOutputMinimum(0);
+	filter->SetOutputMaximum(255);
+	filter->Update();
+
+	QString sImageFolder = m_sCasePath + "/image";
+	QString sFileDat = sImageFolder + "/" + IMAGE_FILE_NAME;
+	FILE *fp = fopen(sFileDat.toLatin1().data(), "wb");
+	if(!fp) return false;
+
+	bool bWriteOk = false;
+	if(fwrite(filter->GetOutput()->GetBufferPointer(), 1, iImageSize, fp) == iImageSize)
+		bWriteOk = true;
+
+	fclose(fp);
+
+#ifdef PDP_DATA
+	if (!PdpEncrypt2(sFileDat, sPassword))
+		return false;
+#endif
+
+	return bWriteOk;
+}
+
 /******************************************************************************/
 /* Model functions                                                                           
 /******************************************************************************/
@@ -368,6 +820,375 @@ void FusionSurgery::InitModelLimitPositions()
 	m_pUrologyModel->InitLimitPositions();
 }
 
+void FusionSurgery::SaveModel()
+{
+	if (!m_pUrologyModel)
+		return;
+
+	// model.xml is kept current for the tools, the binary copy is tied to it by its hash
+	QByteArray xmlHash;
+	if (!WriteModelXml(m_sEncryptCasePassword, &xmlHash))
+	{
+		BaseSurgery::SaveModel();
+		return;
+	}
+
+	WriteModelBinary(m_sEncryptCasePassword, xmlHash);
+}
+
+QString FusionSurgery::GetLesionRemarks()
+{
+	if (!m_pUrologyModel)
+		return "";
+
+	// remarks saved by the stream are not known to the model
+	if (m_pLesionRemarksModel == m_pUrologyModel)
+		return m_sLesionRemarks;
+	return m_pUrologyModel->GetRemarks();
+}
+
+bool FusionSurgery::ReadModelXml(QString sCasePath, QString sPassword)
+{
+	FUSION_TRACE_SCOPE("ReadModelXml", "case");
+
+	QString sFile = sCasePath + "/model/" + XML_FILE_NAME_MODEL;
+	bool bEncrypted = false;
+	if (sPassword != "" && QFile::exists(sFile + ENCRYPTION_FILE_EXTENSION))
+	{
+		bEncrypted = PdpDecrypt2(sFile + ENCRYPTION_FILE_EXTENSION, sPassword);
+		if (!bEncrypted)
+			return false;
+	}
+
+	QByteArray data;
+	QFile file(sFile);
+	bool bRead = file.open(QIODevice::ReadOnly);
+	if (bRead)
+	{
+		data = file.readAll();
+		file.close();
+	}
+	if (bEncrypted)
+		PdpRemove(sFile);
+
+	if (!bRead)
+		return false;
+
+	// the file is only hashed, parsing is skipped when the binary copy was written with it
+	if (ReadModelBinary(sCasePath, sPassword, ModelXmlWriter::GetHash(data)))
+		return true;
+
+	ModelXmlReader reader;
+	if (!reader.ReadData(data))
+	{
+		FUSION_DLOG(FUSION_DLOG_WARNING, "model", "stream-read-failed", FusionDebugLog::Fields()
+			.Add("error", reader.GetErrorString()));
+		return false;
+	}
+
+	if (reader.GetFileVersion() > MODEL_XML_FILE_VERSION)
+		return false;
+
+	return BuildModel(reader.GetSubModels(), reader.GetRemarks());
+}
+
+bool FusionSurgery::ReadModelBinary(QString sCasePath, QString sPassword, const QByteArray& xmlHash)
+{
+	FUSION_TRACE_SCOPE("ReadModelBinary", "case");
+
+	QString sFile = sCasePath + "/model/" + MODEL_BINARY_FILE_NAME;
+	if (!QFile::exists(sFile) && !QFile::exists(sFile + ENCRYPTION_FILE_EXTENSION))
+		return false;
+
+	bool bEncrypted = false;
+	if (sPassword != "" && QFile::exists(sFile + ENCRYPTION_FILE_EXTENSION))
+	{
+		bEncrypted = PdpDecrypt2(sFile + ENCRYPTION_FILE_EXTENSION, sPassword);
+		if (!bEncrypted)
+			return false;
+	}
+
+	ModelBinaryReader reader;
+	bool bRead = reader.Read(sFile);
+	if (bEncrypted)
+		PdpRemove(sFile);
+
+	if (!bRead)
+	{
+		FUSION_DLOG(FUSION_DLOG_WARNING, "model", "binary-read-failed", FusionDebugLog::Fields()
+			.Add("error", reader.GetErrorString()));
+		return false;
+	}
+
+	// model.xml was written without the copy, e.g. by the tools or the meta record DOM
+	if (reader.GetXmlHash() != xmlHash)
+		return false;
+
+	// a partly built model is thrown away so model.xml can be read instead
+	if (!BuildModel(reader.GetSubModels(), reader.GetRemarks()))
+	{
+		NewUrologyModel(MODEL_MODE_SEMIAUTO);
+		return false;
+	}
+
+	return true;
+}
+
+bool FusionSurgery::ReadModelAutosave(QString sCasePath, QString sPassword)
+{
+	FUSION_TRACE_SCOPE("ReadModelAutosave", "case");
+
+	ModelBinaryReader reader;
+	if (!ModelAutosave::Read(sCasePath, sPassword, reader))
+	{
+		FUSION_DLOG(FUSION_DLOG_WARNING, "model", "autosave-read-failed", FusionDebugLog::Fields()
+			.Add("error", reader.GetErrorString()));
+		return false;
+	}
+
+	// a partly built model is thrown away so the saved model can be read instead
+	if (!BuildModel(reader.GetSubModels(), reader.GetRemarks()))
+	{
+		NewUrologyModel(MODEL_MODE_SEMIAUTO);
+		return false;
+	}
+
+	return true;
+}
+
+bool FusionSurgery::BuildModel(const QList<ModelXmlReader::SubModel>& subModels, QString sRemarks)
+{
+	// only the prostate and lesions are mapped, anything else is left to the model
+	QSet<int> ids;
+	for (int i = 0; i < subModels.size(); i++)
+	{
+		const ModelXmlReader::SubModel& subModel = subModels.at(i);
+		if (subModel.sType == MODEL_XML_TYPE_PROSTATE && subModel.iId != MODEL_PROSTATE)
+			return false;
+		if (subModel.sType == MODEL_XML_TYPE_LESION && subModel.iId < MODEL_XML_FIRST_LESION_ID)
+			return false;
+		if ((subModel.sType != MODEL_XML_TYPE_PROSTATE && subModel.sType != MODEL_XML_TYPE_LESION) || ids.contains(subModel.iId))
+			return false;
+		ids.insert(subModel.iId);
+	}
+
+	// like the model reader, the lesions go into the urology model under their
+	// ids and are moved to the lesions model when the case is opened
+	for (int i = 0; i < subModels.size(); i++)
+	{
+		const ModelXmlReader::SubModel& subModel = subModels.at(i);
+
+		inurbsSubModel* pSubModel = m_pUrologyModel->GetSubModel(subModel.iId);
+		if (!pSubModel)
+		{
+			CreateSubModel(subModel.iId, SURFACE_CLOSED);
+			pSubModel = m_pUrologyModel->GetSubModel(subModel.iId);
+		}
+
+		if (!pSubModel)
+			return false;
+
+		if (subModel.sType == MODEL_XML_TYPE_LESION)
+			pSubModel->SetRiskScore(subModel.iRiskScore);
+
+		inurbsPlanarCurveStack* pCurveStack = pSubModel->GetCurveStack();
+		for (int j = 0; j < subModel.curves.size(); j++)
+		{
+			const ModelXmlReader::Curve& curve = subModel.curves.at(j);
+			if (curve.points.isEmpty())
+				continue;
+
+			inurbsPlanarCurve* pCurve = pCurveStack->CreateCurve(curve.z);
+			pCurve->SetPoints((inurbsPoint*)curve.points.constData(), curve.points.size());
+		}
+	}
+
+	m_sLesionRemarks = sRemarks;
+	m_pLesionRemarksModel = m_pUrologyModel;
+	return true;
+}
+
+bool FusionSurgery::WriteModelXml(QString sPassword, QByteArray* pHash)
+{
+	FUSION_TRACE_SCOPE("WriteModelXml", "case");
+
+	QMap<int, inurbsSubModel*> subModels;
+	if (!GetModelSubModels(subModels))
+		return false;
+
+	QString sFolder = m_sCasePath + "/model";
+	QDir().mkpath(sFolder);
+	QString sFile = sFolder + "/" + XML_FILE_NAME_MODEL;
+
+	ModelXmlWriter writer;
+	if (!writer.Open(sFile))
+		return false;
+
+	QMap<int, inurbsSubModel*>::const_iterator it;
+	for (it = subModels.constBegin(); it != subModels.constEnd(); ++it)
+		writer.WriteSubModel(it.key(), it.key() == MODEL_PROSTATE ? MODEL_XML_TYPE_PROSTATE : MODEL_XML_TYPE_LESION, it.value());
+
+	QString sRemarks = GetLesionRemarks();
+	if (!writer.Close(sRemarks))
+		return false;
+
+	if (pHash)
+		*pHash = writer.GetHash();
+
+	if (sPassword != "" && !PdpEncrypt2(sFile, sPassword)) // removes the plain file
+		return false;
+
+	m_sLesionRemarks = sRemarks;
+	m_pLesionRemarksModel = m_pUrologyModel;
+	return true;
+}
+
+bool FusionSurgery::WriteModelBinary(QString sPassword, const QByteArray& xmlHash)
+{
+	FUSION_TRACE_SCOPE("WriteModelBinary", "case");
+
+	QList<ModelXmlReader::SubModel> subModels;
+	if (!GetModelSnapshot(subModels))
+		return false;
+
+	ModelBinaryWriter writer;
+	for (int i = 0; i < subModels.size(); i++)
+		writer.AddSubModel(subModels.at(i));
+	writer.SetXmlHash(xmlHash);
+
+	QString sFolder = m_sCasePath + "/model";
+	QDir().mkpath(sFolder);
+	QString sFile = sFolder + "/" + MODEL_BINARY_FILE_NAME;
+
+	QString sRemarks = GetLesionRemarks();
+	if (!writer.Write(sFile, sRemarks))
+		return false;
+
+	if (sPassword != "" && !PdpEncrypt2(sFile, sPassword)) // removes the plain file
+		return false;
+
+	m_sLesionRemarks = sRemarks;
+	m_pLesionRemarksModel = m_pUrologyModel;
+	return true;
+}
+
+bool FusionSurgery::GetModelSnapshot(QList<ModelXmlReader::SubModel>& subModels)
+{
+	QMap<int, inurbsSubModel*> sources;
+	return GetModelSnapshot(subModels, sources, QList<ModelXmlReader::SubModel>(), QMap<int, inurbsSubModel*>(), QSet<inurbsSubModel*>());
+}
+
+bool FusionSurgery::GetModelSnapshot(QList<ModelXmlReader::SubModel>& subModels, QMap<int, inurbsSubModel*>& sources,
+	const QList<ModelXmlReader::SubModel>& previous, const QMap<int, inurbsSubModel*>& previousSources, const QSet<inurbsSubModel*>& edited)
+{
+	subModels.clear();
+	sources.clear();
+	if (!m_pUrologyModel)
+		return false;
+
+	if (!GetModelSubModels(sources))
+		return false;
+
+	QMap<int, const ModelXmlReader::SubModel*> previousById;
+	for (int i = 0; i < previous.size(); i++)
+		previousById.insert(previous.at(i).iId, &previous.at(i));
+
+	QMap<int, inurbsSubModel*>::const_iterator it;
+	for (it = sources.constBegin(); it != sources.constEnd(); ++it)
+	{
+		inurbsSubModel* pSubModel = it.value();
+		const ModelXmlReader::SubModel* pPreviousSubModel = previousById.value(it.key(), NULL);
+
+		// a lesion not marked edited since the previous snapshot, still under the same
+		// id, is taken as it is. Prostate edits are not marked, so it is compared
+		if (pPreviousSubModel && it.key() != MODEL_PROSTATE && previousSources.value(it.key(), NULL) == pSubModel &&
+			!edited.contains(pSubModel))
+		{
+			subModels.append(*pPreviousSubModel);
+			continue;
+		}
+
+		ModelXmlReader::SubModel subModel;
+		subModel.iId = it.key();
+		subModel.sType = it.key() == MODEL_PROSTATE ? MODEL_XML_TYPE_PROSTATE : MODEL_XML_TYPE_LESION;
+		subModel.iRiskScore = it.key() == MODEL_PROSTATE ? -1 : pSubModel->GetRiskScore();
+
+		inurbsPlanarCurveStack* pCurveStack = pSubModel->GetCurveStack();
+		int iNumCurves = pCurveStack->GetNumOfCurves();
+		for (int i = 0; i < iNumCurves; i++)
+		{
+			inurbsPlanarCurve* pCurve = pCurveStack->GetCurve(i);
+			if (!pCurve || pCurve->GetNumOfPoints() == 0) // the position is taken from the points
+				continue;
+
+			QList<inurbsPoint*>* pPoints = pCurve->GetPoints();
+			int iNumPoints = pPoints->size();
+			int iCurve = subModel.curves.size();
+
+			// only the edited curves are copied, the others share the points of the previous snapshot
+			if (pPreviousSubModel && iCurve < pPreviousSubModel->curves.size())
+			{
+				const ModelXmlReader::Curve& previousCurve = pPreviousSubModel->curves.at(iCurve);
+				bool bEqual = previousCurve.z == pPoints->at(0)->z && previousCurve.points.size() == iNumPoints;
+				for (int j = 0; bEqual && j < iNumPoints; j++)
+				{
+					const inurbsPoint* pPoint = pPoints->at(j);
+					const inurbsPoint& point = previousCurve.points.at(j);
+					bEqual = pPoint->x == point.x && pPoint->y == point.y && pPoint->z == point.z;
+				}
+
+				if (bEqual)
+				{
+					subModel.curves.append(previousCurve);
+					continue;
+				}
+			}
+
+			ModelXmlReader::Curve curve;
+			curve.z = pPoints->at(0)->z;
+			curve.points.resize(iNumPoints);
+			for (int j = 0; j < iNumPoints; j++)
+			{
+				const inurbsPoint* pPoint = pPoints->at(j);
+				curve.points[j] = inurbsPoint(pPoint->x, pPoint->y, pPoint->z);
+			}
+			subModel.curves.append(curve);
+		}
+
+		subModels.append(subModel);
+	}
+
+	return true;
+}
+
+bool FusionSurgery::GetModelSubModels(QMap<int, inurbsSubModel*>& subModels)
+{
+	QMap<int, inurbsSubModel*>* pSubModels = m_pUrologyModel->GetSubModels();
+	if (!pSubModels)
+		return false;
+
+	QSet<inurbsSubModel*> lesions;
+	for (int i = 0; i < m_pUrologyModel->GetNumLesionSubModels(); i++)
+		lesions.insert(m_pUrologyModel->GetLesionModel(i));
+
+	// critical structures and other sub-models are left to the model
+	QMap<int, inurbsSubModel*>::const_iterator it;
+	for (it = pSubModels->constBegin(); it != pSubModels->constEnd(); ++it)
+	{
+		if (it.key() == MODEL_PROSTATE)
+			subModels.insert(it.key(), it.value());
+		else if (!lesions.contains(it.value()))
+			return false;
+	}
+
+	// the lesions are numbered in list order after the reserved ids, which
+	// maps them back to the same lesions model keys when the case is opened
+	for (int i = 0; i < m_pUrologyModel->GetNumLesionSubModels(); i++)
+		subModels.insert(MODEL_XML_FIRST_LESION_ID + i, m_pUrologyModel->GetLesionModel(i));
+
+	return true;
+}
+
 /******************************************************************************/
 /* Lesion functions                                                                           
 /******************************************************************************/
@@ -378,6 +1199,10 @@ void FusionSurgery::NewLesionsModel()
 		return;
 
 	m_pUrologyModel->NewLesionsModel();
+	InvalidateLesionSurface();
+
+	m_sLesionRemarks = "";
+	m_pLesionRemarksModel = m_pUrologyModel;
 }
 
 inurbsModel* FusionSurgery::GetLesionsModel()
@@ -404,6 +1229,7 @@ void FusionSurgery::DeleteLesionSubModel(inurbsSubModel* pLesion)
 		return;
 
 	m_pUrologyModel->DeleteLesionSubModel(pLesion);
+	InvalidateLesionSurface(pLesion);
 }
 
 int FusionSurgery::GetLesionSubModelId(inurbsSubModel* pLesion)
@@ -443,11 +1269,155 @@ int FusionSurgery::GetNumValidLesionSubModels()
 	return m_pUrologyModel->GetNumValidLesionSubModels();
 }
 
+QMap<double, quint64> FusionSurgery::GetCurveSignatures(inurbsSubModel* pLesion)
+{
+	QMap<double, quint64> signatures;
+
+	inurbsPlanarCurveStack* pCurveStack = pLesion->GetCurveStack();
+	if (!pCurveStack)
+		return signatures;
+
+	int iNumCurves = pCurveStack->GetNumOfCurves();
+	for (int i = 0; i < iNumCurves; i++)
+	{
+		inurbsPlanarCurve* pCurve = pCurveStack->GetCurve(i);
+		if (!pCurve)
+			continue;
+
+		QList<inurbsPoint*>* pPoints = pCurve->GetPoints();
+		if (!pPoints || pPoints->isEmpty())
+			continue;
+
+		// FNV-1a over the point coordinates
+		quint64 iHash = 14695981039346656037ULL;
+		for (int j = 0; j < pPoints->size(); j++)
+		{
+			double xy[2] = { pPoints->at(j)->x, pPoints->at(j)->y };
+			const unsigned char* pBytes = (const unsigned char*)xy;
+			for (int k = 0; k < (int)sizeof(xy); k++)
+			{
+				iHash ^= pBytes[k];
+				iHash *= 1099511628211ULL;
+			}
+		}
+
+		signatures.insert(pPoints->at(0)->z, iHash);
+	}
+
+	return signatures;
+}
+
+bool FusionSurgery::IsLesionSurfaceUpToDate(inurbsSubModel* pLesion, QList<double>* pDirtyPositions)
+{
+	if (!pLesion)
+		return false;
+
+	QMap<double, quint64> current = GetCurveSignatures(pLesion);
+	if (!m_lesionCurveSignatures.contains(pLesion))
+	{
+		if (pDirtyPositions)
+			*pDirtyPositions = current.keys();
+		return false;
+	}
+
+	// compare both ways to pick up added, changed and removed curves
+	const QMap<double, quint64>& built = m_lesionCurveSignatures[pLesion];
+	QList<double> dirtyPositions;
+	QMapIterator<double, quint64> it(current);
+	while (it.hasNext())
+	{
+		it.next();
+		if (!built.contains(it.key()) || built.value(it.key()) != it.value())
+			dirtyPositions.append(it.key());
+	}
+	QMapIterator<double, quint64> itBuilt(built);
+	while (itBuilt.hasNext())
+	{
+		itBuilt.next();
+		if (!current.contains(itBuilt.key()))
+			dirtyPositions.append(itBuilt.key());
+	}
+
+	if (pDirtyPositions)
+		*pDirtyPositions = dirtyPositions;
+
+	return dirtyPositions.isEmpty();
+}
+
+void FusionSurgery::SetLesionSurfaceBuilt(inurbsSubModel* pLesion)
+{
+	if (!pLesion)
+		return;
+
+	m_lesionCurveSignatures.insert(pLesion, GetCurveSignatures(pLesion));
+}
+
+void FusionSurgery::InvalidateLesionSurface(inurbsSubModel* pLesion)
+{
+	if (pLesion)
+		m_lesionCurveSignatures.remove(pLesion);
+	else
+		m_lesionCurveSignatures.clear();
+}
+
+double FusionSurgery::GetCurveStackVolume(inurbsSubModel* pSubModel)
+{
+	if (!pSubModel)
+		return 0.0;
+
+	inurbsPlanarCurveStack* pCurveStack = pSubModel->GetCurveStack();
+	if (!pCurveStack)
+		return 0.0;
+
+	// area of each closed curve with the shoelace formula, sorted by z
+	QMap<double, double> areas;
+	int iNumCurves = pCurveStack->GetNumOfCurves();
+	for (int i = 0; i < iNumCurves; i++)
+	{
+		inurbsPlanarCurve* pCurve = pCurveStack->GetCurve(i);
+		if (!pCurve || pCurve->GetNumOfPoints() < 3)
+			continue;
+
+		QList<inurbsPoint*>* pPoints = pCurve->GetPoints();
+		int iNumPoints = pPoints->size();
+		double fArea = 0.0;
+		for (int j = 0; j < iNumPoints; j++)
+		{
+			const inurbsPoint* p0 = pPoints->at(j);
+			const inurbsPoint* p1 = pPoints->at((j + 1) % iNumPoints);
+			fArea += p0->x * p1->y - p1->x * p0->y;
+		}
+
+		areas.insert(pPoints->at(0)->z, fabs(fArea) * 0.5);
+	}
+
+	if (areas.size() < 2)
+		return 0.0;
+
+	// trapezoidal integration between neighbouring curves
+	double fVolume = 0.0;
+	QMap<double, double>::const_iterator prev = areas.constBegin();
+	QMap<double, double>::const_iterator it = prev + 1;
+	for (; it != areas.constEnd(); prev = it, ++it)
+		fVolume += (prev.value() + it.value()) * 0.5 * (it.key() - prev.key());
+
+	return fVolume;
+}
+
 bool FusionSurgery::SaveLesionsModel(QString sRemarks)
 {
 	if (!m_pUrologyModel)
 		return false;
 
+	m_sLesionRemarks = sRemarks;
+	m_pLesionRemarksModel = m_pUrologyModel;
+	QByteArray xmlHash;
+	if (WriteModelXml(m_sEncryptCasePassword, &xmlHash))
+	{
+		WriteModelBinary(m_sEncryptCasePassword, xmlHash);
+		return true;
+	}
+
 	return m_pUrologyModel->SaveLesionsModel(m_sCasePath,sRemarks, m_sEncryptCasePassword);
 }
 
@@ -457,6 +1427,8 @@ bool FusionSurgery::SaveLesionsModel(QString sRemarks)
 
 bool FusionSurgery::LoadRTStruct(QString sFileName, QString sPassword)
 {
+	FUSION_TRACE_SCOPE("LoadRTStruct", "import");
+
 	bool bEncryptedRTFile = false;
 
 	if (sPassword != "")
@@ -607,7 +1579,9 @@ bool FusionSurgery::LoadRTStruct(QString sFileName, QString sPassword)
 
 			if (contgeotype.GetValue() == "CLOSED_PLANAR " || contgeotype.GetValue() == "OPEN_NONPLANAR ")
 			{
-				RTContour* pContour = new RTContour;
+				const double* pts = at.GetValues();
+				unsigned int npts = at.GetNumberOfValues() / 3;
+				RTContour* pContour = m_pRTStruct->CreateContour(npts);
 
 				if (nestedds2.FindDataElement(gdcm::Tag(0x3006, 0x0016)))
 				{
@@ -629,12 +1603,9 @@ bool FusionSurgery::LoadRTStruct(QString sFileName, QString sPassword)
 				}
 
 
-				const double* pts = at.GetValues();
-				unsigned int npts = at.GetNumberOfValues() / 3;
-
 				//pROI->m_numPoints.append(npts);
 				
-				double* pPts = new double[npts * 3];
+				double* pPts = pContour->m_pPoints;
 				for (unsigned int j = 0; j < npts * 3; j += 3)
 				{
 					pPts[j] = pts[j + 0];
@@ -643,8 +1614,6 @@ bool FusionSurgery::LoadRTStruct(QString sFileName, QString sPassword)
 				}
 
 				// add contour
-				pContour->m_iNumPoints = npts;
-				pContour->m_pPoints = pPts;
 				pROI->AddContour(pContour);
 
 				//pROI->m_contours.append(pPts);
@@ -662,6 +1631,8 @@ bool FusionSurgery::LoadRTStruct(QString sFileName, QString sPassword)
 
 bool FusionSurgery::ConvertRTContoursToModel(QStringList files, QString sPassword)
 {
+	FUSION_TRACE_SCOPE("ConvertRTContoursToModel", "import");
+
 	if (!m_pRTStruct || !m_pRTStruct->GetNumROIs())
 		return false;
 
@@ -738,7 +1709,8 @@ bool FusionSurgery::ConvertRTContoursToModel(QStringList files, QString sPasswor
 		QString s = at.GetValue();
 		sopInstanceUIDIndexMap.insert(s, i);
 
-		printf("filename %s\n", sortedFileNames[i].c_str());
+		FUSION_DLOG(FUSION_DLOG_TRACE, "rtstruct", "slice-file", FusionDebugLog::Fields()
+			.Add("index", i).Add("sop-uid", s).Add("file", QString::fromLocal8Bit(sortedFileNames[i].c_str())));
 
 		//gdcm::Tag tpatientImagePos(0x0020, 0x0032);
 		//const gdcm::DataElement & patientImagePos = ds.GetDataElement(tpatientImagePos);
@@ -766,15 +1738,8 @@ bool FusionSurgery::ConvertRTContoursToModel(QStringList files, QString sPasswor
 		iIndex += 3;
 	}
 
-	// testing, print out the map
-	QMapIterator<QString, int> its(sopInstanceUIDIndexMap);
-	while (its.hasNext())
-	{
-		its.next();
-		QString ss = its.key();
-		int index = its.value();
-		printf("%s, %d\n", ss.toLatin1().data(), index);
-	}
+	FUSION_DLOG(FUSION_DLOG_DEBUG, "rtstruct", "slice-index", FusionDebugLog::Fields()
+		.Add("images", iNumImages).Add("indexed", sopInstanceUIDIndexMap.size()));
 	
 	double* spacing = m_pImageStack->GetSpacing();
 	int iImageWidth = m_pImageStack->GetWidth();
@@ -793,9 +1758,11 @@ bool FusionSurgery::ConvertRTContoursToModel(QStringList files, QString sPasswor
 
 	int *pMaxNumPoints = new int[iNumImages];
 
+	// decimated points of one contour, reused for every contour so the points are not allocated one by one
+	std::vector<inurbsPoint> curvePoints;
+
 	for (int i = 0;i < iNumROIs;i++)
 	{
-		printf("Roi %d\n",i);
 		// here it is assumed that m_pUrologyModel and the submodel is already created
 		// TODO PLE: revisit here when we work out the workflow
 		// assuming that the first ROI is the prostate
@@ -812,8 +1779,8 @@ bool FusionSurgery::ConvertRTContoursToModel(QStringList files, QString sPasswor
 		RTROI* pROI = m_pRTStruct->GetROI(i);
 		int iNumCurves = pROI->GetNumContours();
 
-		if (i != 0)
-			printf("ROI %d, num of curves = %d\n ", i, iNumCurves);
+		FUSION_DLOG(FUSION_DLOG_DEBUG, "rtstruct", "roi", FusionDebugLog::Fields()
+			.Add("roi", i).Add("contours", iNumCurves));
 
 		for (int n = 0;n < iNumImages;n++)
 		{
@@ -826,8 +1793,6 @@ bool FusionSurgery::ConvertRTContoursToModel(QStringList files, QString sPasswor
 			int iNumPoints = pContour->m_iNumPoints;
 			double *pPts = pContour->m_pPoints;
 
-			printf("curve %d\n", j);
-
 			if (i == 0) // prostate contour
 			{
 				fDistanceLimit1 = 8.0;
@@ -882,8 +1847,9 @@ bool FusionSurgery::ConvertRTContoursToModel(QStringList files, QString sPasswor
 
 			double fPrevAddedPoint[2], fFirstAddedPoint[2];
 
-			printf("Num points %d\n", iNumPoints);
-			QList<inurbsPoint *> *tmpPoints = new QList<inurbsPoint *>;
+			int iNumCornerPoints = 0, iNumKeptCornerPoints = 0;
+			curvePoints.clear();
+			curvePoints.reserve(iNumPoints);
 			
 			for (int k = 0; k < iNumPoints; k++)
 			{
@@ -910,8 +1876,6 @@ bool FusionSurgery::ConvertRTContoursToModel(QStringList files, QString sPasswor
 			for (int k=0; k < iNumPoints; k++)
 			{
 				//int pIndex[3];
-				inurbsPoint* addPt;
-
 
 				// get next point
 				bool bCornerPoint = false;
@@ -943,7 +1907,10 @@ bool FusionSurgery::ConvertRTContoursToModel(QStringList files, QString sPasswor
 
 
 					if (dx1*dx2 < 0.0 ||   dy1*dy2 < 0.0)
+					{
 						bCornerPoint = true;
+						iNumCornerPoints++;
+					}
 				}
 
 				/*// transform from contour points coordinates to image coordinates
@@ -977,9 +1944,9 @@ bool FusionSurgery::ConvertRTContoursToModel(QStringList files, QString sPasswor
 					//if (fDistance > fDistanceLimit || bCornerPoint)
 					if (fDistance > fDistanceLimit)
 					{
-						addPt = new inurbsPoint(tp[0], tp[1], worldZ);
-						printf("add point %4.2f, %4.2f, %4.2f\n", tp[0], tp[1], worldZ);
-						tmpPoints->append(addPt);
+						curvePoints.push_back(inurbsPoint(tp[0], tp[1], worldZ));
+						if (bCornerPoint)
+							iNumKeptCornerPoints++;
 
 						fPrevAddedPoint[0] = tp[0];
 						fPrevAddedPoint[1] = tp[1];
@@ -988,9 +1955,7 @@ bool FusionSurgery::ConvertRTContoursToModel(QStringList files, QString sPasswor
 				}
 				else // first point
 				{
-					printf("add point %4.2f, %4.2f, %4.2f\n", tp[0], tp[1], worldZ);
-					addPt = new inurbsPoint(tp[0], tp[1], worldZ);
-					tmpPoints->append(addPt);
+					curvePoints.push_back(inurbsPoint(tp[0], tp[1], worldZ));
 					
 					fPrevAddedPoint[0] = tp[0];
 					fPrevAddedPoint[1] = tp[1];
@@ -1001,16 +1966,14 @@ bool FusionSurgery::ConvertRTContoursToModel(QStringList files, QString sPasswor
 
 			}
 
-			printf("Num points to be added = %d\n", tmpPoints->count());
-			pCurve->SetPoints(tmpPoints);
-			qDeleteAll(tmpPoints->begin(), tmpPoints->end());
-			tmpPoints->clear();
-			delete tmpPoints;
+			FUSION_DLOG(FUSION_DLOG_DEBUG, "rtstruct", "contour-decimation", FusionDebugLog::Fields()
+				.Add("roi", i).Add("contour", j).Add("slice", iSliceOriginIndex).Add("z", worldZ)
+				.Add("input", iNumPoints).Add("kept", (int)curvePoints.size())
+				.Add("corner", iNumCornerPoints).Add("corner-kept", iNumKeptCornerPoints)
+				.Add("limit", fDistanceLimit1).Add("corner-limit", fDistanceLimit2));
 
-			if (i != 0)
-			{
-				printf("slice %d, total num of points = %d, added points = %d\n", iSliceOriginIndex, iNumPoints, pCurve->GetNumOfPoints());
-			}
+			if (!curvePoints.empty())
+				pCurve->SetPoints(&curvePoints[0], (int)curvePoints.size());
 
 			if (pMaxNumPoints[iSliceOriginIndex] < iNumPoints)
 				pMaxNumPoints[iSliceOriginIndex] = iNumPoints;
@@ -1042,7 +2005,15 @@ bool FusionSurgery::ConvertRTContoursToModel(QStringList files, QString sPasswor
 		if (pSubModel->GetNumOfCurves() == 0)
 			DeleteLesionSubModel(pSubModel);
 		else
-			pSubModel->BuildSurface();
+		{
+			FUSION_TRACE_SCOPE("BuildSurface", "model");
+			{
+				QMutexLocker locker(LesionSurfaceBuilder::GetBuildMutex());
+				pSubModel->BuildSurface();
+			}
+			if (i != 0)
+				SetLesionSurfaceBuilt(pSubModel);
+		}
 	}
 
 	// remove dir immediately after reading
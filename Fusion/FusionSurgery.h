@@ -10,6 +10,13 @@
 #define XML_FUSION_SURGERY_FILE_VERSION 1
 
 #include <QStandardItemModel>
+#include <QMap>
+#include <QSet>
+#include <QFile>
+#include <QThreadPool>
+#include <QMutex>
+#include <QVector>
+#include <atomic>
 #include <itkGDCMImageIO.h>
 #include <itkImageSeriesReader.h>
 #include <itkGDCMSeriesFileNames.h>
@@ -18,6 +25,8 @@
 #include "BaseSurgery.h"
 #include "DicomDirImporter.h"
 #include "RTStruct.h"
+#include "ChunkedCrypto.h"
+#include "ModelXmlStream.h"
 
 class inurbsSubModel;
 class inurbsModel;
@@ -43,7 +52,19 @@ public:
 	
 	// Open case functions
 	bool LoadImageStack(QString sCasePath, QString sPassword=""); // pass in case path as Read function of ImageStack takes case path as argument
-	bool LoadModel(QString sCasePath, QString sPassword="");
+	bool LoadModel(QString sCasePath, QString sPassword="", bool bRecoverAutosave=false); // the autosave is used if it is readable
+
+	// unencrypted cases are mapped and encrypted cases read from their chunked copy,
+	// the viewed slice is copied first and the others
+	// on a worker thread, imageStackLoaded() is emitted when all slices are in
+	bool IsImageStackLoading() { return m_bImageStackLoading.load(); }
+	void WaitForImageStack();
+	void CancelImageLoad(); // stops the worker and waits for it, the slices not copied yet stay empty
+	void LoadImageSlice(double z); // copies the slice at z now if the worker has not, before it is viewed
+	void DeleteImageStack(); // overwrite, the worker is stopped first
+	bool SaveImageStack(bool bUpdate, QString sPassword=""); // overwrite, waits for all slices
+	static QString GetImageChunkedFileName(QString sCasePath);
+	static bool UpdateImageMapInfo(QString sCasePath); // the chunked image was written again with the same pixels, e.g. re-encrypted
 
 	// Dicom functions
 	
@@ -53,9 +74,22 @@ public:
 	void FlipImageStack(int iFlip);
 	void FlipImage_AntPos();
 	void FlipImage_ApexBase();
+	bool SaveImageStack8Bit(QString sPassword="");
 
 	// model functions
 	void InitModelLimitPositions(); // overwrite
+	void SaveModel(); // overwrite, streams model.xml and its binary copy when the model has only prostate and lesions
+	QString GetLesionRemarks();
+
+	// copy of the prostate and lesion curves that can be written on another thread
+	bool GetModelSnapshot(QList<ModelXmlReader::SubModel>& subModels);
+
+	// the same after a previous snapshot, sources gets the submodel of each id. A
+	// lesion of previousSources that is not in edited shares its curves without
+	// its points being read, the curves of the others are compared with previous
+	// and shared where they did not change
+	bool GetModelSnapshot(QList<ModelXmlReader::SubModel>& subModels, QMap<int, inurbsSubModel*>& sources,
+		const QList<ModelXmlReader::SubModel>& previous, const QMap<int, inurbsSubModel*>& previousSources, const QSet<inurbsSubModel*>& edited);
 
 	// lesion functions
 	void NewLesionsModel(); // new the lesion list
@@ -69,9 +103,18 @@ public:
 	void DeleteLesionSubModel(inurbsSubModel* pLesion);
 	bool SaveLesionsModel(QString sRemarks);
 
+	// lesion surface rebuild tracking, the surface only needs a rebuild when a curve changed since the last build
+	bool IsLesionSurfaceUpToDate(inurbsSubModel* pLesion, QList<double>* pDirtyPositions = NULL);
+	void SetLesionSurfaceBuilt(inurbsSubModel* pLesion);
+	void InvalidateLesionSurface(inurbsSubModel* pLesion = NULL); // NULL invalidates all lesions
+
+	// volume from the curve areas integrated along z, cheap estimate while editing
+	static double GetCurveStackVolume(inurbsSubModel* pSubModel);
+
 	// RTStruct functions
 	bool LoadRTStruct(QString sFileName, QString sPassword);
 	bool ConvertRTContoursToModel(QStringList files, QString sPassword);
+	RTStruct* GetRTStruct() { return m_pRTStruct; }
 
 protected:
 
@@ -82,10 +125,44 @@ protected:
 	//int m_iDicomWindowCenter, m_iDicomWindowWidth;
     //double m_fDirCosines[6];
 	RTStruct *m_pRTStruct;
+
+	// curve signatures by curve position at the last surface build of each lesion
+	QMap<inurbsSubModel*, QMap<double, quint64> > m_lesionCurveSignatures;
+	QMap<double, quint64> GetCurveSignatures(inurbsSubModel* pLesion);
+
+	// streamed model.xml and its binary copy, false for files or models the stream does not map
+	bool ReadModelXml(QString sCasePath, QString sPassword);
+	bool WriteModelXml(QString sPassword, QByteArray* pHash = NULL);
+	bool ReadModelBinary(QString sCasePath, QString sPassword, const QByteArray& xmlHash); // false unless written with that model.xml
+	bool ReadModelAutosave(QString sCasePath, QString sPassword);
+	bool WriteModelBinary(QString sPassword, const QByteArray& xmlHash);
+	bool GetModelSubModels(QMap<int, inurbsSubModel*>& subModels);
+	bool BuildModel(const QList<ModelXmlReader::SubModel>& subModels, QString sRemarks);
+	QString m_sLesionRemarks;
+	UrologyModel* m_pLesionRemarksModel; // model the remarks above belong to
+
+	// mapped image loading
+	bool LoadMappedImageStack(QString sCasePath, QString sPassword);
+	bool WriteImageMapInfo();
+	void CopyMappedSlices(int iFirstSlice); // runs on the worker
+	bool CopySourceSlice(int iSlice, qint64 iSliceSize); // called with m_imageSliceMutex locked
+	void CloseImageSource();
+
+	QFile m_mappedImageFile;
+	uchar* m_pMappedPixels;
+	ChunkedCryptoReader m_chunkedImageReader;
+	QMutex m_imageSliceMutex; // the source and the copied flags, the worker and the views copy slices
+	QVector<bool> m_copiedSlices;
+	QThreadPool m_imageLoadPool;
+	std::atomic<bool> m_bImageStackLoading;
+	std::atomic<bool> m_bCancelImageLoad;
+
+	friend class MappedSliceCopyTask;
 	
 
 signals:
 	void progressChanged(int value);
+	void imageStackLoaded();
 };
 
 #endif
@@ -9,6 +9,11 @@
 #include <QTimer>
 #include <QApplication>
 #include <QDir>
+#include <QDateTime>
+#include <QEventLoop>
+#include <QRunnable>
+#include <QThreadPool>
+#include <algorithm>
 
 #include "Application.h"
 #include "FusionSurgeryController.h"
@@ -18,6 +23,15 @@
 #include "CommonClasses.h"
 #include "Crypto.h"
 #include "PDP.h"
+#include "FusionTrace.h"
+#include "FusionDebugLog.h"
+#include "LesionSurfaceBuilder.h"
+#include "CurvePickIndex.h"
+#include "CurveEditHistory.h"
+#include "ModelBinaryFile.h"
+#include "ModelAutosave.h"
+#include "CaseEncryptor.h"
+#include "CaseExporter.h"
 
 FusionSurgeryController* FusionSurgeryController::m_pInstance = 0;
 
@@ -28,16 +42,29 @@ FusionSurgeryController::FusionSurgeryController()
 	m_pSurgery = NULL;
 	m_sPatientNationality = "";
 	m_sPatientDataFolder = "";
+	m_bMergedLesionSurfaces = true;
 	ClearSubStateFlags();
 
+	m_pLesionSurfaceBuilder = new LesionSurfaceBuilder(this);
+	connect(m_pLesionSurfaceBuilder, SIGNAL(previewBuilt(inurbsSubModel*, inurbsSubModel*)), this, SLOT(ShowLesionPreviewSurface(inurbsSubModel*, inurbsSubModel*)));
+
+	m_pCurvePickIndex = new CurvePickIndex;
+	m_pCurveEditHistory = new CurveEditHistory;
+	m_pModelAutosave = new ModelAutosave(this);
+
 	ReadAppConfig();
 
 }
 
 FusionSurgeryController::~FusionSurgeryController()
 {
+	m_pModelAutosave->Stop(); // the surgery is deleted below
+
 	if (m_pSurgery)
 		delete m_pSurgery;
+
+	delete m_pCurvePickIndex;
+	delete m_pCurveEditHistory;
 }
 
 FusionSurgeryController* FusionSurgeryController::GetInstance()
@@ -80,6 +107,7 @@ bool FusionSurgeryController::ReadAppConfig()
 	// default values
 	m_sPatientNationality = "";
 	m_sPatientDataFolder = QString("C:/") + SYSTEM_PATIENTDATA_RELATIVE_PATH;
+	m_bMergedLesionSurfaces = true;
 
 	QString sAppConfigFilePath = SYSTEM_CONFIG_FOLDER + QString("%1Config.xml").arg(APPLICATION_NAME);
 
@@ -104,6 +132,9 @@ bool FusionSurgeryController::ReadAppConfig()
 
 		UtlMetaRecordItem* nationality = pItemRoot->getChildItem("patient-nationality");
 		if(nationality) m_sPatientNationality = nationality->getValue();
+
+		UtlMetaRecordItem* mergedSurfaces = pItemRoot->getChildItem("merged-lesion-surfaces");
+		if(mergedSurfaces) m_bMergedLesionSurfaces = mergedSurfaces->getValueAsInt() != 0;
 	}
 
 	return true;
@@ -115,6 +146,7 @@ bool FusionSurgeryController::WriteAppConfig()
 	root.createChildItem("file-version", XML_FILE_VERSION_CONFIG_FUSION);
 	root.createChildItem("patient-nationality", m_sPatientNationality);
 	root.createChildItem("patient-data-folder", m_sPatientDataFolder);
+	root.createChildItem("merged-lesion-surfaces", m_bMergedLesionSurfaces ? 1 : 0);
 
 	QString sAppConfigFilePath = SYSTEM_CONFIG_FOLDER + QString("%1Config.xml").arg(APPLICATION_NAME);
 
@@ -176,7 +208,10 @@ int FusionSurgeryController::GoBackToState(int iState)
 
 		// the lesions are changed if they are incomplete
 		if(iState == STATE_MODEL)
+		{
 			m_pSurgery->SaveModel();
+			m_pModelAutosave->Discard();
+		}
 
 
 	}
@@ -280,12 +315,65 @@ bool FusionSurgeryController::EncryptCaseFile(QString sFilePath, QString sPasswo
 	return true;
 }
 
+class CaseJobTask : public QRunnable
+{
+public:
+	CaseJobTask(std::function<bool()> job, QEventLoop* pLoop, bool* pResult) : m_job(job), m_pLoop(pLoop), m_pResult(pResult) {}
+
+	void run()
+	{
+		*m_pResult = m_job();
+		QMetaObject::invokeMethod(m_pLoop, "quit", Qt::QueuedConnection);
+	}
+
+protected:
+	std::function<bool()> m_job;
+	QEventLoop* m_pLoop;
+	bool* m_pResult;
+};
+
+bool FusionSurgeryController::RunCaseJob(std::function<bool()> job)
+{
+	FUSION_TRACE_SCOPE("RunCaseJob", "case");
+
+	bool bResult = false;
+	QEventLoop loop;
+	QThreadPool::globalInstance()->start(new CaseJobTask(job, &loop, &bResult));
+	loop.exec(QEventLoop::ExcludeUserInputEvents); // quit is queued, so it cannot come before exec
+	return bResult;
+}
+
 // assumption is that the case is not encrypted with new password encryption.
 // it is either non encrypted at all or encrypted with the master password using crypto++ algo. 
 bool FusionSurgeryController::EncryptCase(QString sCaseDirPath, QString sDecryptPassword, QString sEncryptPassword)
 {
+	// the files added since the base class was written are staged first, see CaseEncryptor
+	CaseEncryptor encryptor;
+	connect(&encryptor, SIGNAL(progressChanged(int)), GetMainWindow(), SLOT(SetProgressValue(int)));
+
+	// the autosave would write the open case while its files are encrypted
+	m_pModelAutosave->Pause();
+	bool bEncrypted = RunCaseJob([&]()
+	{
+		if (!encryptor.Stage(sCaseDirPath, sDecryptPassword, sEncryptPassword))
+			return false;
 
-	return BaseSurgery::EncryptCase(sCaseDirPath,sDecryptPassword, sEncryptPassword);
+		if (!BaseSurgery::EncryptCase(sCaseDirPath, sDecryptPassword, sEncryptPassword))
+		{
+			encryptor.Discard();
+			return false;
+		}
+
+		return encryptor.Commit();
+	});
+
+	// the open case is reopened with the new password, its autosave must not write plain files into it
+	if (bEncrypted && m_pSurgery && QDir(m_pSurgery->GetCasePath()) == QDir(sCaseDirPath))
+		m_pModelAutosave->Stop();
+	else
+		m_pModelAutosave->Resume();
+
+	return bEncrypted;
 
 	/*// encrypt and decrypt surgery
 	QString sFilePathSurgery = sCaseDirPath + "/surgery.xml";
@@ -335,13 +423,56 @@ bool FusionSurgeryController::EncryptCase(QString sCaseDirPath, QString sDecrypt
 	return true;*/
 }
 
-bool FusionSurgeryController::OpenCase(QString sCaseDirPath, QString sPassword)
+bool FusionSurgeryController::ExportAnonymousCase(QString sPath)
+{
+	if (!m_pSurgery || m_pSurgery->GetCasePath() == "")
+		return false;
+
+	// the archive is named by the time, the case folder name may carry the patient id
+	QString sArchiveFile = sPath + "/AnonymousCase_" + QDateTime::currentDateTime().toString("yyyyMMdd_hhmmss") + ".zip";
+
+	// the files are encrypted again with the case password, an unencrypted case is exported plain
+	QString sPassword = m_pSurgery->GetEncryptCasePassword();
+	return ExportAnonymousCases(QStringList() << m_pSurgery->GetCasePath(), QStringList() << sPassword, sArchiveFile, sPassword);
+}
+
+bool FusionSurgeryController::ExportAnonymousCases(QStringList caseDirPaths, QStringList passwords, QString sArchiveFile, QString sArchivePassword, QStringList* pFailedCases)
+{
+	if (caseDirPaths.size() != passwords.size())
+		return false;
+
+	// each file is read once and written into the archive, see CaseExporter
+	CaseExporter exporter;
+	for (int i = 0; i < caseDirPaths.size(); i++)
+	{
+		if (!exporter.AddCase(caseDirPaths.at(i), passwords.at(i)))
+		{
+			FUSION_DLOG(FUSION_DLOG_WARNING, "case", "export-case-failed", FusionDebugLog::Fields()
+				.Add("case", caseDirPaths.at(i)));
+			if (pFailedCases)
+				pFailedCases->append(caseDirPaths.at(i));
+		}
+	}
+
+	if (exporter.GetNumCases() == 0)
+		return false;
+
+	connect(&exporter, SIGNAL(progressChanged(int)), GetMainWindow(), SLOT(SetProgressValue(int)));
+	return RunCaseJob([&]() { return exporter.Export(sArchiveFile, sArchivePassword, pFailedCases); });
+}
+
+bool FusionSurgeryController::OpenCase(QString sCaseDirPath, QString sPassword, bool bRecoverAutosave)
 {
+	FUSION_TRACE_SCOPE("OpenCase", "case");
+
 	// close case first
+	m_pModelAutosave->Stop();
 	if (m_pSurgery)
 		delete m_pSurgery;
+	GetMainWindow()->SetImageStackLoading(false);
 
 	m_pSurgery = new FusionSurgery;
+	connect(m_pSurgery, SIGNAL(imageStackLoaded()), this, SLOT(ImageStackLoaded()));
 
 	// load surgery.xml
 	QString sFilePathSurgery = sCaseDirPath + "/surgery.xml";
@@ -387,11 +518,12 @@ bool FusionSurgeryController::OpenCase(QString sCaseDirPath, QString sPassword)
 	{
 		// successful
 		pVisualEngine->UpdateImageStack(m_pSurgery->GetImageStack());
+		GetMainWindow()->SetImageStackLoading(m_pSurgery->IsImageStackLoading());
 		NewUrologyModel(MODEL_MODE_SEMIAUTO);
 	}
 
 	// load model
-	if (!m_pSurgery->LoadModel(sCaseDirPath, sPassword))
+	if (!m_pSurgery->LoadModel(sCaseDirPath, sPassword, bRecoverAutosave))
 	{
 		// failed to load model, need to create the prostate submodel
 		NewUrologyModel(MODEL_MODE_SEMIAUTO);
@@ -414,6 +546,7 @@ bool FusionSurgeryController::OpenCase(QString sCaseDirPath, QString sPassword)
 			QMap<int, inurbsSubModel*>* pUrologySubModels = model->GetSubModels();
 			inurbsModel* pLesionsModel = m_pSurgery->GetLesionsModel();
 			inurbsSubModel* pActiveSubModel = NULL;
+			QList<inurbsSubModel*> lesions;
 			for (int i = 0; i < ids.size(); ++i)
 			{
 				int id = ids.at(i);
@@ -438,11 +571,8 @@ bool FusionSurgeryController::OpenCase(QString sCaseDirPath, QString sPassword)
 
 					// add submodel to lesions
 					pLesionsModel->AddSubModel(id-4,lesionSubModel);
-					pVisualEngine->CreateLesionSubModelDisplayObject(lesionSubModel);
-					pVisualEngine->CreateLesionCurveDisplayObjects(lesionSubModel);
-					pVisualEngine->UpdateLesionSurfaceDisplayObject(lesionSubModel,lesionSubModel->GetSurface());
-					UpdateLesionInfo();
-	
+					lesions.append(lesionSubModel);
+
 					// set first submodel as the active model
 					if (!pActiveSubModel)
 						pActiveSubModel = lesionSubModel;
@@ -451,8 +581,10 @@ bool FusionSurgeryController::OpenCase(QString sCaseDirPath, QString sPassword)
 
 			if (pActiveSubModel)
 			{
-				pVisualEngine->SetActiveLesion(pActiveSubModel);
+				// display objects of all lesions at once, rendered when the case is shown
+				pVisualEngine->CreateLesionsDisplayObjects(lesions, pActiveSubModel);
 				pVisualEngine->ShowActiveLesionCentre();
+				UpdateLesionInfo();
 
 				SetState(STATE_LESION, STATE_LESION_MODEL_CREATED);
 				GetMainWindow()->UpdatePiradsControl();
@@ -464,9 +596,20 @@ bool FusionSurgeryController::OpenCase(QString sCaseDirPath, QString sPassword)
 	if(bEncryptedSurgery)
 		PdpRemove(sFilePathSurgery);
 
+	// a recovered model is kept in the autosave file until it is saved, one
+	// that was not recovered would be offered again
+	if (!bRecoverAutosave)
+		ModelAutosave::Remove(sCaseDirPath);
+	m_pModelAutosave->Start(m_pSurgery);
+
 	return true;
 }
 
+bool FusionSurgeryController::HasModelAutosave(QString sCaseDirPath)
+{
+	return ModelAutosave::IsNewer(sCaseDirPath);
+}
+
 void FusionSurgeryController::CloseCase()
 {
 	if(!m_pSurgery)
@@ -474,8 +617,17 @@ void FusionSurgeryController::CloseCase()
 
 	GetLogger()->SetCaseLogger("", m_pSurgery->GetEncryptCasePassword());
 
+	m_pModelAutosave->Stop();
+	m_pLesionSurfaceBuilder->ReleaseAll();
+	m_pCurvePickIndex->Clear();
+	m_pCurveEditHistory->Clear();
+
+	// one trace file per case session
+	FUSION_TRACE_DUMP("case");
+
 	delete m_pSurgery;
 	m_pSurgery = NULL;
+	GetMainWindow()->SetImageStackLoading(false);
 
 	ClearSubStateFlags(); // clear all sub states
 	SetSubStateFlag(STATE_START_FIRST);
@@ -535,65 +687,10 @@ bool FusionSurgeryController::ApproveImage()
 
 bool FusionSurgeryController::SaveImageStack8Bit(QString sPassword)
 {
-	ImageStack *pImageStack = m_pSurgery->GetImageStack();
-	if(!pImageStack || pImageStack->GetPixelSize() != 2) return false;
-
-	QString sCasePath = m_pSurgery->GetCasePath();
-
-	pImageStack->WriteImage(sCasePath, true, m_pSurgery->GetEncryptCasePassword());
-
-	typedef itk::Image<short,3> ImageType;
-	typedef itk::Image<unsigned char,3> OutputImageType;
-	typedef itk::IntensityWindowingImageFilter<ImageType,  OutputImageType>	WindowingFilterType;
-
-	int iPixelSize = pImageStack->GetPixelSize();
-	int *dim = pImageStack->GetDimension();
-	int iImageSize = dim[0]*dim[1]*dim[2];
-	unsigned char *pPixels = pImageStack->GetPixelsPtr();
-
-	int iWindowCenter, iWindowWidth;
-	pImageStack->GetWindowCenterWidthUser(iWindowCenter, iWindowWidth);
-	if(iWindowCenter == 0 && iWindowWidth == 0)
-		pImageStack->GetWindowCenterWidthDicom(iWindowCenter, iWindowWidth);
-
-	ImageType::SizeType size;
-	size[0] = dim[0];
-	size[1] = dim[1];
-	size[2] = dim[2];
-
-	ImageType::RegionType region;
-	region.SetSize(size);
-
-	ImageType::Pointer image = ImageType::New();
-	image->SetRegions(region);
-	image->Allocate();
-	memcpy(image->GetBufferPointer(), pPixels, iImageSize*iPixelSize);
-
-	WindowingFilterType::Pointer filter = WindowingFilterType::New();
-	filter->SetInput(image);
-
-	filter->SetWindowLevel(iWindowWidth, iWindowCenter);
-	filter->SetOutputMinimum(0);
-	filter->SetOutputMaximum(255);
-	filter->Update();
-
-	QString sImageFolder = sCasePath + "/image";
-	QString sFileDat = sImageFolder + "/" + IMAGE_FILE_NAME;
-	FILE *fp = fopen(sFileDat.toLatin1().data(), "wb");
-	if(!fp) return false;
-
-	bool bWriteOk = false;
-	if(fwrite(filter->GetOutput()->GetBufferPointer(), 1, iImageSize, fp) == iImageSize)
-		bWriteOk = true;
-
-	fclose(fp);
-
-#ifdef PDP_DATA
-	if (!PdpEncrypt2(sFileDat, sPassword))
+	if (!m_pSurgery)
 		return false;
-#endif
 
-	return bWriteOk;
+	return m_pSurgery->SaveImageStack8Bit(sPassword);
 }
 
 void FusionSurgeryController::DeleteImageStack()
@@ -602,6 +699,18 @@ void FusionSurgeryController::DeleteImageStack()
 		return;
 	m_pSurgery->DeleteImageStack();
 	GetVisualEngine()->UpdateImageStack(NULL);
+	GetMainWindow()->SetImageStackLoading(false);
+}
+
+bool FusionSurgeryController::IsImageStackLoading()
+{
+	return m_pSurgery && m_pSurgery->IsImageStackLoading();
+}
+
+void FusionSurgeryController::LoadImageSlice(double z)
+{
+	if (m_pSurgery)
+		m_pSurgery->LoadImageSlice(z);
 }
 
 void FusionSurgeryController::NewLesionsModel()
@@ -620,6 +729,7 @@ void FusionSurgeryController::CreateLeisionSubModel()
 	inurbsSubModel* pSubModel = m_pSurgery->CreateLesionSubModel();
 
 	GetVisualEngine()->CreateLesionSubModelDisplayObject(pSubModel);
+	m_pModelAutosave->MarkDirty(pSubModel);
 }
 
 void FusionSurgeryController::DeleteActiveLesionSubModel()
@@ -632,9 +742,13 @@ void FusionSurgeryController::DeleteActiveLesionSubModel()
 
 	// delete submodel display object
 	GetVisualEngine()->DeleteLesionSubModelDisplayObject(pLesion);
+	m_pLesionSurfaceBuilder->Release(pLesion);
+	m_pCurvePickIndex->Clear(); // its curves are deleted with it
+	m_pCurveEditHistory->RemoveLesion(pLesion);
 
 	// delete lesion submodel 
 	m_pSurgery->DeleteLesionSubModel(pLesion);
+	m_pModelAutosave->MarkDirty(pLesion);
 
 	// update labels texts after the deletion
 	GetVisualEngine()->UpdateAllLabelTexts();
@@ -693,39 +807,53 @@ void FusionSurgeryController::BuildLesionSurface(inurbsSubModel* pLesion)
 	if (!pLesion)
 		return;
 
+	// no more previews once the edit is finished
+	m_pLesionSurfaceBuilder->Cancel(pLesion);
+	m_pModelAutosave->MarkDirty(pLesion);
+
 	// get num of closed curves
 	int numClosedCurves = pLesion->GetNumOfClosedCurves();
 
 	double position = GetVisualEngine()->GetCurrentPlanePosition();
 	inurbsPlanarCurve* currentCurve = pLesion->GetCurve(position);
+	bool bRebuilt = false;
 
 	// do not build the model if the the current displayed slice has less then 3 points
 	// in the contour. It will delete away the loose points. 
 	if ((!currentCurve && numClosedCurves >= 2) || // no curve in current plane and there are more than 1 closed curves
 		(currentCurve && currentCurve->GetNumOfPoints() >= 3  && numClosedCurves >=2)) // curve in current plane and have more than 3 points
 	{
-		pLesion->BuildSurface();
-
-		GetVisualEngine()->UpdateLesionSurfaceDisplayObject(pLesion,pLesion->GetSurface());
-		UpdateLesionInfo();
+		bRebuilt = RebuildLesionSurface(pLesion);
 	}
 	else if (numClosedCurves == 1) // just one curve, show label
 	{
 		GetVisualEngine()->UpdateLesionCurveLabel(pLesion);
 	}
+
+	// the last drag preview is still displayed, put the lesion surface back as DeleteLesionCurve does
+	if (!bRebuilt && m_pLesionSurfaceBuilder->HasPreview(pLesion))
+	{
+		GetVisualEngine()->UpdateLesionSurfaceDisplayObject(pLesion,pLesion->GetSurface());
+		m_pLesionSurfaceBuilder->Release(pLesion);
+		UpdateLesionInfo();
+	}
 }
 
 void FusionSurgeryController::DeleteLesionCurve(inurbsSubModel* pLesion, double pos)
 {
 
+	m_pCurvePickIndex->Invalidate(pLesion->GetCurve(pos));
 	pLesion->RemoveCurve(pos);	
+	m_pModelAutosave->MarkDirty(pLesion);
 	int numCurves = pLesion->GetNumOfCurves();
 
 	if (numCurves == 1)
 	{
 		// remove surface if there are less than 2 curves
 		pLesion->RemoveSurface();
+		m_pSurgery->InvalidateLesionSurface(pLesion);
 		GetVisualEngine()->UpdateLesionSurfaceDisplayObject(pLesion,pLesion->GetSurface());
+		m_pLesionSurfaceBuilder->Release(pLesion);
 		UpdateLesionInfo();
 		SetState(STATE_LESION,STATE_LESION_FIRSTCURVE_CREATED);		
 	}
@@ -738,10 +866,142 @@ void FusionSurgeryController::DeleteLesionCurve(inurbsSubModel* pLesion, double
 	else // still maintain as a model
 	{
 		// should build surface again
+		RebuildLesionSurface(pLesion);
+	}
+}
+
+bool FusionSurgeryController::RebuildLesionSurface(inurbsSubModel* pLesion)
+{
+	if (!m_pSurgery || !pLesion)
+		return false;
+
+	// a mouse up without an actual edit (e.g. clicking on a point) keeps the current surface,
+	// unless a drag preview is displayed in its place
+	QList<double> dirtyPositions;
+	if (m_pSurgery->IsLesionSurfaceUpToDate(pLesion, &dirtyPositions) && pLesion->GetSurface()->IsSurfaceValid() &&
+		!m_pLesionSurfaceBuilder->HasPreview(pLesion))
+		return false;
+
+	FUSION_DLOG(FUSION_DLOG_DEBUG, "lesion", "surface-rebuild", FusionDebugLog::Fields()
+		.Add("lesion", pLesion->GetID()).Add("curves", pLesion->GetNumOfCurves()).Add("dirty-curves", dirtyPositions.size())
+		.Add("dirty-z-min", dirtyPositions.isEmpty() ? 0.0 : *std::min_element(dirtyPositions.begin(), dirtyPositions.end()))
+		.Add("dirty-z-max", dirtyPositions.isEmpty() ? 0.0 : *std::max_element(dirtyPositions.begin(), dirtyPositions.end())));
+
+	{
+		FUSION_TRACE_SCOPE("BuildSurface", "model");
+		QMutexLocker locker(LesionSurfaceBuilder::GetBuildMutex()); // a preview may be building
 		pLesion->BuildSurface();
-		GetVisualEngine()->UpdateLesionSurfaceDisplayObject(pLesion,pLesion->GetSurface());
-		UpdateLesionInfo();
 	}
+	m_pSurgery->SetLesionSurfaceBuilt(pLesion);
+
+	GetVisualEngine()->UpdateLesionSurfaceDisplayObject(pLesion,pLesion->GetSurface());
+	m_pLesionSurfaceBuilder->Release(pLesion); // preview surface no longer displayed
+	UpdateLesionInfo();
+	return true;
+}
+
+void FusionSurgeryController::PreviewLesionSurface(inurbsSubModel* pLesion)
+{
+	if (!m_pSurgery || !pLesion)
+		return;
+
+	// same condition as BuildLesionSurface
+	if (pLesion->GetNumOfClosedCurves() < 2)
+		return;
+
+	m_pLesionSurfaceBuilder->RequestBuild(pLesion);
+}
+
+bool FusionSurgeryController::UndoLesionEdit()
+{
+	inurbsSubModel* pLesion;
+	double z;
+	inurbsPoint* pPoints;
+	int iNumPoints;
+	if (!m_pSurgery || GetState() != STATE_LESION || !m_pCurveEditHistory->Undo(pLesion, z, pPoints, iNumPoints))
+		return false;
+
+	RestoreLesionCurve(pLesion, z, pPoints, iNumPoints);
+	return true;
+}
+
+bool FusionSurgeryController::RedoLesionEdit()
+{
+	inurbsSubModel* pLesion;
+	double z;
+	inurbsPoint* pPoints;
+	int iNumPoints;
+	if (!m_pSurgery || GetState() != STATE_LESION || !m_pCurveEditHistory->Redo(pLesion, z, pPoints, iNumPoints))
+		return false;
+
+	RestoreLesionCurve(pLesion, z, pPoints, iNumPoints);
+	return true;
+}
+
+void FusionSurgeryController::RestoreLesionCurve(inurbsSubModel* pLesion, double z, inurbsPoint* pPoints, int iNumPoints)
+{
+	// the curve deletion below works on the active lesion
+	if (GetVisualEngine()->GetActiveLesion() != pLesion)
+		GetVisualEngine()->SetActiveLesion(pLesion);
+
+	inurbsPlanarCurve* pCurve = pLesion->GetCurve(z);
+	if (iNumPoints == 0)
+	{
+		// the curve did not exist before the step
+		if (!pCurve)
+			return;
+
+		GetVisualEngine()->DeleteLesionCurveDisplayObject(pLesion, pCurve);
+		if (pLesion->GetNumOfCurves() > 1)
+			DeleteLesionCurve(pLesion, z);
+		else
+		{
+			// back to the lesion just created, DeleteLesionCurve would delete it and
+			// with it the step that redoes the curve
+			m_pCurvePickIndex->Invalidate(pCurve);
+			pLesion->RemoveCurve(z);
+			m_pModelAutosave->MarkDirty(pLesion);
+			SetState(STATE_LESION, STATE_LESION_CREATED);
+		}
+		GetVisualEngine()->Update2DWindows();
+		return;
+	}
+
+	if (!pCurve)
+	{
+		pCurve = pLesion->GetCurveStack()->CreateCurve(z);
+		GetVisualEngine()->CreateLesionCurveDisplayObject(pLesion, pCurve);
+	}
+
+	pCurve->SetPoints(pPoints, iNumPoints);
+	m_pCurvePickIndex->Invalidate(pCurve);
+	GetVisualEngine()->UpdateLesionCurveDisplayObject(pLesion, pCurve);
+
+	UpdateLesionModelState(pLesion);
+	BuildLesionSurface(pLesion);
+	GetVisualEngine()->UpdateSliceZ();
+	GetVisualEngine()->Update2DWindows();
+}
+
+void FusionSurgeryController::ImageStackLoaded()
+{
+	// the slices of a mapped load are all in, the transversal views only had the ones viewed,
+	// a load of a case closed in the meantime is ignored
+	if (!m_pSurgery || sender() != m_pSurgery)
+		return;
+
+	GetVisualEngine()->ImageStackLoaded();
+	GetMainWindow()->SetImageStackLoading(false);
+}
+
+void FusionSurgeryController::ShowLesionPreviewSurface(inurbsSubModel* pLesion, inurbsSubModel* pPreview)
+{
+	// deleted lesions cancel their builds, so pLesion is still valid here
+	if (!m_pSurgery)
+		return;
+
+	GetVisualEngine()->UpdateLesionSurfaceDisplayObject(pLesion, pPreview->GetSurface(), true);
+	UpdateLesionInfo(pLesion);
 }
 
 int FusionSurgeryController::AddCurveToLesionModel(inurbsSubModel* pActiveLesion, double x, double y, double z, inurbsPlanarCurve** curCurve)
@@ -781,7 +1041,7 @@ int FusionSurgeryController::GetPickedLesionPointIndex(inurbsSubModel* pActiveLe
 	*curve = curveStack->GetCurve(z);
 
 	if (*curve)
-		return (*curve)->GetPickedPointIndex(x,y);
+		return m_pCurvePickIndex->GetPickedPointIndex(*curve, x, y);
 
 	return -1;
 }
@@ -805,6 +1065,7 @@ int FusionSurgeryController::AddLesionPoint(inurbsSubModel* pActiveLesion, doubl
 	int pIndex = curve->AddPoint(x,y);
 	if (pIndex != -1) // point added successfully
 	{
+		m_pCurvePickIndex->PointAdded(curve, pIndex);
 
 		GetVisualEngine()->UpdateLesionCurveDisplayObject(pActiveLesion,curve);
 
@@ -867,6 +1128,7 @@ void FusionSurgeryController::SetActiveLesionRiskScore(int iScore)
 	if (!pActiveLesion)
 		return;
 	pActiveLesion->SetRiskScore(iScore);
+	m_pModelAutosave->MarkDirty(pActiveLesion);
 }
 
 bool FusionSurgeryController::ApproveLesionsModel(QString sRemarks)
@@ -877,10 +1139,14 @@ bool FusionSurgeryController::ApproveLesionsModel(QString sRemarks)
 	m_pSurgery->SaveImageStack(true, m_pSurgery->GetEncryptCasePassword());	// in case windowing values changes
 
 	SaveImageStack8Bit(m_pSurgery->GetEncryptCasePassword());
-	return m_pSurgery->SaveLesionsModel(sRemarks);
+	if (!m_pSurgery->SaveLesionsModel(sRemarks))
+		return false;
+
+	m_pModelAutosave->Discard();
+	return true;
 }
 
-void FusionSurgeryController::UpdateLesionInfo()
+void FusionSurgeryController::UpdateLesionInfo(inurbsSubModel* pEditingLesion)
 {
 	QString sLesionInfo = "";
 	if(m_pSurgery)
@@ -895,7 +1161,11 @@ void FusionSurgeryController::UpdateLesionInfo()
 				inurbsSubModel *pLesionModel = pUrologyModel->GetLesionModel(k);
 				if(pLesionModel)
 				{
-					double fLesionVolume = GetVisualEngine()->GetLesionVolume(pLesionModel);
+					double fLesionVolume;
+					if (pLesionModel == pEditingLesion)
+						fLesionVolume = FusionSurgery::GetCurveStackVolume(pLesionModel);
+					else
+						fLesionVolume = GetVisualEngine()->GetLesionVolume(pLesionModel); // cached until its surface changes
 					QString sLesionVolume = QString::number(fLesionVolume/1000, 'f', 2);
 
 					int iRiskScore = pLesionModel->GetRiskScore();
@@ -929,6 +1199,7 @@ void FusionSurgeryController::SetFirstLesionAsActive()
 void FusionSurgeryController::CleanModel(bool bRemoveModelFile)
 {
 	BaseSurgeryController::CleanModel();
+	m_pModelAutosave->Discard(); // the lesions are gone with the model
 
 	if(bRemoveModelFile)
 	{
@@ -936,6 +1207,11 @@ void FusionSurgeryController::CleanModel(bool bRemoveModelFile)
 		QString sModelFolder = GetFolderPath(m_pSurgery->GetCasePath(), "model");
 		QString sModelPath = sModelFolder + "/" + XML_FILE_NAME_MODEL;
 		QFile::remove(sModelPath);
+
+		// the binary copy goes with model.xml
+		QString sBinaryPath = sModelFolder + "/" + MODEL_BINARY_FILE_NAME;
+		QFile::remove(sBinaryPath);
+		QFile::remove(sBinaryPath + ENCRYPTION_FILE_EXTENSION);
 	}
 }
 
@@ -954,7 +1230,12 @@ void FusionSurgeryController::CleanLesion()
 		return;
 
 	pUrologyModel->DeleteAllLesionSubModels();
+	m_pSurgery->InvalidateLesionSurface();
 	GetVisualEngine()->CleanLesion();
+	m_pLesionSurfaceBuilder->ReleaseAll();
+	m_pCurvePickIndex->Clear();
+	m_pCurveEditHistory->Clear();
+	m_pModelAutosave->InvalidateSnapshot();
 }
 
 void FusionSurgeryController::SelectFirstLesion()
@@ -1026,9 +1307,14 @@ void FusionSurgeryController::CleanIncompleteLesionCurves()
 	for (int i = 0; i < deleteList.size();i++)
 	{
 		inurbsSubModel* pLesionSubModel = deleteList.at(i);
+		m_pLesionSurfaceBuilder->Release(pLesionSubModel);
 		m_pSurgery->DeleteLesionSubModel(pLesionSubModel);
 	}
 
+	m_pCurvePickIndex->Clear();
+	m_pCurveEditHistory->Clear();
+	m_pModelAutosave->InvalidateSnapshot();
+
 }
 
 void FusionSurgeryController::CleanIncompleteLesions()
@@ -1052,9 +1338,14 @@ void FusionSurgeryController::CleanIncompleteLesions()
 	{
 		inurbsSubModel* pLesionSubModel = deleteList.at(i);
 		GetVisualEngine()->DeleteLesionSubModelDisplayObject(pLesionSubModel);
+		m_pLesionSurfaceBuilder->Release(pLesionSubModel);
 		m_pSurgery->DeleteLesionSubModel(pLesionSubModel);
 	}
 
+	m_pCurvePickIndex->Clear();
+	m_pCurveEditHistory->Clear();
+	m_pModelAutosave->InvalidateSnapshot();
+
 	// update labels texts after the deletion
 	GetVisualEngine()->UpdateAllLabelTexts();
 
@@ -1063,6 +1354,9 @@ void FusionSurgeryController::CleanIncompleteLesions()
 
 void FusionSurgeryController::ExitApp()
 {
+	FUSION_TRACE_DUMP("exit");
+	FusionDebugLog::Shutdown();
+
 	Sleep(1000);
 	QApplication::exit(0);
 }
@@ -1073,6 +1367,7 @@ void FusionSurgeryController::ExitApp()
 
 bool FusionSurgeryController::LoadRTStructModel(QStringList files, QString sRTStructFilename, QString sPassword)
 {
+	FUSION_TRACE_SCOPE("LoadRTStructModel", "case");
 
 	if (!m_pSurgery)
 		return false;
@@ -1084,6 +1379,7 @@ bool FusionSurgeryController::LoadRTStructModel(QStringList files, QString sRTSt
 	// convert RT contours to model
 	if (!m_pSurgery->ConvertRTContoursToModel(files, sPassword))
 		return false;
+	m_pModelAutosave->InvalidateSnapshot();
 
 	GetVisualEngine()->UpdateImageStack(m_pSurgery->GetImageStack());
 	
@@ -1113,6 +1409,7 @@ bool FusionSurgeryController::LoadRTStructModel(QStringList files, QString sRTSt
 	// create lesion curves and model display objects
 	inurbsModel* pLesionsModel = m_pSurgery->GetLesionsModel();
 	int iNumLesions = pLesionsModel->GetSubModelCount();
+	QList<inurbsSubModel*> lesions;
 
 	for (int i = 0;i < iNumLesions;i++)
 	{
@@ -1122,13 +1419,23 @@ bool FusionSurgeryController::LoadRTStructModel(QStringList files, QString sRTSt
 			continue;
 
 		}
-		int id = pLesionSubModel->GetID();
-		GetVisualEngine()->CreateLesionSubModelDisplayObject(pLesionSubModel);
-		GetVisualEngine()->CreateLesionCurveDisplayObjects(pLesionSubModel);
-		GetVisualEngine()->UpdateLesionSurfaceDisplayObject(pLesionSubModel, pLesionSubModel->GetSurface());
-		BuildLesionSurface(pLesionSubModel);
-		UpdateLesionInfo();
 
+		// the conversion builds the surfaces, only build what it left out
+		if (pLesionSubModel->GetNumOfClosedCurves() >= 2 &&
+			!(m_pSurgery->IsLesionSurfaceUpToDate(pLesionSubModel) && pLesionSubModel->GetSurface()->IsSurfaceValid()))
+		{
+			FUSION_TRACE_SCOPE("BuildSurface", "model");
+			QMutexLocker locker(LesionSurfaceBuilder::GetBuildMutex());
+			pLesionSubModel->BuildSurface();
+			m_pSurgery->SetLesionSurfaceBuilt(pLesionSubModel);
+		}
+		lesions.append(pLesionSubModel);
+	}
+
+	if (!lesions.isEmpty())
+	{
+		GetVisualEngine()->CreateLesionsDisplayObjects(lesions, lesions.last());
+		UpdateLesionInfo();
 	}
 
 
@@ -9,9 +9,16 @@
  
 #include "BaseSurgeryController.h"
 
+#include <functional>
+
 class FusionSurgery;
 class inurbsSubModel;
 class DicomDirImporter;
+class LesionSurfaceBuilder;
+class CurvePickIndex;
+class CurveEditHistory;
+class ModelAutosave;
+class inurbsPoint;
 
 class FusionSurgeryController : public BaseSurgeryController
 {
@@ -30,6 +37,7 @@ public:
 
 	// patient nationality setting
 	QString GetPatientNationality() { return m_sPatientNationality; }
+	bool IsMergedLesionSurfaces() { return m_bMergedLesionSurfaces; } // inactive lesions drawn as one actor in the 3D view
 	void SetPatientNationality(QString sNationality);
 
 
@@ -38,10 +46,14 @@ public:
 	// Case functions
 	bool EncryptCase(QString sCaseDirPath, QString sDecryptPassword, QString sEncryptPassword);
 	bool EncryptCaseFile(QString sFilePath, QString sPassword="");
+	bool ExportAnonymousCase(QString sPath); // the open case as a zip archive in the folder sPath
+	// a case that cannot be exported is left out and added to pFailedCases, false if no case is exported
+	bool ExportAnonymousCases(QStringList caseDirPaths, QStringList passwords, QString sArchiveFile, QString sArchivePassword="", QStringList* pFailedCases=NULL);
 
 	// Surgery functions
 //	bool CreateSurgery(QString sPatientDataFolder, QString sCaseId);
-	bool OpenCase(QString sCaseDirPath, QString sPassword="");
+	bool OpenCase(QString sCaseDirPath, QString sPassword="", bool bRecoverAutosave=false);
+	bool HasModelAutosave(QString sCaseDirPath); // autosaved lesions newer than the saved model
 	void CloseCase();
 
 	// Import Image stage functions
@@ -53,6 +65,8 @@ public:
 	bool ApproveImage();
 	void DeleteImageStack();
 	bool SaveImageStack8Bit(QString sPassword="");
+	bool IsImageStackLoading(); // slices of a mapped load are still being copied in
+	void LoadImageSlice(double z); // the slice at z is copied before the transversal views show it
 
 	// lesion model functions
 	void NewLesionsModel();
@@ -64,14 +78,19 @@ public:
 	inurbsSubModel* GetNextLesionSubModel(inurbsSubModel* pCurLesion);
 	inurbsSubModel* GetPrevLesionSubModel(inurbsSubModel* pPrevLesion);
 	void BuildLesionSurface(inurbsSubModel* pLesion);
+	void PreviewLesionSurface(inurbsSubModel* pLesion); // background build while points are dragged
 	void DeleteLesionCurve(inurbsSubModel* pLesion, double pos);
 	int AddCurveToLesionModel(inurbsSubModel* pActiveLesion, double x, double y, double z, inurbsPlanarCurve** curCurve);
 	int GetPickedLesionPointIndex(inurbsSubModel* pActiveLesion, double x, double y, double z, inurbsPlanarCurve** curve);
 	int AddLesionPoint(inurbsSubModel* pActiveLesion, double x, double y, double z, inurbsPlanarCurve** curCurve);
+	CurvePickIndex* GetCurvePickIndex() { return m_pCurvePickIndex; } // report point edits made outside the controller
+	CurveEditHistory* GetCurveEditHistory() { return m_pCurveEditHistory; }
+	bool UndoLesionEdit();
+	bool RedoLesionEdit();
 	void UpdateLesionModelState(inurbsSubModel* pActiveLesion);
 	void SetActiveLesionRiskScore(int iScore);
 	bool ApproveLesionsModel(QString sRemarks);
-	void UpdateLesionInfo();
+	void UpdateLesionInfo(inurbsSubModel* pEditingLesion = NULL); // the editing lesion uses the curve stack volume
 	void SetFirstLesionAsActive();
 
 	// RTStruct functions
@@ -93,15 +112,30 @@ protected:
 	bool ReadAppConfig();
 	bool WriteAppConfig();
 
+	bool RebuildLesionSurface(inurbsSubModel* pLesion); // returns false if the surface was already up to date
+	void RestoreLesionCurve(inurbsSubModel* pLesion, double z, inurbsPoint* pPoints, int iNumPoints);
+
+	// runs a case job (encrypt, export) on the thread pool, the main window keeps
+	// painting and showing progress but takes no input until the job is done
+	bool RunCaseJob(std::function<bool()> job);
+
 protected:
 	static FusionSurgeryController* m_pInstance;
 
 	// surgery variable
 	QString m_sPatientNationality;
 	QString m_sPatientDataFolder;
+	bool m_bMergedLesionSurfaces;
+
+	LesionSurfaceBuilder* m_pLesionSurfaceBuilder;
+	CurvePickIndex* m_pCurvePickIndex;
+	CurveEditHistory* m_pCurveEditHistory;
+	ModelAutosave* m_pModelAutosave;
 
 protected slots:
 	void SelectFirstLesion();
+	void ShowLesionPreviewSurface(inurbsSubModel* pLesion, inurbsSubModel* pPreview);
+	void ImageStackLoaded();
 };
 
 #endif
\ No newline at end of file
@@ -0,0 +1,280 @@
+/******************************************************************************
+	FusionTrace.cpp
+
+	Date      : 18 Oct 2026
+******************************************************************************/
+
+#include <QCoreApplication>
+#include <QDateTime>
+#include <QDir>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QMutex>
+#include <QMutexLocker>
+#include <QTextStream>
+#include <QThread>
+#include <QVector>
+
+#include "FusionTrace.h"
+
+#define TRACE_BUFFER_SIZE 16384 // events kept per thread, oldest are overwritten
+#define TRACE_MAX_BUFFERS 64 // above this the buffers of exited threads are reused even if they hold events
+
+namespace
+{
+	// one per thread, only the owning thread writes, the dump reads under the mutex
+	struct TraceBuffer
+	{
+		QMutex mutex;
+		QVector<FusionTrace::Event> events;
+		int iNext;
+		bool bWrapped;
+		int iThreadIndex;
+		QString sThreadName;
+	};
+
+	// gives the buffer back to the registry when its thread exits
+	struct TraceBufferOwner
+	{
+		TraceBuffer* pBuffer;
+
+		TraceBufferOwner() { pBuffer = NULL; }
+		~TraceBufferOwner();
+	};
+
+	QElapsedTimer StartClock()
+	{
+		QElapsedTimer clock;
+		clock.start();
+		return clock;
+	}
+
+	const QElapsedTimer& GetClock()
+	{
+		static const QElapsedTimer clock = StartClock();
+		return clock;
+	}
+
+	QMutex g_registryMutex;
+	QList<TraceBuffer*> g_buffers;
+	QList<TraceBuffer*> g_freeBuffers; // of exited threads, oldest first, their events stay until reused
+	int g_iNextThreadIndex = 1;
+	QString g_sTraceFolder;
+
+	thread_local TraceBuffer* t_pBuffer = NULL;
+	thread_local TraceBufferOwner t_bufferOwner;
+
+	TraceBufferOwner::~TraceBufferOwner()
+	{
+		if (!pBuffer)
+			return;
+
+		QMutexLocker locker(&g_registryMutex);
+		g_freeBuffers.append(pBuffer);
+	}
+
+	// a free buffer that is empty, or the oldest free one once the registry is full
+	TraceBuffer* TakeFreeBuffer()
+	{
+		for (int i = 0; i < g_freeBuffers.size(); i++)
+		{
+			TraceBuffer* pBuffer = g_freeBuffers.at(i);
+			QMutexLocker bufferLocker(&pBuffer->mutex);
+			if (pBuffer->iNext == 0 && !pBuffer->bWrapped)
+				return g_freeBuffers.takeAt(i);
+		}
+
+		if (g_buffers.size() < TRACE_MAX_BUFFERS || g_freeBuffers.isEmpty())
+			return NULL;
+
+		return g_freeBuffers.takeFirst();
+	}
+
+	TraceBuffer* GetThreadBuffer()
+	{
+		if (t_pBuffer)
+			return t_pBuffer;
+
+		QString sThreadName;
+		QThread* pThread = QThread::currentThread();
+		if (QCoreApplication::instance() && pThread == QCoreApplication::instance()->thread())
+			sThreadName = "main";
+		else
+			sThreadName = pThread->objectName();
+
+		QMutexLocker locker(&g_registryMutex);
+		TraceBuffer* pBuffer = TakeFreeBuffer();
+		if (!pBuffer)
+		{
+			pBuffer = new TraceBuffer;
+			pBuffer->events.resize(TRACE_BUFFER_SIZE);
+			g_buffers.append(pBuffer);
+		}
+
+		// a new thread index, the trace would merge the threads otherwise
+		QMutexLocker bufferLocker(&pBuffer->mutex);
+		pBuffer->iNext = 0;
+		pBuffer->bWrapped = false;
+		pBuffer->iThreadIndex = g_iNextThreadIndex++;
+		pBuffer->sThreadName = sThreadName.isEmpty() ? QString("thread %1").arg(pBuffer->iThreadIndex) : sThreadName;
+
+		t_pBuffer = pBuffer;
+		t_bufferOwner.pBuffer = pBuffer;
+		return pBuffer;
+	}
+
+	// quotes, backslashes and control characters, thread names can hold any of them
+	QString EscapeJson(QString sText)
+	{
+		QString sEscaped;
+		sEscaped.reserve(sText.size());
+		for (int i = 0; i < sText.size(); i++)
+		{
+			QChar c = sText.at(i);
+			if (c == '\\' || c == '"')
+				sEscaped += QString("\\") + c;
+			else if (c.unicode() < 0x20)
+				sEscaped += QString("\\u%1").arg(c.unicode(), 4, 16, QChar('0'));
+			else
+				sEscaped += c;
+		}
+		return sEscaped;
+	}
+
+	QString EscapeJson(const char* pText)
+	{
+		return EscapeJson(QString::fromLatin1(pText));
+	}
+}
+
+std::atomic<bool> FusionTrace::m_bEnabled(qEnvironmentVariableIntValue("FUSION_TRACE") != 0);
+
+/******************************************************************************/
+/* Recording
+/******************************************************************************/
+
+void FusionTrace::SetEnabled(bool bEnabled)
+{
+	// start the clock before the first event
+	GetClock();
+	m_bEnabled.store(bEnabled, std::memory_order_relaxed);
+}
+
+qint64 FusionTrace::Now()
+{
+	return GetClock().nsecsElapsed();
+}
+
+void FusionTrace::AddEvent(const char* pName, const char* pCategory, qint64 iStartNs, qint64 iDurationNs)
+{
+	TraceBuffer* pBuffer = GetThreadBuffer();
+
+	QMutexLocker locker(&pBuffer->mutex);
+	Event& event = pBuffer->events[pBuffer->iNext];
+	event.pName = pName;
+	event.pCategory = pCategory;
+	event.iStartNs = iStartNs;
+	event.iDurationNs = iDurationNs;
+
+	if (++pBuffer->iNext == TRACE_BUFFER_SIZE)
+	{
+		pBuffer->iNext = 0;
+		pBuffer->bWrapped = true;
+	}
+}
+
+void FusionTrace::Clear()
+{
+	QMutexLocker locker(&g_registryMutex);
+	for (int i = 0; i < g_buffers.size(); i++)
+	{
+		QMutexLocker bufferLocker(&g_buffers.at(i)->mutex);
+		g_buffers.at(i)->iNext = 0;
+		g_buffers.at(i)->bWrapped = false;
+	}
+}
+
+/******************************************************************************/
+/* Output
+/******************************************************************************/
+
+bool FusionTrace::WriteChromeTrace(QString sFilePath)
+{
+	QFile file(sFilePath);
+	if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate | QIODevice::Text))
+		return false;
+
+	qint64 iPid = QCoreApplication::applicationPid();
+
+	QTextStream out(&file);
+	out.setCodec("UTF-8");
+	out << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n";
+
+	bool bFirst = true;
+	QMutexLocker locker(&g_registryMutex);
+	for (int i = 0; i < g_buffers.size(); i++)
+	{
+		TraceBuffer* pBuffer = g_buffers.at(i);
+		QMutexLocker bufferLocker(&pBuffer->mutex);
+
+		// thread name metadata
+		if (!bFirst)
+			out << ",\n";
+		bFirst = false;
+		out << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":" << iPid << ",\"tid\":" << pBuffer->iThreadIndex
+			<< ",\"args\":{\"name\":\"" << EscapeJson(pBuffer->sThreadName) << "\"}}";
+
+		// oldest event first
+		int iCount = pBuffer->bWrapped ? TRACE_BUFFER_SIZE : pBuffer->iNext;
+		int iStart = pBuffer->bWrapped ? pBuffer->iNext : 0;
+		for (int j = 0; j < iCount; j++)
+		{
+			const Event& event = pBuffer->events.at((iStart + j) % TRACE_BUFFER_SIZE);
+			out << ",\n{\"name\":\"" << EscapeJson(event.pName) << "\",\"cat\":\"" << EscapeJson(event.pCategory)
+				<< "\",\"ph\":\"X\",\"ts\":" << QString::number(event.iStartNs / 1000.0, 'f', 3)
+				<< ",\"dur\":" << QString::number(event.iDurationNs / 1000.0, 'f', 3)
+				<< ",\"pid\":" << iPid << ",\"tid\":" << pBuffer->iThreadIndex << "}";
+		}
+	}
+
+	out << "\n]}\n";
+	out.flush();
+	file.close();
+	return true;
+}
+
+bool FusionTrace::DumpSession(QString sTag)
+{
+	if (!IsEnabled())
+		return false;
+
+	QString sFolder = GetTraceFolder();
+	if (!QDir().mkpath(sFolder))
+		return false;
+
+	QString sFileName = "fusion_trace_" + QDateTime::currentDateTime().toString("yyyyMMdd_hhmmss");
+	if (!sTag.isEmpty())
+		sFileName += "_" + sTag;
+
+	bool bOk = WriteChromeTrace(sFolder + "/" + sFileName + ".json");
+	Clear();
+	return bOk;
+}
+
+QString FusionTrace::GetTraceFolder()
+{
+	QMutexLocker locker(&g_registryMutex);
+	if (!g_sTraceFolder.isEmpty())
+		return g_sTraceFolder;
+
+	QString sFolder = QString::fromLocal8Bit(qgetenv("FUSION_TRACE_DIR"));
+	if (sFolder.isEmpty())
+		sFolder = QDir::tempPath() + "/FusionTrace";
+	return sFolder;
+}
+
+void FusionTrace::SetTraceFolder(QString sFolder)
+{
+	QMutexLocker locker(&g_registryMutex);
+	g_sTraceFolder = sFolder;
+}
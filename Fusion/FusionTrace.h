@@ -0,0 +1,83 @@
+/******************************************************************************
+	FusionTrace.h
+
+	Date      : 18 Oct 2026
+******************************************************************************/
+
+#ifndef FUSION_TRACE_H
+#define FUSION_TRACE_H
+
+#include <atomic>
+#include <QString>
+
+// Scoped timers for the hot paths. Every thread records into its own ring
+// buffer, the buffers are merged into a Chrome trace JSON file (viewable in
+// chrome://tracing or ui.perfetto.dev) when the session is dumped.
+//
+// Trace points are only compiled in when FUSION_TRACE is defined, and only
+// record when tracing is enabled at runtime, either by SetEnabled() or by
+// setting the environment variable FUSION_TRACE=1 before starting the app.
+class FusionTrace
+{
+public:
+	// names and categories must be string literals, only the pointer is stored
+	struct Event
+	{
+		const char* pName;
+		const char* pCategory;
+		qint64 iStartNs;
+		qint64 iDurationNs;
+	};
+
+	static bool IsEnabled() { return m_bEnabled.load(std::memory_order_relaxed); }
+	static void SetEnabled(bool bEnabled);
+
+	static qint64 Now();
+	static void AddEvent(const char* pName, const char* pCategory, qint64 iStartNs, qint64 iDurationNs);
+
+	static bool WriteChromeTrace(QString sFilePath);
+	static bool DumpSession(QString sTag = "");
+	static void Clear();
+
+	// folder for DumpSession, default is FUSION_TRACE_DIR or the temp folder
+	static QString GetTraceFolder();
+	static void SetTraceFolder(QString sFolder);
+
+protected:
+	static std::atomic<bool> m_bEnabled;
+};
+
+class FusionTraceScope
+{
+public:
+	FusionTraceScope(const char* pName, const char* pCategory)
+	{
+		m_pName = pName;
+		m_pCategory = pCategory;
+		m_iStartNs = FusionTrace::IsEnabled() ? FusionTrace::Now() : -1;
+	}
+
+	~FusionTraceScope()
+	{
+		if (m_iStartNs >= 0)
+			FusionTrace::AddEvent(m_pName, m_pCategory, m_iStartNs, FusionTrace::Now() - m_iStartNs);
+	}
+
+protected:
+	const char* m_pName;
+	const char* m_pCategory;
+	qint64 m_iStartNs;
+};
+
+#define FUSION_TRACE_CONCAT_INNER(a, b) a##b
+#define FUSION_TRACE_CONCAT(a, b) FUSION_TRACE_CONCAT_INNER(a, b)
+
+#ifdef FUSION_TRACE
+#define FUSION_TRACE_SCOPE(name, category) FusionTraceScope FUSION_TRACE_CONCAT(traceScope, __LINE__)(name, category)
+#define FUSION_TRACE_DUMP(tag) FusionTrace::DumpSession(tag)
+#else
+#define FUSION_TRACE_SCOPE(name, category)
+#define FUSION_TRACE_DUMP(tag)
+#endif
+
+#endif
@@ -13,6 +13,10 @@
 #include "inurbsSubModel.h"
 #include "inurbsPlanarCurveStack.h"
 #include "qvOrthoImageSlicePipeline.h"
+#include "FusionTrace.h"
+#include "FusionSurgeryController.h"
+
+#include <vtkPolyData.h>
 
 FusionVisualEngine* FusionVisualEngine::m_pInstance = 0;
 
@@ -36,10 +40,22 @@ FusionVisualEngine::FusionVisualEngine()
 	m_pVolumeDisplayObject = new VolumeDisplayObject;
 	m_pModelDisplayObject = new ModelDisplayObject;
 	m_pLesionsModelDisplayObject = new LesionsModelDisplayObject;
+	m_pLesionsModelDisplayObject->SetMergedSurfaces(FusionSurgeryController::GetInstance()->IsMergedLesionSurfaces());
+	if (m_pLesionsModelDisplayObject->IsMergedSurfaces())
+		m_pLesionsModelDisplayObject->AddMergedSurfaceActors(m_pVirtualContext->getRenderer());
+
+	// coalesce render requests into one render per window and event loop turn
+	m_iDirtyContexts = 0;
+	m_iDeferredResets = 0;
+	m_renderTimer.setSingleShot(true);
+	m_renderTimer.setInterval(0);
+	connect(&m_renderTimer, SIGNAL(timeout()), this, SLOT(FlushRender()));
 }
 
 FusionVisualEngine::~FusionVisualEngine()
 {
+	m_renderTimer.stop();
+
 	// remove display objects first before removing the contexts
 	// as they are added to the renderers inside the contexts.
 	// If the contexts are removed first, the destructors of the props
@@ -118,6 +134,9 @@ void FusionVisualEngine::Init()
 
 void FusionVisualEngine::UpdateState(int state, int subState)
 {
+	// state changes switch renderers and visibility, reapply everything on the next slice update
+	m_pLesionsModelDisplayObject->InvalidatePositionIndex();
+
 	switch (state)
 	{
 		case BaseSurgeryController::STATE_IMPORT_IMAGE:
@@ -157,12 +176,12 @@ void FusionVisualEngine::UpdateState(int state, int subState)
 
 				case BaseSurgeryController::STATE_MODEL_FIRSTCURVE_CREATED:
 					m_pModelDisplayObject->SetLimitsVisible(true);
-					m_pSagittalImageContext->updateWindow();
+					RequestRender(RENDER_SAGITTAL);
 					break;
 
 				case BaseSurgeryController::STATE_MODEL_AUTOMODELLING:
 					m_pModelDisplayObject->SetLimitsVisible(false);
-					m_pSagittalImageContext->updateWindow();
+					RequestRender(RENDER_SAGITTAL);
 				break;
 
 				case BaseSurgeryController::STATE_MODEL_AUTOMODEL_DONE:
@@ -257,6 +276,13 @@ void FusionVisualEngine::SetTool(int context, int tool)
 
 void FusionVisualEngine::ResetView(int context)
 {
+	// these views read across all slices, they are reset once all are in
+	if (IsImageStackLoading() && (context == CONTEXT_SAGITTAL || context == CONTEXT_CORONAL || context == CONTEXT_VIRTUAL))
+	{
+		m_iDeferredResets |= context == CONTEXT_SAGITTAL ? RENDER_SAGITTAL : (context == CONTEXT_CORONAL ? RENDER_CORONAL : RENDER_VIRTUAL);
+		return;
+	}
+
 	switch (context)
 	{
 		case CONTEXT_MODELLING_TRANSVERSAL:
@@ -299,6 +325,8 @@ void FusionVisualEngine::Reset3DView()
 
 void FusionVisualEngine::TransversalImageContextViewChanged()
 {
+	FUSION_TRACE_SCOPE("TransversalImageContextViewChanged", "render");
+
 	BaseVisualEngine::TransversalImageContextViewChanged();
 
 	int state = GetController()->GetState();
@@ -306,7 +334,7 @@ void FusionVisualEngine::TransversalImageContextViewChanged()
 	{
 		case BaseSurgeryController::STATE_LESION:
 			m_pVolumeDisplayObject->UpdateCursorGuidePositions(m_pLesionModellingTransversalImageContext);
-			m_pLesionModellingTransversalImageContext->updateWindow();
+			RequestRender(RENDER_LESION_TRANSVERSAL);
 		break;
 
 		default:
@@ -317,42 +345,84 @@ void FusionVisualEngine::TransversalImageContextViewChanged()
 void FusionVisualEngine::Update2DWindows()
 {
 	int state = GetController()->GetState();
+	int iContexts = RENDER_SAGITTAL | RENDER_CORONAL;
 
 	if (state == BaseSurgeryController::STATE_IMPORT_IMAGE || state == BaseSurgeryController::STATE_MODEL)
-		m_pModellingTransversalImageContext->updateWindow();
+		iContexts |= RENDER_MODELLING_TRANSVERSAL;
 	else if (state == BaseSurgeryController::STATE_LESION || state == BaseSurgeryController::STATE_FINISH)
-		m_pLesionModellingTransversalImageContext->updateWindow();
+		iContexts |= RENDER_LESION_TRANSVERSAL;
 
-	m_pSagittalImageContext->updateWindow();
-	m_pCoronalImageContext->updateWindow();	
+	RequestRender(iContexts);
 }
 
 void FusionVisualEngine::UpdateWindows()
 {
 	int iState = GetController()->GetState();
+	int iContexts = RENDER_SAGITTAL | RENDER_CORONAL | RENDER_VIRTUAL;
 
 	switch (iState)
 	{
 		case BaseSurgeryController::STATE_IMPORT_IMAGE:
 		case BaseSurgeryController::STATE_MODEL:
-			m_pModellingTransversalImageContext->updateWindow();
+			iContexts |= RENDER_MODELLING_TRANSVERSAL;
 		break;
 
 		case BaseSurgeryController::STATE_LESION:
-			m_pLesionModellingTransversalImageContext->updateWindow();
+			iContexts |= RENDER_LESION_TRANSVERSAL;
 		break;
 
 		case BaseSurgeryController::STATE_FINISH:
-			m_pLesionModellingTransversalImageContext->updateWindow();
+			iContexts |= RENDER_LESION_TRANSVERSAL;
 		break;
 
 		default:
 		break;
 	}
 
-	m_pSagittalImageContext->updateWindow();
-	m_pCoronalImageContext->updateWindow();	
-	m_pVirtualContext->updateWindow();
+	RequestRender(iContexts);
+}
+
+void FusionVisualEngine::RequestRender(int iContexts)
+{
+	m_iDirtyContexts |= iContexts;
+	if (!m_renderTimer.isActive())
+		m_renderTimer.start();
+}
+
+void FusionVisualEngine::FlushRender()
+{
+	m_renderTimer.stop();
+
+	int iContexts = m_iDirtyContexts;
+	m_iDirtyContexts = 0;
+
+	// while a mapped load copies the slices, the sagittal, coronal and 3D views wait for
+	// all of them and the transversal views get their slice copied before they render
+	if (IsImageStackLoading())
+	{
+		iContexts &= ~(RENDER_SAGITTAL | RENDER_CORONAL | RENDER_VIRTUAL);
+		if (iContexts)
+			FusionSurgeryController::GetInstance()->LoadImageSlice(m_pVolumeDisplayObject->GetZSlicePipeline()->getSliceCoordinate());
+	}
+
+	if (!iContexts)
+		return;
+
+	FUSION_TRACE_SCOPE("FlushRender", "render");
+
+	if (iContexts & RENDER_MODELLING_TRANSVERSAL)
+		m_pModellingTransversalImageContext->updateWindow();
+	if (iContexts & RENDER_LESION_TRANSVERSAL)
+		m_pLesionModellingTransversalImageContext->updateWindow();
+	if (iContexts & RENDER_SAGITTAL)
+		m_pSagittalImageContext->updateWindow();
+	if (iContexts & RENDER_CORONAL)
+		m_pCoronalImageContext->updateWindow();
+	if (iContexts & RENDER_VIRTUAL)
+	{
+		m_pLesionsModelDisplayObject->UpdateMergedSurfaces();
+		m_pVirtualContext->updateWindow();
+	}
 }
 
 /******************************************************************************/
@@ -360,7 +430,11 @@ void FusionVisualEngine::UpdateWindows()
 /******************************************************************************/
 void FusionVisualEngine::UpdateSliceZ()
 {
+	FUSION_TRACE_SCOPE("UpdateSliceZ", "render");
+
 	double position = m_pVolumeDisplayObject->GetZSlicePipeline()->getSliceCoordinate();
+	FusionSurgeryController::GetInstance()->LoadImageSlice(position); // scrolled to a slice not copied in yet
+
 	int state = GetController()->GetState();
 	switch (state)
 	{
@@ -431,7 +505,7 @@ void FusionVisualEngine::ResetTransversalView(TransversalImageContext* pContext)
 
 	if (pContext->GetContext() == CONTEXT_MODELLING_TRANSVERSAL || pContext->GetContext() == CONTEXT_LESION_TRANSVERSAL)
 		TransversalImageContextViewChanged();
-	else
+	else if (!IsImageStackLoading())
 		pContext->updateWindow();
 }
 
@@ -448,6 +522,27 @@ void FusionVisualEngine::UpdateImageImport()
 	Update2DWindows();
 }
 
+void FusionVisualEngine::ImageStackLoaded()
+{
+	int iResets = m_iDeferredResets;
+	m_iDeferredResets = 0;
+
+	if (iResets & RENDER_SAGITTAL)
+		ResetView(CONTEXT_SAGITTAL);
+	if (iResets & RENDER_CORONAL)
+		ResetView(CONTEXT_CORONAL);
+	if (iResets & RENDER_VIRTUAL)
+		ResetView(CONTEXT_VIRTUAL);
+
+	UpdateImageImport();
+	UpdateWindows();
+}
+
+bool FusionVisualEngine::IsImageStackLoading()
+{
+	return FusionSurgeryController::GetInstance()->IsImageStackLoading();
+}
+
 /******************************************************************************/
 /* Model related functions                                                                           
 /******************************************************************************/
@@ -484,6 +579,39 @@ void FusionVisualEngine::CreateCurveDisplayObjects(int modelId, inurbsSubModel*
 /******************************************************************************/
 
 void FusionVisualEngine::CreateLesionSubModelDisplayObject(inurbsSubModel* lesionSubModel)
+{
+	AddLesionSubModelDisplayObject(lesionSubModel);
+	SetActiveLesion(lesionSubModel);
+}
+
+void FusionVisualEngine::CreateLesionsDisplayObjects(const QList<inurbsSubModel*>& lesions, inurbsSubModel* pActiveLesion)
+{
+	FUSION_TRACE_SCOPE("CreateLesionsDisplayObjects", "render");
+
+	ImageStack* pImageStack = m_pVolumeDisplayObject->GetImageStack();
+
+	// actors, curves, surfaces and labels of all lesions, nothing is rendered and
+	// the slice visibility is not updated until the end
+	for (int i = 0; i < lesions.size(); i++)
+	{
+		inurbsSubModel* pLesion = lesions.at(i);
+		if (!pLesion)
+			continue;
+
+		AddLesionSubModelDisplayObject(pLesion);
+		AddLesionCurveDisplayObjects(pLesion);
+
+		int id = GetController()->GetLesionSubModelId(pLesion);
+		m_pLesionsModelDisplayObject->UpdateSurfaceDisplayObject(id, pLesion, pLesion->GetSurface(), pImageStack);
+		if (!pLesion->GetSurface()->IsSurfaceValid() && pLesion->GetNumOfClosedCurves() == 1) // just one curve, label on the curve
+			m_pLesionsModelDisplayObject->UpdateCurveLabel(id, pLesion, pImageStack);
+	}
+
+	// updates the slice visibility and requests one render
+	SetActiveLesion(pActiveLesion);
+}
+
+void FusionVisualEngine::AddLesionSubModelDisplayObject(inurbsSubModel* lesionSubModel)
 {
 	// surface display object is created in creation of submodel display object
 	SubModelDisplayObject *subModelDisplayObject = m_pLesionsModelDisplayObject->CreateSubModelDisplayObject(lesionSubModel);
@@ -496,7 +624,8 @@ void FusionVisualEngine::CreateLesionSubModelDisplayObject(inurbsSubModel* lesio
 	m_pLesionModellingTransversalImageContext->AddEntity(surfaceDisplayObject, m_pVolumeDisplayObject);
 	m_pSagittalImageContext->AddEntity(surfaceDisplayObject, m_pVolumeDisplayObject);
 	m_pCoronalImageContext->AddEntity(surfaceDisplayObject, m_pVolumeDisplayObject);
-	m_pVirtualContext->AddEntity(surfaceDisplayObject);
+	if (!m_pLesionsModelDisplayObject->IsMergedSurfaces()) // otherwise drawn by the merged surface actors
+		m_pVirtualContext->AddEntity(surfaceDisplayObject);
 
 
 	// add label2D display Object to transversal contexts
@@ -510,8 +639,6 @@ void FusionVisualEngine::CreateLesionSubModelDisplayObject(inurbsSubModel* lesio
 
 	// If this is not called here, vtk will render a warning that complains about input being null
 	surfaceDisplayObject->UpdateSurface();
-
-	SetActiveLesion(lesionSubModel);
 }
 
 void FusionVisualEngine::DeleteLesionSubModelDisplayObject(inurbsSubModel* pSubModel)
@@ -519,6 +646,7 @@ void FusionVisualEngine::DeleteLesionSubModelDisplayObject(inurbsSubModel* pSubM
 	inurbsSubModel* pNextLesion = GetController()->GetNextLesionSubModel(pSubModel);
 
 	m_pLesionsModelDisplayObject->RemoveSubModelDisplayObject(pSubModel);
+	m_lesionVolumes.remove(pSubModel);
 
 	if (pNextLesion == pSubModel)
 		SetActiveLesion(NULL);
@@ -530,10 +658,22 @@ void FusionVisualEngine::DeleteLesionSubModelDisplayObject(inurbsSubModel* pSubM
 }
 
 void FusionVisualEngine::CreateLesionCurveDisplayObjects(inurbsSubModel* pSubModel)
+{
+	AddLesionCurveDisplayObjects(pSubModel);
+
+	UpdateSliceZ();
+	Update2DWindows();
+}
+
+void FusionVisualEngine::AddLesionCurveDisplayObjects(inurbsSubModel* pSubModel)
 {
 	if (!pSubModel)
 		return;
 
+	SubModelDisplayObject *subModelDisplayObject = m_pLesionsModelDisplayObject->GetSubModelDisplayObject(pSubModel);
+	if (!subModelDisplayObject)
+		return;
+
 	inurbsPlanarCurveStack* pCurveStack = pSubModel->GetCurveStack();
 	if (!pCurveStack)
 		return;
@@ -543,10 +683,10 @@ void FusionVisualEngine::CreateLesionCurveDisplayObjects(inurbsSubModel* pSubMod
 	{
 		inurbsPlanarCurve* pCurve = pCurveStack->GetCurve(i);
 		CreateLesionCurveDisplayObject(pSubModel,pCurve);
-		UpdateLesionCurveDisplayObject(pSubModel,pCurve);
+		subModelDisplayObject->UpdateCurveDisplayObject(pCurve);
 	}
 
-	UpdateSliceZ();
+	m_pLesionsModelDisplayObject->InvalidatePositionIndex();
 }
 
 void FusionVisualEngine::GotoNextLesion()
@@ -599,13 +739,17 @@ void FusionVisualEngine::UpdateAllLabelTexts()
 	UpdateWindows();
 }
 
-void FusionVisualEngine::UpdateLesionSurfaceDisplayObject(inurbsSubModel* pSubModel, inurbsSurface* surface)
+void FusionVisualEngine::UpdateLesionSurfaceDisplayObject(inurbsSubModel* pSubModel, inurbsSurface* surface, bool bPreview)
 {
 	//m_pModelDisplayObject->UpdateProstateVolume();
 
 	int id = GetController()->GetLesionSubModelId(pSubModel);
 	m_pLesionsModelDisplayObject->UpdateSurfaceDisplayObject(id, pSubModel,surface,m_pVolumeDisplayObject->GetImageStack());
 
+	SubModelDisplayObject* pSubModelDisplayObject = m_pLesionsModelDisplayObject->GetSubModelDisplayObject(pSubModel);
+	if (pSubModelDisplayObject)
+		m_pLesionModellingTransversalImageContext->SetSliceContoursPreview(pSubModelDisplayObject->GetSurfaceDisplayObject(), bPreview);
+
 	UpdateSliceZ();
 	UpdateWindows();
 }
@@ -638,6 +782,7 @@ void FusionVisualEngine::CreateLesionCurveDisplayObject(inurbsSubModel* pSubMode
 	m_pVirtualContext->AddEntity(curveDisplayObject);
 
 	curveDisplayObject->SetCurveColor(1.0,0.0,0.0);
+	m_pLesionsModelDisplayObject->InvalidatePositionIndex();
 
 	// do not need to update window at this point, there is nothing to be drawn. 
 	//m_pModellingTransversalImageContext->updateWindow();
@@ -649,6 +794,7 @@ void FusionVisualEngine::UpdateLesionCurveDisplayObject(inurbsSubModel* pSubMode
 	SubModelDisplayObject *subModelDisplayObject = m_pLesionsModelDisplayObject->GetSubModelDisplayObject(pSubModel);
 
 	subModelDisplayObject->UpdateCurveDisplayObject(pCurve);
+	m_pLesionsModelDisplayObject->InvalidatePositionIndex();
 
 	Update2DWindows();
 }
@@ -687,6 +833,7 @@ void FusionVisualEngine::DeleteLesionCurveDisplayObject(inurbsSubModel* pSubMode
 
 	// remove curve display object
 	subModelDisplayObject->RemoveCurveDisplayObject(pCurve);
+	m_pLesionsModelDisplayObject->InvalidatePositionIndex();
 
 	UpdateSliceZ();
 	UpdateWindows();
@@ -714,10 +861,26 @@ void FusionVisualEngine::SetProstateModelVisible(bool bVisible)
 double FusionVisualEngine::GetLesionVolume(inurbsSubModel* pSubModel)
 {
 	SubModelDisplayObject *subModelDisplayObject = m_pLesionsModelDisplayObject->GetSubModelDisplayObject(pSubModel);
-	if(subModelDisplayObject)
-		return subModelDisplayObject->GetSurfaceVolume();
+	if(!subModelDisplayObject)
+		return 0;
+
+	// the polydata modified time works as the surface generation, any rebuild or preview bumps it
+	vtkPolyData* pPolyData = subModelDisplayObject->GetSurfaceDisplayObject()->GetSurfacePolyData();
+	vtkMTimeType iModifiedTime = pPolyData ? pPolyData->GetMTime() : 0;
+
+	QMap<inurbsSubModel*, LesionVolume>::const_iterator it = m_lesionVolumes.constFind(pSubModel);
+	if (it != m_lesionVolumes.constEnd() && it->pPolyData == pPolyData && it->iModifiedTime == iModifiedTime)
+		return it->fVolume;
+
+	FUSION_TRACE_SCOPE("GetSurfaceVolume", "model");
+
+	LesionVolume volume;
+	volume.pPolyData = pPolyData;
+	volume.iModifiedTime = iModifiedTime;
+	volume.fVolume = subModelDisplayObject->GetSurfaceVolume();
+	m_lesionVolumes.insert(pSubModel, volume);
 
-	return 0;
+	return volume.fVolume;
 }
 
 void FusionVisualEngine::UpdateLesionInfo(QString sLesionInfo)
@@ -729,5 +892,6 @@ void FusionVisualEngine::UpdateLesionInfo(QString sLesionInfo)
 void FusionVisualEngine::CleanLesion()
 {
 	m_pLesionsModelDisplayObject->RemoveAllSubModelDisplayObjects();
+	m_lesionVolumes.clear();
 	Update2DWindows();
 }
\ No newline at end of file
@@ -7,6 +7,10 @@
 #ifndef FUSION_VISUAL_ENGINE_H
 #define FUSION_VISUAL_ENGINE_H
 
+#include <QMap>
+#include <QTimer>
+#include <vtkType.h>
+
 #include "BaseVisualEngine.h"
 #include "qvContext.h"
 #include "VolumeDisplayObject.h"
@@ -20,6 +24,7 @@
 
 class LesionModellingTransversalImageContext;
 class LesionsModelDisplayObject;
+class vtkPolyData;
 
 class FusionVisualEngine : public BaseVisualEngine  
 {
@@ -27,6 +32,17 @@ class FusionVisualEngine : public BaseVisualEngine
 
 public:
 
+	// contexts for RequestRender
+	enum RENDER_CONTEXT
+	{
+		RENDER_MODELLING_TRANSVERSAL = 1,
+		RENDER_LESION_TRANSVERSAL = 2,
+		RENDER_SAGITTAL = 4,
+		RENDER_CORONAL = 8,
+		RENDER_VIRTUAL = 16,
+		RENDER_ALL = 31
+	};
+
 	static FusionVisualEngine* GetInstance();
 	static void DeleteInstance();
 
@@ -48,11 +64,15 @@ public:
 	void Update2DWindows();
 	void UpdateWindows();
 
+	// marks contexts dirty, each dirty render window is rendered once when control returns to the event loop
+	void RequestRender(int iContexts);
+
 	// display object functions
 	void UpdateSliceZ();
 
 	// import image functions
 	void UpdateImageImport();
+	void ImageStackLoaded(); // renders and resets the views held back while the slices were copied in
 
 	// Model related functions
 	void AddSurfaceDisplayObject(SurfaceDisplayObject *surfaceDisplayObject);
@@ -62,11 +82,12 @@ public:
 	void CreateLesionSubModelDisplayObject(inurbsSubModel* subModel);
 	void DeleteLesionSubModelDisplayObject(inurbsSubModel* pSubModel);
 	void CreateLesionCurveDisplayObjects(inurbsSubModel* pSubModel);
+	void CreateLesionsDisplayObjects(const QList<inurbsSubModel*>& lesions, inurbsSubModel* pActiveLesion); // all lesions of a loaded model, rendered once
 	void GotoNextLesion();
 	void GotoPrevLesion();
 	void ShowActiveLesionCentre();
 	void UpdateAllLabelTexts();
-	void UpdateLesionSurfaceDisplayObject(inurbsSubModel* pSubModel, inurbsSurface* surface);
+	void UpdateLesionSurfaceDisplayObject(inurbsSubModel* pSubModel, inurbsSurface* surface, bool bPreview = false); // drag previews are not cut against all slices
 	void UpdateLesionCurveLabel(inurbsSubModel* pSubModel);
 	void CreateLesionCurveDisplayObject(inurbsSubModel* pSubModel, inurbsPlanarCurve* pCurve);
 	void UpdateLesionCurveDisplayObject(inurbsSubModel* pSubModel, inurbsPlanarCurve* pCurve);
@@ -83,13 +104,35 @@ public:
 protected:
 	static FusionVisualEngine* m_pInstance;
 
+	// lesion display objects without updating the slice or rendering
+	void AddLesionSubModelDisplayObject(inurbsSubModel* lesionSubModel);
+	void AddLesionCurveDisplayObjects(inurbsSubModel* pSubModel);
+
 	// contexts
 	LesionModellingTransversalImageContext* m_pLesionModellingTransversalImageContext;
 
 	// display objects
 	LesionsModelDisplayObject* m_pLesionsModelDisplayObject;
 
+	// lesion volumes, recomputed only when the displayed surface polydata is modified
+	struct LesionVolume
+	{
+		vtkPolyData* pPolyData;
+		vtkMTimeType iModifiedTime;
+		double fVolume;
+	};
+	QMap<inurbsSubModel*, LesionVolume> m_lesionVolumes;
+
+	// pending renders
+	int m_iDirtyContexts;
+	QTimer m_renderTimer;
+
+	// sagittal, coronal and 3D resets held back while the image stack loads
+	int m_iDeferredResets;
+	bool IsImageStackLoading();
+
 public slots:
+	void FlushRender(); // render the dirty contexts now
 	void UpdateState(int state, int subState);
 	void ResetTransversalView(TransversalImageContext* pContext);
 	void UpdateSlice(int axis);
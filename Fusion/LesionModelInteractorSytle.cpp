@@ -4,6 +4,8 @@
     Date      : 26 Nov 2018
  ******************************************************************************/
 
+#include <string.h>
+
 #include <vtkObjectFactory.h>
 #include <vtkRenderWindow.h>
 #include <vtkRenderWindowInteractor.h>
@@ -11,6 +13,8 @@
 #include "Application.h"
 #include "LesionModelInteractorSytle.h"
 #include "inurbsSubModel.h"
+#include "CurvePickIndex.h"
+#include "CurveEditHistory.h"
 
 // macro to implement the New function
 vtkStandardNewMacro(LesionModelInteractorStyle);
@@ -25,14 +29,10 @@ LesionModelInteractorStyle::LesionModelInteractorStyle() : CursorBoundResliceInt
 	m_pCurCurve = NULL;
 	m_pActiveLesion = NULL;
 	m_doubleClickTimer.start();
-	m_pInitialPoints = NULL;
-	m_iNumInitialPoints = 0;
 }
 
 LesionModelInteractorStyle::~LesionModelInteractorStyle()
 {
-	if (m_pInitialPoints)
-		delete [] m_pInitialPoints;
 }
 
 /******************************************************************************/
@@ -95,6 +95,7 @@ void LesionModelInteractorStyle::OnLeftButtonDown()
 				else
 				{
 					m_pCurCurve->RemovePointAt(m_iPickedPointIndex);
+					pSurgeryController->GetCurvePickIndex()->PointRemoved(m_pCurCurve, m_iPickedPointIndex);
 					GetVisualEngine()->UpdateLesionCurveDisplayObject(m_pActiveLesion,m_pCurCurve);
 				}
 			}
@@ -113,7 +114,6 @@ void LesionModelInteractorStyle::OnLeftButtonDown()
 			m_iPickedPointIndex = pSurgeryController->AddCurveToLesionModel(m_pActiveLesion,pickedPoint[0],pickedPoint[1],curPos,&m_pCurCurve);
 			if (m_iPickedPointIndex != -1)
 			{
-				StoreInitialPoints();
 				StartMovePoint();
 				return;
 			}
@@ -171,14 +171,16 @@ void LesionModelInteractorStyle::OnLeftButtonUp()
 	if (m_iPickedAxis != -1) // some axis picked, no need to handle here
 		return;
 
+	CurveEditHistory* pHistory = GetController()->GetCurveEditHistory();
 	switch (this->State) 
     {
 		case VTKIS_MOVE_POINT:
 		{
 			this->EndMovePoint();
-			if (m_iNumInitialPoints == 3 && m_pCurCurve->GetNumOfPoints() < 3) // less than 3 points now, restore
+			if (pHistory->GetEditNumPoints() == 3 && m_pCurCurve->GetNumOfPoints() < 3) // less than 3 points now, restore
 			{
-				m_pCurCurve->SetPoints(m_pInitialPoints,m_iNumInitialPoints);
+				m_pCurCurve->SetPoints(pHistory->GetEditPoints(),pHistory->GetEditNumPoints());
+				GetController()->GetCurvePickIndex()->Invalidate(m_pCurCurve);
 				GetVisualEngine()->UpdateLesionCurveDisplayObject(m_pActiveLesion,m_pCurCurve);
 				emit setLabelMessage(MSGLABEL_MODEL_CONTOUR_MIN_POINTS);
 			}
@@ -188,9 +190,10 @@ void LesionModelInteractorStyle::OnLeftButtonUp()
 		case VTKIS_DELETE_POINT:
 		{
 			this->EndDeletePoint();
-			if (m_iNumInitialPoints == 3 && m_pCurCurve->GetNumOfPoints() < 3) // less than 3 points now, restore
+			if (pHistory->GetEditNumPoints() == 3 && m_pCurCurve && m_pCurCurve->GetNumOfPoints() < 3) // less than 3 points now, restore
 			{
-				m_pCurCurve->SetPoints(m_pInitialPoints,m_iNumInitialPoints);
+				m_pCurCurve->SetPoints(pHistory->GetEditPoints(),pHistory->GetEditNumPoints());
+				GetController()->GetCurvePickIndex()->Invalidate(m_pCurCurve);
 				GetVisualEngine()->UpdateLesionCurveDisplayObject(m_pActiveLesion,m_pCurCurve);
 				emit setLabelMessage(MSGLABEL_MODEL_CONTOUR_MIN_POINTS);
 			}
@@ -201,9 +204,37 @@ void LesionModelInteractorStyle::OnLeftButtonUp()
 		break;
 	}
 
+	// the click is one undo step, unless it left the curve as it was
+	pHistory->EndEdit();
 	GetController()->BuildLesionSurface(m_pActiveLesion);
 }
 
+void LesionModelInteractorStyle::OnKeyPress()
+{
+	const char* keySym = this->Interactor->GetKeySym();
+	if (GetController()->GetState() != BaseSurgeryController::STATE_LESION || !this->Interactor->GetControlKey() || !keySym || this->State != VTKIS_NONE)
+	{
+		CursorBoundResliceInteractorStyle::OnKeyPress();
+		return;
+	}
+
+	bool bShift = this->Interactor->GetShiftKey() != 0;
+	if ((!strcmp(keySym, "z") || !strcmp(keySym, "Z")) && !bShift)
+		GetController()->UndoLesionEdit();
+	else if (!strcmp(keySym, "y") || !strcmp(keySym, "Y") || !strcmp(keySym, "z") || !strcmp(keySym, "Z"))
+		GetController()->RedoLesionEdit();
+	else
+	{
+		CursorBoundResliceInteractorStyle::OnKeyPress();
+		return;
+	}
+
+	// the edited curve may be on another lesion or slice
+	m_pActiveLesion = GetVisualEngine()->GetActiveLesion();
+	m_pCurCurve = NULL;
+	m_iPickedPointIndex = -1;
+}
+
 
 /******************************************************************************/
 /* Move point functions                                                                            
@@ -252,10 +283,14 @@ void LesionModelInteractorStyle::MovePoint()
 	// if the new position coincide with another point, the current point will be deleted. 
 	if (!m_pCurCurve->SetPointAt(m_iPickedPointIndex, pickedPoint[0], pickedPoint[1]))
 	{
+		GetController()->GetCurvePickIndex()->PointRemoved(m_pCurCurve, m_iPickedPointIndex);
 		m_iPickedPointIndex = -1;
 	}
+	else
+		GetController()->GetCurvePickIndex()->PointMoved(m_pCurCurve, m_iPickedPointIndex);
 	
 	GetVisualEngine()->UpdateLesionCurveDisplayObject(m_pActiveLesion,m_pCurCurve);
+	GetController()->PreviewLesionSurface(m_pActiveLesion);
 	//this->Interactor->Render();
 }
 
@@ -288,28 +323,7 @@ void LesionModelInteractorStyle::EndDeletePoint()
 
 void LesionModelInteractorStyle::StoreInitialPoints()
 {
-	if (!m_pCurCurve)
-	{
-		m_iNumInitialPoints = 0;
-		if (m_pInitialPoints)
-			delete [] m_pInitialPoints;
-		m_pInitialPoints = 0;
-		return;
-	}
-	
-	if (m_pInitialPoints)
-		delete [] m_pInitialPoints;
-	m_iNumInitialPoints = m_pCurCurve->GetNumOfPoints();
-	m_pInitialPoints = new inurbsPoint[m_iNumInitialPoints];
-	QList<inurbsPoint*>* pointList = m_pCurCurve->GetPoints();
-	
-	for(int i = 0; i < m_iNumInitialPoints; i++)
-	{
-		inurbsPoint& point = m_pInitialPoints[i];
-
-		point.x = pointList->at(i)->x;
-		point.y = pointList->at(i)->y;
-		point.z = pointList->at(i)->z;
-	}
-
+	// the snapshot is copied into the history arena, no allocation per click
+	double curPos = GetVisualEngine()->GetCurrentPlanePosition();
+	GetController()->GetCurveEditHistory()->BeginEdit(m_pActiveLesion, curPos);
 }
\ No newline at end of file
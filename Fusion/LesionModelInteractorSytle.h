@@ -29,6 +29,9 @@ public:
 	virtual void OnLeftButtonUp();
 	virtual void OnMouseMove();
 
+	// key event handlers, ctrl+z undoes and ctrl+y redoes curve edits
+	virtual void OnKeyPress();
+
 	void SetActiveLesion(inurbsSubModel* pSubModel) {m_pActiveLesion = pSubModel;}
 	inurbsSubModel* GetActiveLesion() { return m_pActiveLesion;}
 
@@ -50,8 +53,6 @@ protected:
 	int m_iPickedPointIndex;
 	inurbsPlanarCurve* m_pCurCurve;
 
-	int m_iNumInitialPoints;
-	inurbsPoint* m_pInitialPoints;
 	QElapsedTimer m_doubleClickTimer;
 
 };
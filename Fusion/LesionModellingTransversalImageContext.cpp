@@ -10,6 +10,9 @@
 #include <vtkProperty.h>
 #include <vtkLegendScaleActor.h>
 #include <vtkAxisActor2D.h>
+#include <vtkCallbackCommand.h>
+#include <vtkPolyDataMapper.h>
+#include <vtkRenderer.h>
 
 #include "Application.h"
 #include "LesionModellingTransversalImageContext.h"
@@ -19,6 +22,8 @@
 #include "SurfaceDisplayObject.h"
 #include "CurveDisplayObject.h"
 #include "qvOrthoImageSlicePipeline.h"
+#include "SurfaceSliceContours.h"
+#include "ImageStack.h"
 
  /******************************************************************************/
  /* Constructors and Destructors
@@ -31,10 +36,18 @@ LesionModellingTransversalImageContext::LesionModellingTransversalImageContext(i
 	m_pLesionModelInteractorStyle->SetPlane(ResliceInteractorStyle::PLANE_TRANSVERSAL);
 	m_pLesionModelInteractorStyle->SetContext(context);
 
+	m_pSliceVolumeDisplayObject = NULL;
+	m_iSliceContourObserver = 0;
 }
 
 LesionModellingTransversalImageContext::~LesionModellingTransversalImageContext()
 {
+	if (m_iSliceContourObserver && getRenderer(1))
+		getRenderer(1)->RemoveObserver(m_iSliceContourObserver);
+
+	for (int i = 0; i < m_sliceContourActors.size(); i++)
+		delete m_sliceContourActors.at(i).pContours;
+
 	m_pLesionModelInteractorStyle->Delete();
 }
 
@@ -76,8 +89,26 @@ void LesionModellingTransversalImageContext::AddEntity(SurfaceDisplayObject* sur
 
 	if(cutterPipeline == 0)
 		cutterPipeline = surfaceDisplayObject->GetMeshPipeline()->addCutter("AXIS_Z",volumeDisplayObject->GetZSlicePipeline()->getSlicePlane());
-	cutterPipeline->addActor(getRenderer(1));
 
+	// the actor keeps its color and visibility handling, only its mapper input
+	// is replaced by the precomputed contour of the current slice
+	SliceContourActor contourActor;
+	contourActor.pDisplayObject = surfaceDisplayObject;
+	contourActor.pSurfaceDisplayObject = surfaceDisplayObject;
+	contourActor.pActor = cutterPipeline->addActor(getRenderer(1));
+	contourActor.pContours = new SurfaceSliceContours;
+	contourActor.bPreview = false;
+	connect(contourActor.pContours, SIGNAL(built()), this, SLOT(OnSliceContoursBuilt()));
+	m_sliceContourActors.append(contourActor);
+	m_pSliceVolumeDisplayObject = volumeDisplayObject;
+
+	if (!m_iSliceContourObserver)
+	{
+		vtkSmartPointer<vtkCallbackCommand> callback = vtkSmartPointer<vtkCallbackCommand>::New();
+		callback->SetCallback(OnRendererStart);
+		callback->SetClientData(this);
+		m_iSliceContourObserver = getRenderer(1)->AddObserver(vtkCommand::StartEvent, callback);
+	}
 }
 
 void LesionModellingTransversalImageContext::AddEntity(CurveDisplayObject* curveDisplayObject)
@@ -194,3 +225,63 @@ inurbsSubModel* LesionModellingTransversalImageContext::GetActiveLesion()
 {
 	return m_pLesionModelInteractorStyle->GetActiveLesion();
 }
+
+/******************************************************************************/
+/* Slice contour functions
+/******************************************************************************/
+
+void LesionModellingTransversalImageContext::UpdateSliceContours()
+{
+	if (!m_pSliceVolumeDisplayObject)
+		return;
+
+	ImageStack* pImageStack = m_pSliceVolumeDisplayObject->GetImageStack();
+	if (!pImageStack)
+		return;
+
+	int iNumSlices = pImageStack->GetDimension()[2];
+	double fFirstZ = pImageStack->GetOrigin()[2];
+	double fSpacingZ = pImageStack->GetSpacing()[2];
+	double z = m_pSliceVolumeDisplayObject->GetZSlicePipeline()->getSliceCoordinate();
+
+	for (int i = m_sliceContourActors.size() - 1; i >= 0; i--)
+	{
+		SliceContourActor& contourActor = m_sliceContourActors[i];
+		if (!contourActor.pDisplayObject)
+		{
+			delete contourActor.pContours;
+			m_sliceContourActors.removeAt(i);
+			continue;
+		}
+
+		// cut against all slices on the pool only when the final surface was rebuilt or the image changed,
+		// the viewed slice is cut here until they are in
+		vtkPolyData* pMesh = contourActor.pSurfaceDisplayObject->GetSurfacePolyData();
+		contourActor.pContours->Update(pMesh, fFirstZ, fSpacingZ, iNumSlices, !contourActor.bPreview);
+
+		vtkPolyDataMapper* pMapper = vtkPolyDataMapper::SafeDownCast(contourActor.pActor->GetMapper());
+		vtkPolyData* pContour = contourActor.pContours->GetContour(z);
+		if (pMapper && pMapper->GetInput() != pContour)
+			pMapper->SetInputData(pContour);
+	}
+}
+
+void LesionModellingTransversalImageContext::SetSliceContoursPreview(SurfaceDisplayObject* pSurfaceDisplayObject, bool bPreview)
+{
+	for (int i = 0; i < m_sliceContourActors.size(); i++)
+	{
+		if (m_sliceContourActors.at(i).pSurfaceDisplayObject == pSurfaceDisplayObject && m_sliceContourActors.at(i).pDisplayObject)
+			m_sliceContourActors[i].bPreview = bPreview;
+	}
+}
+
+void LesionModellingTransversalImageContext::OnSliceContoursBuilt()
+{
+	GetVisualEngine()->RequestRender(FusionVisualEngine::RENDER_LESION_TRANSVERSAL);
+}
+
+void LesionModellingTransversalImageContext::OnRendererStart(vtkObject*, unsigned long, void* clientData, void*)
+{
+	LesionModellingTransversalImageContext* pThis = static_cast<LesionModellingTransversalImageContext*>(clientData);
+	pThis->UpdateSliceContours();
+}
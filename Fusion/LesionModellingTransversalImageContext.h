@@ -8,6 +8,10 @@
 #ifndef LESION_TRANSVERSAL_IMAGE_CONTEXT_H
 #define LESION_TRANSVERSAL_IMAGE_CONTEXT_H
 
+#include <QList>
+#include <QPointer>
+#include <vtkSmartPointer.h>
+
 #include "TransversalImageContext.h"
 
 class LesionModelInteractorStyle;
@@ -16,6 +20,9 @@ class SurfaceDisplayObject;
 class CurveDisplayObject;
 class AnnotationDisplayObject;
 class inurbsSubModel;
+class SurfaceSliceContours;
+class vtkActor;
+class vtkObject;
 
 class LesionModellingTransversalImageContext : public TransversalImageContext
 {	
@@ -45,8 +52,34 @@ public:
 	inurbsSubModel* GetActiveLesion();
 	LesionModelInteractorStyle* GetLesionModelInteractorStyle() { return m_pLesionModelInteractorStyle; }
 
+	// surface cross sections come from per slice contours cut once per surface edit,
+	// called before every render, rebuilds the contours of changed surfaces only
+	void UpdateSliceContours();
+
+	// a preview surface changes on every drag frame, only the viewed slice is cut
+	// until the final surface is set with bPreview false
+	void SetSliceContoursPreview(SurfaceDisplayObject* pSurfaceDisplayObject, bool bPreview);
+
 protected:
+	static void OnRendererStart(vtkObject* caller, unsigned long eventId, void* clientData, void* callData);
+
 	LesionModelInteractorStyle* m_pLesionModelInteractorStyle;
+
+	// cutter actors whose mapper is fed from the slice contours
+	struct SliceContourActor
+	{
+		QPointer<QObject> pDisplayObject; // cleared when the surface display object is deleted
+		SurfaceDisplayObject* pSurfaceDisplayObject;
+		vtkSmartPointer<vtkActor> pActor;
+		SurfaceSliceContours* pContours;
+		bool bPreview;
+	};
+	QList<SliceContourActor> m_sliceContourActors;
+	VolumeDisplayObject* m_pSliceVolumeDisplayObject;
+	unsigned long m_iSliceContourObserver;
+
+protected slots:
+	void OnSliceContoursBuilt();
 };
 
 
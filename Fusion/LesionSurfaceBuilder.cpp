@@ -0,0 +1,237 @@
+/******************************************************************************
+	LesionSurfaceBuilder.cpp
+
+	Date      : 18 Oct 2026
+******************************************************************************/
+
+#include <QRunnable>
+#include <QVector>
+
+#include "LesionSurfaceBuilder.h"
+#include "inurbsSubModel.h"
+#include "inurbsPlanarCurve.h"
+#include "inurbsPlanarCurveStack.h"
+#include "FusionTrace.h"
+
+#define PREVIEW_BUILD_INTERVAL 40 // ms between preview builds while dragging
+
+static QMutex g_buildMutex;
+
+/******************************************************************************/
+/* Build task
+/******************************************************************************/
+
+class LesionSurfaceBuildTask : public QRunnable
+{
+public:
+	LesionSurfaceBuildTask(LesionSurfaceBuilder* pBuilder, int iGeneration, inurbsSubModel* pLesion, inurbsSubModel* pPreview)
+	{
+		m_pBuilder = pBuilder;
+		m_iGeneration = iGeneration;
+		m_pLesion = pLesion;
+		m_pPreview = pPreview;
+	}
+
+	void run()
+	{
+		{
+			FUSION_TRACE_SCOPE("BuildPreviewSurface", "model");
+			QMutexLocker locker(LesionSurfaceBuilder::GetBuildMutex());
+			m_pPreview->BuildSurface();
+		}
+
+		m_pBuilder->BuildFinished(m_iGeneration, m_pLesion, m_pPreview);
+	}
+
+protected:
+	LesionSurfaceBuilder* m_pBuilder;
+	int m_iGeneration;
+	inurbsSubModel* m_pLesion;	// only used as a key, never dereferenced here
+	inurbsSubModel* m_pPreview;
+};
+
+/******************************************************************************/
+/* Constructors and destructors
+/******************************************************************************/
+
+LesionSurfaceBuilder::LesionSurfaceBuilder(QObject* parent) : QObject(parent)
+{
+	m_pBuildingLesion = NULL;
+	m_iGeneration = 0;
+
+	m_threadPool.setMaxThreadCount(1);
+
+	m_debounceTimer.setSingleShot(true);
+	m_debounceTimer.setInterval(PREVIEW_BUILD_INTERVAL);
+	connect(&m_debounceTimer, SIGNAL(timeout()), this, SLOT(OnDebounceTimeout()));
+}
+
+LesionSurfaceBuilder::~LesionSurfaceBuilder()
+{
+	m_threadPool.waitForDone();
+
+	for (int i = 0; i < m_results.size(); i++)
+		delete m_results.at(i).second.second;
+	m_results.clear();
+
+	ReleaseAll();
+}
+
+QMutex* LesionSurfaceBuilder::GetBuildMutex()
+{
+	return &g_buildMutex;
+}
+
+/******************************************************************************/
+/* Build functions
+/******************************************************************************/
+
+void LesionSurfaceBuilder::RequestBuild(inurbsSubModel* pLesion)
+{
+	if (!pLesion)
+		return;
+
+	// mouse moves only mark the lesion, the curves are copied when the build starts
+	m_pendingLesions.insert(pLesion);
+	if (!m_debounceTimer.isActive())
+		m_debounceTimer.start();
+}
+
+void LesionSurfaceBuilder::OnDebounceTimeout()
+{
+	StartBuild();
+}
+
+void LesionSurfaceBuilder::StartBuild()
+{
+	if (m_pBuildingLesion || m_pendingLesions.isEmpty())
+		return;
+
+	inurbsSubModel* pLesion = *m_pendingLesions.begin();
+	m_pendingLesions.remove(pLesion);
+
+	inurbsSubModel* pPreview = CreateSnapshot(pLesion);
+	if (!pPreview)
+	{
+		StartBuild();
+		return;
+	}
+
+	m_pBuildingLesion = pLesion;
+	m_threadPool.start(new LesionSurfaceBuildTask(this, ++m_iGeneration, pLesion, pPreview));
+}
+
+inurbsSubModel* LesionSurfaceBuilder::CreateSnapshot(inurbsSubModel* pLesion)
+{
+	inurbsPlanarCurveStack* pCurveStack = pLesion->GetCurveStack();
+	if (!pCurveStack)
+		return NULL;
+
+	inurbsSubModel* pPreview = new inurbsSubModel();
+	inurbsPlanarCurveStack* pPreviewStack = pPreview->GetCurveStack();
+
+	int iNumCopied = 0;
+	QVector<inurbsPoint> points;
+	int iNumCurves = pCurveStack->GetNumOfCurves();
+	for (int i = 0; i < iNumCurves; i++)
+	{
+		inurbsPlanarCurve* pCurve = pCurveStack->GetCurve(i);
+		if (!pCurve || pCurve->GetNumOfPoints() < 3) // same as the closed curve check for the real build
+			continue;
+
+		QList<inurbsPoint*>* pPoints = pCurve->GetPoints();
+		points.resize(pPoints->size());
+		for (int j = 0; j < pPoints->size(); j++)
+		{
+			points[j].x = pPoints->at(j)->x;
+			points[j].y = pPoints->at(j)->y;
+			points[j].z = pPoints->at(j)->z;
+		}
+
+		inurbsPlanarCurve* pPreviewCurve = pPreviewStack->CreateCurve(points[0].z);
+		pPreviewCurve->SetPoints(points.data(), points.size());
+		iNumCopied++;
+	}
+
+	if (iNumCopied < 2) // not enough for a surface
+	{
+		delete pPreview;
+		return NULL;
+	}
+
+	return pPreview;
+}
+
+void LesionSurfaceBuilder::BuildFinished(int iGeneration, inurbsSubModel* pLesion, inurbsSubModel* pPreview)
+{
+	{
+		QMutexLocker locker(&m_resultMutex);
+		m_results.append(qMakePair(iGeneration, qMakePair(pLesion, pPreview)));
+	}
+
+	QMetaObject::invokeMethod(this, "OnBuildFinished", Qt::QueuedConnection);
+}
+
+void LesionSurfaceBuilder::OnBuildFinished()
+{
+	QList<QPair<int, QPair<inurbsSubModel*, inurbsSubModel*> > > results;
+	{
+		QMutexLocker locker(&m_resultMutex);
+		results.swap(m_results);
+	}
+
+	for (int i = 0; i < results.size(); i++)
+	{
+		int iGeneration = results.at(i).first;
+		inurbsSubModel* pLesion = results.at(i).second.first;
+		inurbsSubModel* pPreview = results.at(i).second.second;
+
+		m_pBuildingLesion = NULL;
+
+		// cancelled while building
+		if (iGeneration != m_iGeneration)
+		{
+			delete pPreview;
+			continue;
+		}
+
+		// show the new preview first, then drop the one it replaces
+		inurbsSubModel* pOldPreview = m_previews.value(pLesion);
+		m_previews.insert(pLesion, pPreview);
+		emit previewBuilt(pLesion, pPreview);
+		delete pOldPreview;
+	}
+
+	// the curves changed again while building
+	StartBuild();
+}
+
+/******************************************************************************/
+/* Release functions
+/******************************************************************************/
+
+void LesionSurfaceBuilder::Cancel(inurbsSubModel* pLesion)
+{
+	m_pendingLesions.remove(pLesion);
+	if (m_pBuildingLesion == pLesion)
+		m_iGeneration++; // the running build is discarded when it finishes
+}
+
+void LesionSurfaceBuilder::Release(inurbsSubModel* pLesion)
+{
+	Cancel(pLesion);
+
+	inurbsSubModel* pPreview = m_previews.take(pLesion);
+	if (pPreview)
+		delete pPreview;
+}
+
+void LesionSurfaceBuilder::ReleaseAll()
+{
+	m_pendingLesions.clear();
+	if (m_pBuildingLesion)
+		m_iGeneration++;
+
+	qDeleteAll(m_previews);
+	m_previews.clear();
+}
@@ -0,0 +1,77 @@
+/******************************************************************************
+	LesionSurfaceBuilder.h
+
+	Date      : 18 Oct 2026
+******************************************************************************/
+
+#ifndef LESION_SURFACE_BUILDER_H
+#define LESION_SURFACE_BUILDER_H
+
+#include <QObject>
+#include <QMap>
+#include <QSet>
+#include <QMutex>
+#include <QTimer>
+#include <QThreadPool>
+
+class inurbsSubModel;
+
+// Builds preview surfaces of a lesion on a worker thread while its points are
+// being dragged. The curves are copied into a temporary submodel so the
+// lesion itself is never touched off the main thread. Requests are coalesced,
+// only one build runs at a time and it always starts from the latest curves.
+//
+// The worker and the main thread do not build surfaces at the same time, see
+// GetBuildMutex().
+//
+// The preview submodel owns the surface shown by the display object, so it is
+// kept until the real surface is set again and Release() is called.
+class LesionSurfaceBuilder : public QObject
+{
+	Q_OBJECT
+
+public:
+	LesionSurfaceBuilder(QObject* parent = 0);
+	~LesionSurfaceBuilder();
+
+	void RequestBuild(inurbsSubModel* pLesion);
+	bool HasPreview(inurbsSubModel* pLesion) { return m_previews.contains(pLesion); }
+
+	// stop building for the lesion, call Release() after the real surface is displayed again
+	void Cancel(inurbsSubModel* pLesion);
+	void Release(inurbsSubModel* pLesion);
+	void ReleaseAll(); // lesions are deleted, no display objects left
+
+	// inurbs makes no thread safety promise, every surface build holds this
+	// lock, the previews on the worker and the lesion builds on the main thread
+	static QMutex* GetBuildMutex();
+
+protected:
+	void StartBuild();
+	inurbsSubModel* CreateSnapshot(inurbsSubModel* pLesion);
+
+	// called by the worker
+	void BuildFinished(int iGeneration, inurbsSubModel* pLesion, inurbsSubModel* pPreview);
+
+	QThreadPool m_threadPool;
+	QTimer m_debounceTimer;
+
+	QSet<inurbsSubModel*> m_pendingLesions;
+	QMap<inurbsSubModel*, inurbsSubModel*> m_previews; // lesion -> displayed preview
+	inurbsSubModel* m_pBuildingLesion;
+	int m_iGeneration;
+
+	QMutex m_resultMutex;
+	QList<QPair<int, QPair<inurbsSubModel*, inurbsSubModel*> > > m_results;
+
+	friend class LesionSurfaceBuildTask;
+
+protected slots:
+	void OnDebounceTimeout();
+	void OnBuildFinished();
+
+signals:
+	void previewBuilt(inurbsSubModel* pLesion, inurbsSubModel* pPreview);
+};
+
+#endif
@@ -12,6 +12,76 @@
 #include "Label2DDisplayObject.h"
 #include "Label3DDisplayObject.h"
 #include "inurbsSubModel.h"
+#include "inurbsPlanarCurve.h"
+#include "inurbsPlanarCurveStack.h"
+#include "FusionTrace.h"
+
+#include <QRunnable>
+#include <algorithm>
+
+#include <vtkActor.h>
+#include <vtkAppendPolyData.h>
+#include <vtkCallbackCommand.h>
+#include <vtkCellData.h>
+#include <vtkLODProp3D.h>
+#include <vtkPointData.h>
+#include <vtkPolyData.h>
+#include <vtkPolyDataMapper.h>
+#include <vtkProperty.h>
+#include <vtkQuadricDecimation.h>
+#include <vtkRenderWindow.h>
+#include <vtkTriangleFilter.h>
+#include <vtkUnsignedCharArray.h>
+
+#define POSITION_INDEX_MARGIN 5.0 // mm, wider than the half slice spacing used to match curves
+#define LOD_PROXY_CELLS 20000 // surfaces with more cells get a decimated proxy of about this size
+#define LOD_INTERACTIVE_UPDATE_RATE 1.0 // fps, still renders ask for much less, camera interaction for more
+#define LOD_PROXY_DELAY 300 // ms an input has to stay unchanged before its proxy is decimated
+
+/******************************************************************************/
+/* Proxy task
+/******************************************************************************/
+
+class SurfaceProxyTask : public QRunnable
+{
+public:
+	SurfaceProxyTask(LesionsModelDisplayObject* pObject, int iLOD, int iGeneration, vtkPolyData* pInput)
+	{
+		m_pObject = pObject;
+		m_iLOD = iLOD;
+		m_iGeneration = iGeneration;
+
+		// the input is changed in place by rebuilds and previews on the main thread
+		m_input = vtkSmartPointer<vtkPolyData>::New();
+		m_input->DeepCopy(pInput);
+	}
+
+	void run()
+	{
+		vtkSmartPointer<vtkPolyData> proxy = vtkSmartPointer<vtkPolyData>::New();
+		{
+			FUSION_TRACE_SCOPE("DecimateSurfaceProxy", "render");
+
+			vtkSmartPointer<vtkTriangleFilter> triangles = vtkSmartPointer<vtkTriangleFilter>::New();
+			triangles->SetInputData(m_input);
+
+			vtkSmartPointer<vtkQuadricDecimation> decimation = vtkSmartPointer<vtkQuadricDecimation>::New();
+			decimation->SetInputConnection(triangles->GetOutputPort());
+			decimation->SetTargetReduction(1.0 - (double)LOD_PROXY_CELLS / m_input->GetNumberOfCells());
+			decimation->Update();
+
+			proxy->ShallowCopy(decimation->GetOutput());
+		}
+
+		m_pObject->ProxyBuilt(m_iLOD, m_iGeneration, proxy);
+	}
+
+protected:
+	LesionsModelDisplayObject* m_pObject;
+	int m_iLOD;
+	int m_iGeneration;
+	vtkSmartPointer<vtkPolyData> m_input;
+};
 
 /******************************************************************************/
 /* Constructors and Destructors                                                                            
@@ -21,10 +91,37 @@ LesionsModelDisplayObject::LesionsModelDisplayObject(qvDisplayObject* parent)
   : qvDisplayObject(parent)
 {
 	m_pSubModelDisplayObjects = new QMap<inurbsSubModel *, SubModelDisplayObject*>();
+	m_pColoredActiveLesion = NULL;
+	m_fMaxZExtentLength = 0.0;
+	InvalidatePositionIndex();
+
+	m_bMergedSurfaces = false;
+	m_pMergedRenderer = NULL;
+	m_iMergedRendererObserver = 0;
+	m_bLODInteractive = false;
+	m_pMergedActiveLesion = NULL;
+
+	// one decimation at a time, the other input waits for it
+	m_proxyThreadPool.setMaxThreadCount(1);
+
+	m_proxyTimer.setSingleShot(true);
+	m_proxyTimer.setInterval(LOD_PROXY_DELAY);
+	connect(&m_proxyTimer, SIGNAL(timeout()), this, SLOT(OnProxyTimeout()));
 }
 
 LesionsModelDisplayObject::~LesionsModelDisplayObject()
 {
+	m_proxyTimer.stop();
+	m_proxyThreadPool.waitForDone();
+
+	if (m_pMergedRenderer)
+	{
+		m_pMergedRenderer->RemoveObserver(m_iMergedRendererObserver);
+		m_pMergedRenderer->RemoveViewProp(m_mergedLOD.pProp);
+		m_pMergedRenderer->RemoveViewProp(m_activeLOD.pProp);
+		SetSeparateSurfaces(QList<MergedSurface>());
+	}
+
 	RemoveAllSubModelDisplayObjects();
 	delete m_pSubModelDisplayObjects;
 }
@@ -42,6 +139,12 @@ void LesionsModelDisplayObject::RemoveSubModelDisplayObject(inurbsSubModel* pSub
 		m_pSubModelDisplayObjects->remove(pSubModel);
 		delete subModelDisplayObject;
 	}
+
+	if (m_pColoredActiveLesion == pSubModel)
+		m_pColoredActiveLesion = NULL;
+
+	m_surfaceAppearances.remove(pSubModel);
+	InvalidatePositionIndex();
 }
 
 void LesionsModelDisplayObject::RemoveAllSubModelDisplayObjects()
@@ -53,6 +156,10 @@ void LesionsModelDisplayObject::RemoveAllSubModelDisplayObjects()
 		it.remove();
 		delete subModelDisplayObject;
 	}
+
+	m_pColoredActiveLesion = NULL;
+	m_surfaceAppearances.clear();
+	InvalidatePositionIndex();
 }
 
 SubModelDisplayObject* LesionsModelDisplayObject::CreateSubModelDisplayObject(inurbsSubModel* pSubModel)
@@ -77,6 +184,7 @@ SubModelDisplayObject* LesionsModelDisplayObject::CreateSubModelDisplayObject(in
 	label2DDisplayObject->GetLabelPipeline()->setScale(2.0);
 	label3DDisplayObject->GetLabelPipeline()->setText("");
 
+	InvalidatePositionIndex();
 	return subModelDisplayObject;
 }
 
@@ -102,6 +210,7 @@ void LesionsModelDisplayObject::UpdateSurfaceDisplayObject(int modelId, inurbsSu
 		surfaceDisplayObject->SetSurface(pSurface);
 		surfaceDisplayObject->UpdateSurface();
 	}
+	InvalidatePositionIndex();
 
 	// update 2D label display object
 	Label2DDisplayObject* label2DDisplayObject = subModelDisplayObject->GetLabel2DDisplayObject();
@@ -119,11 +228,12 @@ void LesionsModelDisplayObject::UpdateSurfaceDisplayObject(int modelId, inurbsSu
 
 void LesionsModelDisplayObject::SetSurfaceVisibleByPosition(double position, vtkRenderer* renderer)
 {
-	QMapIterator<inurbsSubModel *, SubModelDisplayObject*> its(*m_pSubModelDisplayObjects);
-	while(its.hasNext())
+	QList<inurbsSubModel*> subModels = GetSubModelsToUpdate(m_surfaceState, position, renderer);
+	for (int i = 0; i < subModels.size(); i++)
 	{
-		its.next();
-		its.value()->SetSurfaceVisibleByPosition(position, renderer);
+		SubModelDisplayObject* subModelDisplayObject = m_pSubModelDisplayObjects->value(subModels.at(i));
+		if (subModelDisplayObject)
+			subModelDisplayObject->SetSurfaceVisibleByPosition(position, renderer);
 	}
 }
 
@@ -151,12 +261,10 @@ Label3DDisplayObject* LesionsModelDisplayObject::GetLabel3DDisplayObject(inurbsS
 
 void LesionsModelDisplayObject::SetLabelsVisibleByPosition(double position, vtkRenderer* renderer)
 {
-	QMutableMapIterator<inurbsSubModel*, SubModelDisplayObject*> it(*m_pSubModelDisplayObjects);
-	while (it.hasNext())
+	QList<inurbsSubModel*> subModels = GetSubModelsToUpdate(m_labelState, position, renderer);
+	for (int i = 0; i < subModels.size(); i++)
 	{
-		it.next();
-		inurbsSubModel* pSubModel = it.key();
-		SubModelDisplayObject* subModelDisplayObject = GetSubModelDisplayObject(pSubModel);
+		SubModelDisplayObject* subModelDisplayObject = GetSubModelDisplayObject(subModels.at(i));
 		if (!subModelDisplayObject)
 			continue;
 
@@ -210,6 +318,7 @@ void LesionsModelDisplayObject::UpdateCurveLabel(int modelId, inurbsSubModel* pS
 	label3DDisplayObject->SetPosition();
 	label3DDisplayObject->GetLabelPipeline()->setText(text3.toLatin1());
 
+	InvalidatePositionIndex();
 }
 
 
@@ -219,15 +328,18 @@ void LesionsModelDisplayObject::UpdateCurveLabel(int modelId, inurbsSubModel* pS
 
 void LesionsModelDisplayObject::SetCurveVisibleByPosition(inurbsSubModel* pSubModel, double position, vtkRenderer* renderer)
 {
-	QMapIterator<inurbsSubModel *, SubModelDisplayObject*> its(*m_pSubModelDisplayObjects);
-	while(its.hasNext())
+	QList<inurbsSubModel*> subModels = GetSubModelsToUpdate(m_curveState, position, renderer, pSubModel);
+	for (int i = 0; i < subModels.size(); i++)
 	{
-		its.next();
-		its.value()->SetCurveVisibleByPosition(position, renderer);
+		SubModelDisplayObject* subModelDisplayObject = m_pSubModelDisplayObjects->value(subModels.at(i));
+		if (!subModelDisplayObject)
+			continue;
+
+		subModelDisplayObject->SetCurveVisibleByPosition(position, renderer);
 
-		if (pSubModel != its.key()) // set the points to be invisible if it is not the current model
+		if (pSubModel != subModels.at(i)) // set the points to be invisible if it is not the current model
 		{
-			CurveDisplayObject* curveDisplayObject = its.value()->GetCurveDisplayObject(position);
+			CurveDisplayObject* curveDisplayObject = subModelDisplayObject->GetCurveDisplayObject(position);
 			if (curveDisplayObject) // if curves from other models exist, set the points invisible. 
 				curveDisplayObject->SetPointsVisible(false,renderer);
 		}
@@ -236,6 +348,12 @@ void LesionsModelDisplayObject::SetCurveVisibleByPosition(inurbsSubModel* pSubMo
 
 void LesionsModelDisplayObject::SetLesionsColor(inurbsSubModel* pActiveLesion)
 {
+	// colors only change with the active lesion
+	if (m_bColorValid && m_pColoredActiveLesion == pActiveLesion)
+		return;
+	m_bColorValid = true;
+	m_pColoredActiveLesion = pActiveLesion;
+
 	QMapIterator<inurbsSubModel *, SubModelDisplayObject*> its(*m_pSubModelDisplayObjects);
 	while(its.hasNext())
 	{
@@ -252,3 +370,432 @@ void LesionsModelDisplayObject::SetLesionsColor(inurbsSubModel* pActiveLesion)
 		}
 	}
 }
+
+/******************************************************************************/
+/*  Position index functions
+/******************************************************************************/
+
+void LesionsModelDisplayObject::InvalidatePositionIndex()
+{
+	m_bZExtentsValid = false;
+	m_curveState.bValid = false;
+	m_labelState.bValid = false;
+	m_surfaceState.bValid = false;
+	m_bColorValid = false;
+}
+
+void LesionsModelDisplayObject::UpdateZExtents()
+{
+	m_zExtents.clear();
+	m_fMaxZExtentLength = 0.0;
+
+	QMapIterator<inurbsSubModel *, SubModelDisplayObject*> its(*m_pSubModelDisplayObjects);
+	while (its.hasNext())
+	{
+		its.next();
+		inurbsPlanarCurveStack* pCurveStack = its.key()->GetCurveStack();
+		if (!pCurveStack)
+			continue;
+
+		bool bFirst = true;
+		double fMinZ = 0.0, fMaxZ = 0.0;
+		int iNumCurves = pCurveStack->GetNumOfCurves();
+		for (int i = 0; i < iNumCurves; i++)
+		{
+			inurbsPlanarCurve* pCurve = pCurveStack->GetCurve(i);
+			if (!pCurve || pCurve->GetNumOfPoints() == 0)
+				continue;
+
+			double z = pCurve->GetPoints()->at(0)->z;
+			if (bFirst || z < fMinZ)
+				fMinZ = z;
+			if (bFirst || z > fMaxZ)
+				fMaxZ = z;
+			bFirst = false;
+		}
+
+		// submodels without curves have nothing to show at any position
+		if (bFirst)
+			continue;
+
+		ZExtent extent;
+		extent.fMinZ = fMinZ - POSITION_INDEX_MARGIN;
+		extent.fMaxZ = fMaxZ + POSITION_INDEX_MARGIN;
+		extent.pSubModel = its.key();
+		m_zExtents.append(extent);
+		m_fMaxZExtentLength = qMax(m_fMaxZExtentLength, extent.fMaxZ - extent.fMinZ);
+	}
+
+	std::sort(m_zExtents.begin(), m_zExtents.end(), [](const ZExtent& a, const ZExtent& b) { return a.fMinZ < b.fMinZ; });
+	m_bZExtentsValid = true;
+}
+
+QList<inurbsSubModel*> LesionsModelDisplayObject::GetSubModelsToUpdate(PositionState& state, double position, vtkRenderer* renderer, inurbsSubModel* pSubModel)
+{
+	QList<inurbsSubModel*> subModels;
+
+	// anything else than a slice move updates all submodels
+	if (!state.bValid || state.pRenderer != renderer || state.pSubModel != pSubModel)
+	{
+		subModels = m_pSubModelDisplayObjects->keys();
+	}
+	else if (state.fPosition != position)
+	{
+		if (!m_bZExtentsValid)
+			UpdateZExtents();
+
+		// an extent covering a position starts at most the longest extent below it
+		double positions[2] = { state.fPosition, position };
+		for (int i = 0; i < 2; i++)
+		{
+			QVector<ZExtent>::const_iterator it = std::lower_bound(m_zExtents.constBegin(), m_zExtents.constEnd(), positions[i] - m_fMaxZExtentLength,
+				[](const ZExtent& extent, double z) { return extent.fMinZ < z; });
+			for (; it != m_zExtents.constEnd() && it->fMinZ <= positions[i]; ++it)
+			{
+				if (it->fMaxZ < positions[i])
+					continue;
+
+				// covering both positions, added for the previous one already
+				if (i == 1 && state.fPosition >= it->fMinZ && state.fPosition <= it->fMaxZ)
+					continue;
+
+				subModels.append(it->pSubModel);
+			}
+		}
+	}
+
+	state.bValid = true;
+	state.fPosition = position;
+	state.pRenderer = renderer;
+	state.pSubModel = pSubModel;
+
+	return subModels;
+}
+
+/******************************************************************************/
+/*  Merged surface functions
+/******************************************************************************/
+
+void LesionsModelDisplayObject::AddMergedSurfaceActors(vtkRenderer* renderer)
+{
+	if (!renderer || m_pMergedRenderer)
+		return;
+
+	m_pMergedRenderer = renderer;
+
+	// inactive lesions colored by the cell scalars, the active lesion red as SetLesionsColor
+	InitSurfaceLOD(m_mergedLOD, 1.0, 1.0, 0.0, true);
+	InitSurfaceLOD(m_activeLOD, 1.0, 0.0, 0.0, false);
+	renderer->AddViewProp(m_mergedLOD.pProp);
+	renderer->AddViewProp(m_activeLOD.pProp);
+
+	// pick the level of detail before every render of the 3D view
+	vtkSmartPointer<vtkCallbackCommand> callback = vtkSmartPointer<vtkCallbackCommand>::New();
+	callback->SetCallback(OnMergedRendererStart);
+	callback->SetClientData(this);
+	m_iMergedRendererObserver = renderer->AddObserver(vtkCommand::StartEvent, callback);
+}
+
+void LesionsModelDisplayObject::UpdateMergedSurfaces()
+{
+	if (!m_bMergedSurfaces || !m_pMergedRenderer)
+		return;
+
+	inurbsSubModel* pActiveLesion = m_pSubModelDisplayObjects->contains(m_pColoredActiveLesion) ? m_pColoredActiveLesion : NULL;
+
+	// surface polydata are modified in place on rebuilds and previews, so compare their modified times
+	QList<MergedSurface> surfaces;
+	QMapIterator<inurbsSubModel *, SubModelDisplayObject*> its(*m_pSubModelDisplayObjects);
+	while (its.hasNext())
+	{
+		its.next();
+		MergedSurface surface;
+		surface.pSubModel = its.key();
+		surface.pPolyData = its.value()->GetSurfaceDisplayObject()->GetSurfacePolyData();
+		surface.iModifiedTime = surface.pPolyData ? surface.pPolyData->GetMTime() : 0;
+		surface.appearance = GetSurfaceAppearance(surface.pSubModel);
+		surfaces.append(surface);
+	}
+
+	// the active lesion has its own actor, its rebuilds and drag previews leave the merged polydata alone
+	vtkPolyData* pActivePolyData = NULL;
+	SurfaceAppearance activeAppearance = GetSurfaceAppearance(pActiveLesion);
+	bool bChanged = (pActiveLesion != m_pMergedActiveLesion || surfaces.size() != m_mergedSurfaces.size());
+	for (int i = 0; i < surfaces.size(); i++)
+	{
+		const MergedSurface& surface = surfaces.at(i);
+		if (surface.pSubModel == pActiveLesion && activeAppearance.bVisible && surface.pPolyData && surface.pPolyData->GetNumberOfCells() > 0)
+			pActivePolyData = surface.pPolyData;
+
+		if (bChanged)
+			continue;
+
+		const MergedSurface& merged = m_mergedSurfaces.at(i);
+		bChanged = (surface.pSubModel != merged.pSubModel || surface.pPolyData != merged.pPolyData ||
+			surface.appearance.bVisible != merged.appearance.bVisible || surface.appearance.fOpacity != merged.appearance.fOpacity ||
+			(surface.pSubModel != pActiveLesion && surface.iModifiedTime != merged.iModifiedTime));
+	}
+
+	m_activeLOD.pProperty->SetOpacity(activeAppearance.fOpacity);
+	SetSurfaceLODInput(m_activeLOD, pActivePolyData);
+
+	m_mergedSurfaces = surfaces;
+	m_pMergedActiveLesion = pActiveLesion;
+	if (!bChanged)
+		return;
+
+	// the visible inactive lesions are merged at their common opacity, with
+	// different ones only the opaque lesions are and the others drawn on their own
+	QList<MergedSurface> mergedSurfaces, separateSurfaces;
+	for (int i = 0; i < surfaces.size(); i++)
+	{
+		const MergedSurface& surface = surfaces.at(i);
+		if (surface.pSubModel == pActiveLesion || !surface.appearance.bVisible || !surface.pPolyData || surface.pPolyData->GetNumberOfCells() == 0)
+			continue;
+
+		mergedSurfaces.append(surface);
+	}
+
+	double fMergedOpacity = mergedSurfaces.isEmpty() ? 1.0 : mergedSurfaces.first().appearance.fOpacity;
+	for (int i = 0; i < mergedSurfaces.size(); i++)
+	{
+		if (mergedSurfaces.at(i).appearance.fOpacity != fMergedOpacity)
+		{
+			fMergedOpacity = 1.0;
+			break;
+		}
+	}
+
+	vtkSmartPointer<vtkAppendPolyData> append = vtkSmartPointer<vtkAppendPolyData>::New();
+	for (int i = 0; i < mergedSurfaces.size(); i++)
+	{
+		if (mergedSurfaces.at(i).appearance.fOpacity != fMergedOpacity)
+		{
+			separateSurfaces.append(mergedSurfaces.at(i));
+			continue;
+		}
+
+		// yellow for the inactive lesions as SetLesionsColor
+		vtkPolyData* pPolyData = mergedSurfaces.at(i).pPolyData;
+		const unsigned char yellow[3] = { 255, 255, 0 };
+		vtkIdType iNumCells = pPolyData->GetNumberOfCells();
+		vtkSmartPointer<vtkUnsignedCharArray> colors = vtkSmartPointer<vtkUnsignedCharArray>::New();
+		colors->SetNumberOfComponents(3);
+		colors->SetNumberOfTuples(iNumCells);
+		for (vtkIdType j = 0; j < iNumCells; j++)
+			colors->SetTypedTuple(j, yellow);
+
+		vtkSmartPointer<vtkPolyData> lesionPolyData = vtkSmartPointer<vtkPolyData>::New();
+		lesionPolyData->ShallowCopy(pPolyData);
+		lesionPolyData->GetPointData()->SetScalars(NULL);
+		lesionPolyData->GetCellData()->SetScalars(colors);
+		append->AddInputData(lesionPolyData);
+	}
+
+	m_mergedLOD.pProperty->SetOpacity(fMergedOpacity);
+	if (append->GetNumberOfInputConnections(0) > 0)
+	{
+		append->Update();
+		SetSurfaceLODInput(m_mergedLOD, append->GetOutput());
+	}
+	else
+		SetSurfaceLODInput(m_mergedLOD, NULL);
+
+	SetSeparateSurfaces(separateSurfaces);
+}
+
+void LesionsModelDisplayObject::SetSurfaceAppearance(inurbsSubModel* pSubModel, bool bVisible, double fOpacity)
+{
+	if (bVisible && fOpacity >= 1.0)
+		m_surfaceAppearances.remove(pSubModel);
+	else
+	{
+		SurfaceAppearance appearance;
+		appearance.bVisible = bVisible;
+		appearance.fOpacity = fOpacity;
+		m_surfaceAppearances.insert(pSubModel, appearance);
+	}
+}
+
+LesionsModelDisplayObject::SurfaceAppearance LesionsModelDisplayObject::GetSurfaceAppearance(inurbsSubModel* pSubModel)
+{
+	SurfaceAppearance appearance;
+	appearance.bVisible = true;
+	appearance.fOpacity = 1.0;
+	return m_surfaceAppearances.value(pSubModel, appearance);
+}
+
+void LesionsModelDisplayObject::SetSeparateSurfaces(const QList<MergedSurface>& surfaces)
+{
+	// the actors of lesions merged again or gone are removed, the others are
+	// reused, the full mesh is drawn as for a lesion outside merged mode
+	QMap<inurbsSubModel*, vtkSmartPointer<vtkActor> > actors;
+	for (int i = 0; i < surfaces.size(); i++)
+	{
+		const MergedSurface& surface = surfaces.at(i);
+		vtkSmartPointer<vtkActor> actor = m_separateActors.take(surface.pSubModel);
+		if (!actor)
+		{
+			vtkSmartPointer<vtkPolyDataMapper> mapper = vtkSmartPointer<vtkPolyDataMapper>::New();
+			mapper->ScalarVisibilityOff();
+			actor = vtkSmartPointer<vtkActor>::New();
+			actor->SetMapper(mapper);
+			actor->GetProperty()->SetColor(1.0, 1.0, 0.0);
+			m_pMergedRenderer->AddActor(actor);
+		}
+
+		actor->GetMapper()->SetInputDataObject(surface.pPolyData);
+		actor->GetProperty()->SetOpacity(surface.appearance.fOpacity);
+		actors.insert(surface.pSubModel, actor);
+	}
+
+	QMapIterator<inurbsSubModel*, vtkSmartPointer<vtkActor> > it(m_separateActors);
+	while (it.hasNext())
+		m_pMergedRenderer->RemoveActor(it.next().value());
+
+	m_separateActors = actors;
+}
+
+/******************************************************************************/
+/*  Level of detail functions
+/******************************************************************************/
+
+void LesionsModelDisplayObject::InitSurfaceLOD(SurfaceLOD& lod, double r, double g, double b, bool bCellColors)
+{
+	lod.pFullMapper = vtkSmartPointer<vtkPolyDataMapper>::New();
+	lod.pFullMapper->SetInputData(vtkSmartPointer<vtkPolyData>::New());
+	if (bCellColors)
+	{
+		lod.pFullMapper->SetScalarModeToUseCellData();
+		lod.pFullMapper->SetColorModeToDirectScalars();
+		lod.pFullMapper->ScalarVisibilityOn();
+	}
+	else
+		lod.pFullMapper->ScalarVisibilityOff();
+
+	// the decimation drops the cell colors, the proxy is drawn in the plain color
+	lod.pProxyMapper = vtkSmartPointer<vtkPolyDataMapper>::New();
+	lod.pProxyMapper->SetInputData(vtkSmartPointer<vtkPolyData>::New());
+	lod.pProxyMapper->ScalarVisibilityOff();
+
+	lod.pProperty = vtkSmartPointer<vtkProperty>::New();
+	lod.pProperty->SetColor(r, g, b);
+
+	lod.pProp = vtkSmartPointer<vtkLODProp3D>::New();
+	lod.iFullId = lod.pProp->AddLOD(lod.pFullMapper, lod.pProperty, 0.0);
+	lod.iProxyId = lod.pProp->AddLOD(lod.pProxyMapper, lod.pProperty, 0.0);
+	lod.pProp->AutomaticLODSelectionOff();
+	lod.pProp->SetSelectedLODID(lod.iFullId);
+	lod.pProp->VisibilityOff();
+
+	lod.pInput = NULL;
+	lod.iInputTime = 0;
+	lod.bProxyPending = false;
+	lod.iGeneration = 0;
+}
+
+void LesionsModelDisplayObject::SetSurfaceLODInput(SurfaceLOD& lod, vtkPolyData* pPolyData)
+{
+	if (!pPolyData)
+	{
+		lod.pInput = NULL;
+		lod.bProxyPending = false;
+		lod.iGeneration++;
+		lod.pProp->VisibilityOff();
+		return;
+	}
+
+	lod.pProp->VisibilityOn();
+
+	// same mesh as shown already, keep the proxy
+	if (lod.pInput == pPolyData && lod.iInputTime == pPolyData->GetMTime())
+		return;
+
+	lod.pInput = pPolyData;
+	lod.iInputTime = pPolyData->GetMTime();
+	lod.iGeneration++;
+	lod.pFullMapper->SetInputData(pPolyData);
+
+	if (pPolyData->GetNumberOfCells() <= LOD_PROXY_CELLS)
+	{
+		lod.bProxyPending = false;
+		lod.pProxyMapper->SetInputData(pPolyData);
+		return;
+	}
+
+	// the previous proxy stays until the new one is decimated, the full mesh
+	// if there is none yet
+	vtkPolyData* pProxy = vtkPolyData::SafeDownCast(lod.pProxyMapper->GetInput());
+	if (!pProxy || pProxy->GetNumberOfCells() == 0)
+		lod.pProxyMapper->SetInputData(pPolyData);
+
+	// every drag preview modifies the input, decimate once it stops changing
+	lod.bProxyPending = true;
+	m_proxyTimer.start();
+}
+
+void LesionsModelDisplayObject::OnProxyTimeout()
+{
+	StartProxyBuild(LOD_MERGED);
+	StartProxyBuild(LOD_ACTIVE);
+}
+
+void LesionsModelDisplayObject::StartProxyBuild(int iLOD)
+{
+	SurfaceLOD& lod = GetSurfaceLOD(iLOD);
+	if (!lod.bProxyPending || !lod.pInput)
+		return;
+
+	lod.bProxyPending = false;
+	m_proxyThreadPool.start(new SurfaceProxyTask(this, iLOD, lod.iGeneration, lod.pInput));
+}
+
+void LesionsModelDisplayObject::ProxyBuilt(int iLOD, int iGeneration, vtkSmartPointer<vtkPolyData> proxy)
+{
+	{
+		QMutexLocker locker(&m_proxyMutex);
+		m_proxyResults.append(qMakePair(qMakePair(iLOD, iGeneration), proxy));
+	}
+
+	QMetaObject::invokeMethod(this, "OnProxyBuilt", Qt::QueuedConnection);
+}
+
+void LesionsModelDisplayObject::OnProxyBuilt()
+{
+	QList<QPair<QPair<int, int>, vtkSmartPointer<vtkPolyData> > > results;
+	{
+		QMutexLocker locker(&m_proxyMutex);
+		results.swap(m_proxyResults);
+	}
+
+	// a proxy of an input replaced while decimating is dropped, the new input has its own
+	for (int i = 0; i < results.size(); i++)
+	{
+		SurfaceLOD& lod = GetSurfaceLOD(results.at(i).first.first);
+		if (results.at(i).first.second == lod.iGeneration)
+			lod.pProxyMapper->SetInputData(results.at(i).second);
+	}
+}
+
+void LesionsModelDisplayObject::SetSurfaceLODInteractive(bool bInteractive)
+{
+	if (m_bLODInteractive == bInteractive || !m_pMergedRenderer)
+		return;
+	m_bLODInteractive = bInteractive;
+
+	m_mergedLOD.pProp->SetSelectedLODID(bInteractive ? m_mergedLOD.iProxyId : m_mergedLOD.iFullId);
+	m_activeLOD.pProp->SetSelectedLODID(bInteractive ? m_activeLOD.iProxyId : m_activeLOD.iFullId);
+}
+
+void LesionsModelDisplayObject::OnMergedRendererStart(vtkObject* caller, unsigned long, void* clientData, void*)
+{
+	// the interactor style raises the desired update rate of the render window
+	// while the camera moves and sets it back to the still rate when it stops
+	vtkRenderer* renderer = static_cast<vtkRenderer*>(caller);
+	vtkRenderWindow* pRenderWindow = renderer->GetRenderWindow();
+	if (!pRenderWindow)
+		return;
+
+	LesionsModelDisplayObject* pThis = static_cast<LesionsModelDisplayObject*>(clientData);
+	pThis->SetSurfaceLODInteractive(pRenderWindow->GetDesiredUpdateRate() >= LOD_INTERACTIVE_UPDATE_RATE);
+}
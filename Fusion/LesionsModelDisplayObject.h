@@ -9,7 +9,13 @@
 
 #include "qvDisplayObject.h"
 #include <vtkRenderer.h>
+#include <vtkSmartPointer.h>
+#include <vtkType.h>
 #include <qmap.h>
+#include <QVector>
+#include <QMutex>
+#include <QTimer>
+#include <QThreadPool>
 
 class SubModelDisplayObject;
 class Label2DDisplayObject;
@@ -17,6 +23,12 @@ class Label3DDisplayObject;
 class ImageStack;
 class inurbsSubModel;
 class inurbsSurface;
+class vtkActor;
+class vtkLODProp3D;
+class vtkObject;
+class vtkPolyData;
+class vtkPolyDataMapper;
+class vtkProperty;
 
 class LesionsModelDisplayObject : qvDisplayObject
 {
@@ -47,9 +59,125 @@ public:
 	void SetCurveVisibleByPosition(inurbsSubModel* pSubModel, double position, vtkRenderer* renderer = 0);
 	void SetLesionsColor(inurbsSubModel* pActiveLesion);
 
+	// call when curves or surfaces are added, changed or removed
+	void InvalidatePositionIndex();
+
+	// merged surfaces: the inactive lesion surfaces are drawn as one actor with
+	// per-cell colors and the active lesion as a second actor. The submodel
+	// surfaces are then not added to the 3D context, so the mode has to be set
+	// before any submodel display object is created.
+	void SetMergedSurfaces(bool bMerged) { m_bMergedSurfaces = bMerged; }
+	bool IsMergedSurfaces() { return m_bMergedSurfaces; }
+	void AddMergedSurfaceActors(vtkRenderer* renderer);
+	void UpdateMergedSurfaces(); // rebuilds the merged polydata only if an inactive surface or the active lesion changed
+
+	// 3D appearance of one lesion surface in merged mode, visible and opaque by
+	// default. A hidden lesion is left out, lesions of different opacities are
+	// drawn with their own actors, the others merged at their common opacity.
+	void SetSurfaceAppearance(inurbsSubModel* pSubModel, bool bVisible, double fOpacity);
+
+	// the merged actors show decimated proxies while the camera of their renderer is moved
+	void SetSurfaceLODInteractive(bool bInteractive);
+
 protected:
+	// last applied slice position of one of the *VisibleByPosition functions
+	struct PositionState
+	{
+		bool bValid;
+		double fPosition;
+		vtkRenderer* pRenderer;
+		inurbsSubModel* pSubModel;
+	};
+
+	void UpdateZExtents();
+	QList<inurbsSubModel*> GetSubModelsToUpdate(PositionState& state, double position, vtkRenderer* renderer, inurbsSubModel* pSubModel = NULL);
+
 	QMap<inurbsSubModel *, SubModelDisplayObject*>* m_pSubModelDisplayObjects;
 
+	// z extent index of the submodel curves, when the slice moves only the submodels
+	// covering the previous or the new position can change visibility. The extents
+	// are sorted by their start, a position is looked up by binary search from the
+	// longest extent below it
+	struct ZExtent
+	{
+		double fMinZ;
+		double fMaxZ;
+		inurbsSubModel* pSubModel;
+	};
+
+	QVector<ZExtent> m_zExtents;
+	double m_fMaxZExtentLength;
+	bool m_bZExtentsValid;
+	PositionState m_curveState, m_labelState, m_surfaceState;
+	bool m_bColorValid;
+	inurbsSubModel* m_pColoredActiveLesion;
+
+	// merged surfaces
+	struct SurfaceAppearance
+	{
+		bool bVisible;
+		double fOpacity;
+	};
+
+	struct MergedSurface
+	{
+		inurbsSubModel* pSubModel;
+		vtkPolyData* pPolyData;
+		vtkMTimeType iModifiedTime;
+		SurfaceAppearance appearance;
+	};
+
+	// full mesh and its decimated proxy. The proxy is decimated on a worker once
+	// the input stops changing, e.g. when a drag ends, the previous proxy is
+	// shown until then
+	struct SurfaceLOD
+	{
+		vtkSmartPointer<vtkLODProp3D> pProp;
+		vtkSmartPointer<vtkPolyDataMapper> pFullMapper;
+		vtkSmartPointer<vtkPolyDataMapper> pProxyMapper;
+		vtkSmartPointer<vtkProperty> pProperty; // of both levels
+		int iFullId;
+		int iProxyId;
+		vtkPolyData* pInput;
+		vtkMTimeType iInputTime;
+		bool bProxyPending;
+		int iGeneration; // of the input, a proxy of an older one is dropped
+	};
+
+	enum { LOD_MERGED, LOD_ACTIVE };
+
+	void InitSurfaceLOD(SurfaceLOD& lod, double r, double g, double b, bool bCellColors);
+	void SetSurfaceLODInput(SurfaceLOD& lod, vtkPolyData* pPolyData);
+	SurfaceLOD& GetSurfaceLOD(int iLOD) { return iLOD == LOD_MERGED ? m_mergedLOD : m_activeLOD; }
+	void StartProxyBuild(int iLOD);
+
+	// called by the worker
+	void ProxyBuilt(int iLOD, int iGeneration, vtkSmartPointer<vtkPolyData> proxy);
+
+	static void OnMergedRendererStart(vtkObject* caller, unsigned long eventId, void* clientData, void* callData);
+	SurfaceAppearance GetSurfaceAppearance(inurbsSubModel* pSubModel);
+	void SetSeparateSurfaces(const QList<MergedSurface>& surfaces);
+
+	bool m_bMergedSurfaces;
+	vtkRenderer* m_pMergedRenderer;
+	unsigned long m_iMergedRendererObserver;
+	SurfaceLOD m_mergedLOD;
+	SurfaceLOD m_activeLOD;
+	bool m_bLODInteractive;
+	QThreadPool m_proxyThreadPool;
+	QTimer m_proxyTimer;
+	QMutex m_proxyMutex;
+	QList<QPair<QPair<int, int>, vtkSmartPointer<vtkPolyData> > > m_proxyResults; // (lod, generation), proxy
+	QList<MergedSurface> m_mergedSurfaces; // what the merged actors currently show
+	inurbsSubModel* m_pMergedActiveLesion;
+	QMap<inurbsSubModel*, SurfaceAppearance> m_surfaceAppearances; // lesions not visible and opaque
+	QMap<inurbsSubModel*, vtkSmartPointer<vtkActor> > m_separateActors; // inactive lesions drawn on their own
+
+	friend class SurfaceProxyTask;
+
+protected slots:
+	void OnProxyTimeout();
+	void OnProxyBuilt();
 };
 
 #endif
\ No newline at end of file
@@ -0,0 +1,331 @@
+/******************************************************************************
+	ModelAutosave.cpp
+
+	Date      : 18 Oct 2026
+******************************************************************************/
+
+#include <QRunnable>
+#include <QFile>
+#include <QFileInfo>
+#include <QDateTime>
+#include <QStringList>
+
+#include "ModelAutosave.h"
+#include "ModelBinaryFile.h"
+#include "ChunkedCrypto.h"
+#include "FusionSurgery.h"
+#include "FusionTrace.h"
+#include "FusionDebugLog.h"
+#include "CommonClasses.h"
+#include "Constants.h"
+#include "PDP.h"
+
+/******************************************************************************/
+/* Save task
+/******************************************************************************/
+
+class ModelAutosaveTask : public QRunnable
+{
+public:
+	ModelAutosaveTask(ModelAutosave* pAutosave, int iGeneration, const QList<ModelXmlReader::SubModel>& snapshot, QString sRemarks, QString sFile, QString sPassword)
+	{
+		m_pAutosave = pAutosave;
+		m_iGeneration = iGeneration;
+		m_snapshot = snapshot;
+		m_sRemarks = sRemarks;
+		m_sFile = sFile;
+		m_sPassword = sPassword;
+	}
+
+	void run()
+	{
+		bool bSaved;
+		{
+			FUSION_TRACE_SCOPE("AutosaveModel", "model");
+			bSaved = Save();
+		}
+
+		m_pAutosave->SaveFinished(m_iGeneration, bSaved);
+	}
+
+protected:
+	bool Save()
+	{
+		ModelBinaryWriter writer;
+		for (int i = 0; i < m_snapshot.size(); i++)
+			writer.AddSubModel(m_snapshot.at(i));
+		QByteArray data = writer.GetData(m_sRemarks);
+
+		// written next to the file and renamed, a crash while saving keeps the previous autosave
+		QString sTempFile = m_sFile + ".tmp";
+		bool bWriteOk;
+		if (m_sPassword != "")
+			bWriteOk = ChunkedCrypto::EncryptToFile(data.constData(), data.size(), sTempFile, m_sPassword);
+		else
+		{
+			QFile file(sTempFile);
+			bWriteOk = file.open(QIODevice::WriteOnly | QIODevice::Truncate) && file.write(data) == data.size();
+			file.close();
+		}
+
+		if (!bWriteOk)
+		{
+			QFile::remove(sTempFile);
+			return false;
+		}
+
+		QFile::remove(m_sFile);
+		return QFile::rename(sTempFile, m_sFile);
+	}
+
+	ModelAutosave* m_pAutosave;
+	int m_iGeneration;
+	QList<ModelXmlReader::SubModel> m_snapshot;
+	QString m_sRemarks;
+	QString m_sFile;
+	QString m_sPassword;
+};
+
+/******************************************************************************/
+/* Constructors and destructors
+/******************************************************************************/
+
+ModelAutosave::ModelAutosave(QObject* parent) : QObject(parent)
+{
+	m_pSurgery = NULL;
+	m_bDirty = false;
+	m_bSaving = false;
+	m_bPaused = false;
+	m_bAllEdited = false;
+	m_iGeneration = 0;
+
+	m_threadPool.setMaxThreadCount(1);
+
+	m_delayTimer.setSingleShot(true);
+	m_delayTimer.setInterval(MODEL_AUTOSAVE_DELAY);
+	connect(&m_delayTimer, SIGNAL(timeout()), this, SLOT(OnSaveTimeout()));
+
+	m_intervalTimer.setSingleShot(true);
+	m_intervalTimer.setInterval(MODEL_AUTOSAVE_INTERVAL);
+	connect(&m_intervalTimer, SIGNAL(timeout()), this, SLOT(OnSaveTimeout()));
+}
+
+ModelAutosave::~ModelAutosave()
+{
+	Stop();
+}
+
+/******************************************************************************/
+/* Autosave functions
+/******************************************************************************/
+
+void ModelAutosave::Start(FusionSurgery* pSurgery)
+{
+	Stop();
+	m_pSurgery = pSurgery;
+}
+
+void ModelAutosave::Stop()
+{
+	m_delayTimer.stop();
+	m_intervalTimer.stop();
+	m_threadPool.waitForDone();
+
+	// results of this surgery are not looked at any more
+	m_iGeneration++;
+	m_bDirty = false;
+	m_bSaving = false;
+	m_bPaused = false;
+	m_snapshot.clear();
+	m_snapshotSources.clear();
+	m_editedSubModels.clear();
+	m_bAllEdited = false;
+	m_pSurgery = NULL;
+}
+
+void ModelAutosave::Pause()
+{
+	m_bPaused = true;
+	m_delayTimer.stop();
+	m_intervalTimer.stop();
+	m_threadPool.waitForDone();
+}
+
+void ModelAutosave::Resume()
+{
+	m_bPaused = false;
+	if (m_pSurgery && m_bDirty)
+		m_delayTimer.start();
+}
+
+void ModelAutosave::MarkDirty(inurbsSubModel* pSubModel)
+{
+	if (!m_pSurgery)
+		return;
+
+	m_bDirty = true;
+	if (pSubModel)
+		m_editedSubModels.insert(pSubModel);
+	else
+		m_bAllEdited = true;
+	if (m_bPaused)
+		return;
+
+	// saved once the edits pause, but not later than the interval after the first one
+	m_delayTimer.start();
+	if (!m_intervalTimer.isActive())
+		m_intervalTimer.start();
+}
+
+void ModelAutosave::InvalidateSnapshot()
+{
+	m_bAllEdited = true;
+}
+
+void ModelAutosave::Discard()
+{
+	if (!m_pSurgery)
+		return;
+
+	m_delayTimer.stop();
+	m_intervalTimer.stop();
+	m_threadPool.waitForDone(); // a running save would write the file again
+
+	m_iGeneration++;
+	m_bDirty = false;
+	m_bSaving = false;
+	Remove(m_pSurgery->GetCasePath());
+}
+
+void ModelAutosave::StartSave()
+{
+	m_delayTimer.stop();
+	m_intervalTimer.stop();
+
+	QString sCasePath = m_pSurgery->GetCasePath();
+	if (sCasePath == "")
+		return;
+
+	// a deleted lesion is marked too, so a new one at its address is not taken for it
+	QList<ModelXmlReader::SubModel> snapshot;
+	QMap<int, inurbsSubModel*> sources;
+	if (!m_pSurgery->GetModelSnapshot(snapshot, sources, m_snapshot, m_bAllEdited ? QMap<int, inurbsSubModel*>() : m_snapshotSources, m_editedSubModels))
+	{
+		m_bDirty = false; // models the binary format does not map are not autosaved
+		return;
+	}
+
+	m_snapshot = snapshot;
+	m_snapshotSources = sources;
+	m_editedSubModels.clear();
+	m_bAllEdited = false;
+	m_bDirty = false;
+	m_bSaving = true;
+	m_threadPool.start(new ModelAutosaveTask(this, m_iGeneration, m_snapshot, m_pSurgery->GetLesionRemarks(),
+		GetFileName(sCasePath), m_pSurgery->GetEncryptCasePassword()));
+}
+
+void ModelAutosave::SaveFinished(int iGeneration, bool bSaved)
+{
+	{
+		QMutexLocker locker(&m_resultMutex);
+		m_results.append(qMakePair(iGeneration, bSaved));
+	}
+
+	QMetaObject::invokeMethod(this, "OnSaveFinished", Qt::QueuedConnection);
+}
+
+void ModelAutosave::OnSaveTimeout()
+{
+	if (!m_pSurgery || !m_bDirty || m_bPaused)
+		return;
+
+	// the edits made meanwhile are saved when the running save has finished
+	if (m_bSaving)
+		return;
+
+	StartSave();
+}
+
+void ModelAutosave::OnSaveFinished()
+{
+	QList<QPair<int, bool> > results;
+	{
+		QMutexLocker locker(&m_resultMutex);
+		results.swap(m_results);
+	}
+
+	for (int i = 0; i < results.size(); i++)
+	{
+		if (results.at(i).first != m_iGeneration)
+			continue;
+
+		m_bSaving = false;
+		if (!results.at(i).second)
+		{
+			FUSION_DLOG(FUSION_DLOG_WARNING, "model", "autosave-failed", FusionDebugLog::Fields()
+				.Add("file", GetFileName(m_pSurgery->GetCasePath())));
+			m_bDirty = true; // tried again after the next edit or the interval
+			if (!m_intervalTimer.isActive() && !m_bPaused)
+				m_intervalTimer.start();
+		}
+	}
+
+	if (m_pSurgery && m_bDirty && !m_bSaving && !m_bPaused && !m_delayTimer.isActive())
+		StartSave();
+}
+
+/******************************************************************************/
+/* File functions
+/******************************************************************************/
+
+QString ModelAutosave::GetFileName(QString sCasePath)
+{
+	return sCasePath + "/model/" + MODEL_AUTOSAVE_FILE_NAME;
+}
+
+bool ModelAutosave::IsNewer(QString sCasePath)
+{
+	QFileInfo autosaveInfo(GetFileName(sCasePath));
+	if (!autosaveInfo.exists())
+		return false;
+
+	QString sFolder = sCasePath + "/model/";
+	QStringList modelFiles;
+	modelFiles << XML_FILE_NAME_MODEL << MODEL_BINARY_FILE_NAME;
+	for (int i = 0; i < modelFiles.size(); i++)
+	{
+		QFileInfo plainInfo(sFolder + modelFiles.at(i));
+		QFileInfo encryptedInfo(sFolder + modelFiles.at(i) + ENCRYPTION_FILE_EXTENSION);
+		if ((plainInfo.exists() && plainInfo.lastModified() >= autosaveInfo.lastModified()) ||
+			(encryptedInfo.exists() && encryptedInfo.lastModified() >= autosaveInfo.lastModified()))
+			return false;
+	}
+
+	return true;
+}
+
+bool ModelAutosave::Read(QString sCasePath, QString sPassword, ModelBinaryReader& reader)
+{
+	QString sFile = GetFileName(sCasePath);
+	if (!ChunkedCrypto::IsChunkedFile(sFile))
+		return reader.Read(sFile);
+
+	// decrypted in memory, the plain model never reaches the disk
+	ChunkedCryptoReader cryptoReader;
+	if (!cryptoReader.Open(sFile, sPassword))
+		return false;
+
+	QByteArray data((int)cryptoReader.GetSize(), Qt::Uninitialized);
+	if (!cryptoReader.ReadAll(data.data()))
+		return false;
+
+	return reader.ReadData(data);
+}
+
+void ModelAutosave::Remove(QString sCasePath)
+{
+	QString sFile = GetFileName(sCasePath);
+	QFile::remove(sFile);
+	QFile::remove(sFile + ".tmp");
+}
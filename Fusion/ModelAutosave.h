@@ -0,0 +1,89 @@
+/******************************************************************************
+	ModelAutosave.h
+
+	Date      : 18 Oct 2026
+******************************************************************************/
+
+#ifndef MODEL_AUTOSAVE_H
+#define MODEL_AUTOSAVE_H
+
+#include <QObject>
+#include <QList>
+#include <QMap>
+#include <QSet>
+#include <QMutex>
+#include <QTimer>
+#include <QThreadPool>
+
+#include "ModelXmlStream.h"
+
+class FusionSurgery;
+class inurbsSubModel;
+class ModelBinaryReader;
+
+#define MODEL_AUTOSAVE_FILE_NAME "autosave.fbm" // binary model, chunked encryption for encrypted cases
+#define MODEL_AUTOSAVE_DELAY 3000 // ms after the last edit
+#define MODEL_AUTOSAVE_INTERVAL 60000 // ms at most between saves while the model keeps changing
+
+// Saves the model to the model folder in the background while the lesions are
+// edited, so the work since the last approval survives a crash. The curves are
+// copied into a snapshot on the main thread, the lesions not marked edited share
+// the curves of the previous snapshot without their points being read, and the
+// snapshot is serialized, encrypted and
+// written on a worker thread. A save is skipped while the previous one is
+// still running and done once it has finished.
+//
+// The file is removed when the model is saved the regular way, a file newer
+// than the model is offered for recovery when the case is opened.
+class ModelAutosave : public QObject
+{
+	Q_OBJECT
+
+public:
+	ModelAutosave(QObject* parent = 0);
+	~ModelAutosave();
+
+	void Start(FusionSurgery* pSurgery);
+	void Stop(); // waits for a running save, the file is kept
+	void Pause(); // waits for a running save, edits are saved after Resume(), e.g. while the case files are encrypted
+	void Resume();
+	void MarkDirty(inurbsSubModel* pSubModel = NULL); // the submodel was edited, NULL for any
+	void InvalidateSnapshot(); // submodels were changed or deleted without MarkDirty(), the next save compares them all
+	void Discard(); // the model was saved, the autosave is not needed any more
+
+	static QString GetFileName(QString sCasePath);
+	static bool IsNewer(QString sCasePath); // newer than model.xml and its binary copy
+	static bool Read(QString sCasePath, QString sPassword, ModelBinaryReader& reader);
+	static void Remove(QString sCasePath);
+
+protected:
+	void StartSave();
+
+	// called by the worker
+	void SaveFinished(int iGeneration, bool bSaved);
+
+	FusionSurgery* m_pSurgery;
+	QThreadPool m_threadPool;
+	QTimer m_delayTimer;
+	QTimer m_intervalTimer;
+	bool m_bDirty;
+	bool m_bSaving;
+	bool m_bPaused;
+	int m_iGeneration;
+
+	QList<ModelXmlReader::SubModel> m_snapshot; // last snapshot, shared with the next one
+	QMap<int, inurbsSubModel*> m_snapshotSources; // submodel of each id in m_snapshot
+	QSet<inurbsSubModel*> m_editedSubModels; // since m_snapshot
+	bool m_bAllEdited;
+
+	QMutex m_resultMutex;
+	QList<QPair<int, bool> > m_results;
+
+	friend class ModelAutosaveTask;
+
+protected slots:
+	void OnSaveTimeout();
+	void OnSaveFinished();
+};
+
+#endif
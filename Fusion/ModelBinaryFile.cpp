@@ -0,0 +1,312 @@
+/******************************************************************************
+	ModelBinaryFile.cpp
+
+	Date      : 18 Oct 2026
+******************************************************************************/
+
+#include <QFile>
+#include <QtEndian>
+#include <string.h>
+
+#include "ModelBinaryFile.h"
+
+#define MODEL_BINARY_MAGIC "FBM1"
+
+/******************************************************************************/
+/* Little endian helpers
+/******************************************************************************/
+
+static void AppendU32(QByteArray& data, quint32 iValue)
+{
+	uchar bytes[4];
+	qToLittleEndian(iValue, bytes);
+	data.append((const char*)bytes, 4);
+}
+
+static void AppendF32(QByteArray& data, float fValue)
+{
+	quint32 iBits;
+	memcpy(&iBits, &fValue, 4);
+	AppendU32(data, iBits);
+}
+
+static void AppendF64(QByteArray& data, double fValue)
+{
+	quint64 iBits;
+	memcpy(&iBits, &fValue, 8);
+	uchar bytes[8];
+	qToLittleEndian(iBits, bytes);
+	data.append((const char*)bytes, 8);
+}
+
+static quint32 ReadU32(const char* p)
+{
+	return qFromLittleEndian<quint32>((const uchar*)p);
+}
+
+static float ReadF32(const char* p)
+{
+	quint32 iBits = ReadU32(p);
+	float fValue;
+	memcpy(&fValue, &iBits, 4);
+	return fValue;
+}
+
+static double ReadF64(const char* p)
+{
+	quint64 iBits = qFromLittleEndian<quint64>((const uchar*)p);
+	double fValue;
+	memcpy(&fValue, &iBits, 8);
+	return fValue;
+}
+
+/******************************************************************************/
+/* Reader
+/******************************************************************************/
+
+bool ModelBinaryReader::Read(QString sFile)
+{
+	QFile file(sFile);
+	if (!file.open(QIODevice::ReadOnly))
+	{
+		m_subModels.clear();
+		m_sRemarks.clear();
+		m_sError = file.errorString();
+		return false;
+	}
+
+	QByteArray data = file.readAll();
+	file.close();
+
+	return ReadData(data);
+}
+
+bool ModelBinaryReader::ReadData(const QByteArray& data)
+{
+	m_subModels.clear();
+	m_sRemarks.clear();
+	m_xmlHash.clear();
+	m_sError.clear();
+
+	if (data.size() < ModelBinaryWriter::HEADER_SIZE || memcmp(data.constData(), MODEL_BINARY_MAGIC, 4) != 0)
+	{
+		m_sError = "not a binary model file";
+		return false;
+	}
+
+	const char* pHeader = data.constData();
+	quint32 iVersion = ReadU32(pHeader + 4);
+	quint32 iFlags = ReadU32(pHeader + 8);
+	quint32 iPayloadSize = ReadU32(pHeader + 12);
+	quint32 iStoredSize = ReadU32(pHeader + 16);
+	if (iVersion > MODEL_BINARY_FILE_VERSION)
+	{
+		m_sError = QString("file version %1 is newer than this application").arg(iVersion);
+		return false;
+	}
+	if ((qint64)iStoredSize != data.size() - ModelBinaryWriter::HEADER_SIZE)
+	{
+		m_sError = "truncated file";
+		return false;
+	}
+
+	QByteArray xmlHash(pHeader + 20, MODEL_XML_HASH_SIZE);
+	if (iVersion >= 2 && xmlHash != QByteArray(MODEL_XML_HASH_SIZE, '\0'))
+		m_xmlHash = xmlHash;
+
+	QByteArray payload = data.mid(ModelBinaryWriter::HEADER_SIZE);
+	if (iFlags & ModelBinaryWriter::FLAG_COMPRESSED)
+		payload = qUncompress(payload);
+
+	if ((quint32)payload.size() != iPayloadSize)
+	{
+		m_sError = "corrupt payload";
+		return false;
+	}
+
+	if (!ReadPayload(payload))
+	{
+		m_subModels.clear();
+		m_sError = "corrupt payload";
+		return false;
+	}
+
+	return true;
+}
+
+bool ModelBinaryReader::ReadPayload(const QByteArray& payload)
+{
+	const char* p = payload.constData();
+	qint64 iSize = payload.size();
+	if (iSize < 12)
+		return false;
+
+	quint32 iNumSubModels = ReadU32(p);
+	quint32 iNumCurves = ReadU32(p + 4);
+	quint32 iRemarksSize = ReadU32(p + 8);
+
+	// table sizes are checked before anything is allocated from them
+	qint64 iSubModelTable = 12;
+	qint64 iCurveTable = iSubModelTable + (qint64)iNumSubModels * 20;
+	qint64 iRemarks = iCurveTable + (qint64)iNumCurves * 16;
+	qint64 iPoints = iRemarks + iRemarksSize;
+	if (iPoints > iSize)
+		return false;
+
+	qint64 iNumPoints = (iSize - iPoints) / 8;
+	m_sRemarks = QString::fromUtf8(p + iRemarks, iRemarksSize);
+
+	for (quint32 i = 0; i < iNumSubModels; i++)
+	{
+		const char* pEntry = p + iSubModelTable + i * 20;
+		quint32 iFirstCurve = ReadU32(pEntry + 12);
+		quint32 iSubModelCurves = ReadU32(pEntry + 16);
+		if ((quint64)iFirstCurve + iSubModelCurves > iNumCurves)
+			return false;
+
+		ModelXmlReader::SubModel subModel;
+		subModel.iId = (qint32)ReadU32(pEntry);
+		int iType = (qint32)ReadU32(pEntry + 4);
+		if (iType != ModelBinaryWriter::TYPE_PROSTATE && iType != ModelBinaryWriter::TYPE_LESION)
+			return false;
+		subModel.sType = iType == ModelBinaryWriter::TYPE_PROSTATE ? MODEL_XML_TYPE_PROSTATE : MODEL_XML_TYPE_LESION;
+		subModel.iRiskScore = (qint32)ReadU32(pEntry + 8);
+
+		for (quint32 j = iFirstCurve; j < iFirstCurve + iSubModelCurves; j++)
+		{
+			const char* pCurveEntry = p + iCurveTable + j * 16;
+			quint32 iFirstPoint = ReadU32(pCurveEntry + 8);
+			quint32 iCurvePoints = ReadU32(pCurveEntry + 12);
+			if ((qint64)iFirstPoint + iCurvePoints > iNumPoints)
+				return false;
+
+			ModelXmlReader::Curve curve;
+			curve.z = ReadF64(pCurveEntry);
+			curve.points.resize(iCurvePoints);
+			const char* pPoint = p + iPoints + (qint64)iFirstPoint * 8;
+			for (quint32 k = 0; k < iCurvePoints; k++, pPoint += 8)
+			{
+				inurbsPoint& point = curve.points[k];
+				point.x = ReadF32(pPoint);
+				point.y = ReadF32(pPoint + 4);
+				point.z = curve.z;
+			}
+			subModel.curves.append(curve);
+		}
+
+		m_subModels.append(subModel);
+	}
+
+	return true;
+}
+
+/******************************************************************************/
+/* Writer
+/******************************************************************************/
+
+void ModelBinaryWriter::AddSubModel(const ModelXmlReader::SubModel& subModel)
+{
+	m_subModels.append(subModel);
+}
+
+QByteArray ModelBinaryWriter::GetData(QString sRemarks, bool bCompress)
+{
+	// count first so every section is appended exactly once
+	quint32 iNumCurves = 0;
+	quint32 iNumPoints = 0;
+	for (int i = 0; i < m_subModels.size(); i++)
+	{
+		const QList<ModelXmlReader::Curve>& curves = m_subModels.at(i).curves;
+		for (int j = 0; j < curves.size(); j++)
+		{
+			if (curves.at(j).points.isEmpty())
+				continue;
+			iNumCurves++;
+			iNumPoints += curves.at(j).points.size();
+		}
+	}
+
+	QByteArray remarks = sRemarks.toUtf8();
+	QByteArray subModelTable, curveTable, points;
+	subModelTable.reserve(m_subModels.size() * 20);
+	curveTable.reserve(iNumCurves * 16);
+	points.reserve(iNumPoints * 8);
+
+	quint32 iCurve = 0;
+	quint32 iPoint = 0;
+	for (int i = 0; i < m_subModels.size(); i++)
+	{
+		const ModelXmlReader::SubModel& subModel = m_subModels.at(i);
+		quint32 iFirstCurve = iCurve;
+
+		for (int j = 0; j < subModel.curves.size(); j++)
+		{
+			const QVector<inurbsPoint>& curvePoints = subModel.curves.at(j).points;
+			if (curvePoints.isEmpty())
+				continue;
+
+			AppendF64(curveTable, subModel.curves.at(j).z);
+			AppendU32(curveTable, iPoint);
+			AppendU32(curveTable, curvePoints.size());
+			for (int k = 0; k < curvePoints.size(); k++)
+			{
+				AppendF32(points, (float)curvePoints.at(k).x);
+				AppendF32(points, (float)curvePoints.at(k).y);
+			}
+
+			iPoint += curvePoints.size();
+			iCurve++;
+		}
+
+		int iType = subModel.sType == MODEL_XML_TYPE_PROSTATE ? TYPE_PROSTATE : TYPE_LESION;
+		AppendU32(subModelTable, subModel.iId);
+		AppendU32(subModelTable, iType);
+		AppendU32(subModelTable, iType == TYPE_LESION ? subModel.iRiskScore : -1);
+		AppendU32(subModelTable, iFirstCurve);
+		AppendU32(subModelTable, iCurve - iFirstCurve);
+	}
+
+	QByteArray payload;
+	payload.reserve(12 + subModelTable.size() + curveTable.size() + remarks.size() + points.size());
+	AppendU32(payload, m_subModels.size());
+	AppendU32(payload, iNumCurves);
+	AppendU32(payload, remarks.size());
+	payload.append(subModelTable).append(curveTable).append(remarks).append(points);
+
+	quint32 iFlags = 0;
+	QByteArray stored;
+	if (bCompress)
+	{
+		// kept plain if compression does not help, e.g. a model without curves
+		stored = qCompress(payload);
+		if (stored.size() < payload.size())
+			iFlags |= FLAG_COMPRESSED;
+		else
+			stored.clear();
+	}
+
+	const QByteArray& body = (iFlags & FLAG_COMPRESSED) ? stored : payload;
+
+	QByteArray header(MODEL_BINARY_MAGIC, 4);
+	AppendU32(header, MODEL_BINARY_FILE_VERSION);
+	AppendU32(header, iFlags);
+	AppendU32(header, payload.size());
+	AppendU32(header, body.size());
+	header.append(m_xmlHash.leftJustified(MODEL_XML_HASH_SIZE, '\0', true));
+	header.append(HEADER_SIZE - header.size(), '\0');
+
+	return header.append(body);
+}
+
+bool ModelBinaryWriter::Write(QString sFile, QString sRemarks, bool bCompress)
+{
+	QByteArray data = GetData(sRemarks, bCompress);
+
+	QFile file(sFile);
+	if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate))
+		return false;
+
+	bool bWriteOk = file.write(data) == data.size();
+	file.close();
+	return bWriteOk;
+}
@@ -0,0 +1,73 @@
+/******************************************************************************
+	ModelBinaryFile.h
+
+	Date      : 18 Oct 2026
+******************************************************************************/
+
+#ifndef MODEL_BINARY_FILE_H
+#define MODEL_BINARY_FILE_H
+
+#include <QString>
+#include <QByteArray>
+#include <QList>
+#include <QVector>
+
+#include "ModelXmlStream.h"
+
+#define MODEL_BINARY_FILE_NAME "model.fbm"
+#define MODEL_BINARY_FILE_VERSION 2
+
+// Binary copy of model.xml, read and written in one piece. model.xml stays
+// the interchange format for the tools and older versions.
+//
+// Layout, little endian:
+//   header    "FBM1", version, flags, payload size, stored size,
+//             model.xml hash[8] (version 2), 4 reserved
+//   payload   number of sub-models, number of curves, remarks size,
+//             sub-model table: id, type, risk score, first curve, curves
+//             curve table: z (double), first point, points
+//             remarks (UTF-8)
+//             points: x, y (float) of all curves back to back
+//
+// The payload is stored compressed with qCompress when that makes it smaller.
+// The hash is the one of the model.xml written with the copy, the copy is
+// only used while model.xml still has that hash, whatever the file times.
+// The writer works on a snapshot of the curves, so it can run off the main
+// thread while the model is being edited.
+class ModelBinaryReader
+{
+public:
+	bool Read(QString sFile);
+	bool ReadData(const QByteArray& data); // contents of a file, e.g. after decryption
+
+	const QList<ModelXmlReader::SubModel>& GetSubModels() { return m_subModels; }
+	QString GetRemarks() { return m_sRemarks; }
+	QByteArray GetXmlHash() { return m_xmlHash; } // empty for the autosave and version 1 files
+	QString GetErrorString() { return m_sError; }
+
+protected:
+	bool ReadPayload(const QByteArray& payload);
+
+	QList<ModelXmlReader::SubModel> m_subModels;
+	QString m_sRemarks;
+	QByteArray m_xmlHash;
+	QString m_sError;
+};
+
+class ModelBinaryWriter
+{
+public:
+	enum { TYPE_PROSTATE = 0, TYPE_LESION = 1, HEADER_SIZE = 32 };
+	enum { FLAG_COMPRESSED = 1 };
+
+	void AddSubModel(const ModelXmlReader::SubModel& subModel); // the points are shared, not copied
+	void SetXmlHash(const QByteArray& hash) { m_xmlHash = hash; } // ModelXmlWriter::GetHash()
+	QByteArray GetData(QString sRemarks, bool bCompress = true);
+	bool Write(QString sFile, QString sRemarks, bool bCompress = true);
+
+protected:
+	QList<ModelXmlReader::SubModel> m_subModels;
+	QByteArray m_xmlHash;
+};
+
+#endif
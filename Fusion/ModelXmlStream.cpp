@@ -0,0 +1,316 @@
+/******************************************************************************
+	ModelXmlStream.cpp
+
+	Date      : 18 Oct 2026
+******************************************************************************/
+
+#include <QXmlStreamReader>
+
+#include "ModelXmlStream.h"
+#include "inurbsSubModel.h"
+#include "inurbsPlanarCurveStack.h"
+
+#define MODEL_XML_FLUSH_SIZE (1 << 20) // bytes buffered before they are written
+
+/******************************************************************************/
+/* Reader
+/******************************************************************************/
+
+bool ModelXmlReader::Read(QString sFile)
+{
+	QFile file(sFile);
+	if (!file.open(QIODevice::ReadOnly))
+	{
+		m_iFileVersion = 0;
+		m_subModels.clear();
+		m_sRemarks.clear();
+		m_sError = file.errorString();
+		return false;
+	}
+
+	QByteArray data = file.readAll();
+	file.close();
+
+	return ReadData(data);
+}
+
+bool ModelXmlReader::ReadData(const QByteArray& data)
+{
+	m_iFileVersion = 0;
+	m_subModels.clear();
+	m_sRemarks.clear();
+	m_sError.clear();
+
+	enum { FIELD_NONE, FIELD_FILE_VERSION, FIELD_ID, FIELD_TYPE, FIELD_RISK_SCORE, FIELD_POSITION_Z, FIELD_POINT, FIELD_REMARKS };
+
+	QXmlStreamReader xml(data);
+	SubModel* pSubModel = NULL;
+	Curve* pCurve = NULL;
+	int iField = FIELD_NONE;
+	bool bModel = false;
+	bool bOk = true;
+
+	while (bOk && !xml.atEnd())
+	{
+		QXmlStreamReader::TokenType token = xml.readNext();
+		if (token == QXmlStreamReader::StartElement)
+		{
+			QStringRef name = xml.name();
+			iField = FIELD_NONE;
+			if (name == QLatin1String("model"))
+				bModel = true;
+			else if (name == QLatin1String("sub-model"))
+			{
+				m_subModels.append(SubModel());
+				pSubModel = &m_subModels.last();
+				pSubModel->iId = -1;
+				pSubModel->iRiskScore = -1;
+				pCurve = NULL;
+			}
+			else if (name == QLatin1String("curve") && pSubModel)
+			{
+				pSubModel->curves.append(Curve());
+				pCurve = &pSubModel->curves.last();
+				pCurve->z = 0.0;
+			}
+			else if (name == QLatin1String("point-x-y") && pCurve)
+				iField = FIELD_POINT;
+			else if (name == QLatin1String("position-z") && pCurve)
+				iField = FIELD_POSITION_Z;
+			else if (name == QLatin1String("id") && pSubModel)
+				iField = FIELD_ID;
+			else if (name == QLatin1String("type") && pSubModel)
+				iField = FIELD_TYPE;
+			else if (name == QLatin1String("risk-score") && pSubModel)
+				iField = FIELD_RISK_SCORE;
+			else if (name == QLatin1String("file-version"))
+				iField = FIELD_FILE_VERSION;
+			else if (name == QLatin1String("lesion-remarks"))
+				iField = FIELD_REMARKS;
+		}
+		else if (token == QXmlStreamReader::Characters && iField != FIELD_NONE)
+		{
+			// the text is only looked at in place, numbers do not go through a QString
+			QStringRef text = xml.text();
+			switch (iField)
+			{
+				case FIELD_POINT:
+				{
+					inurbsPoint point;
+					bOk = ParsePoint(text, pCurve->z, point);
+					pCurve->points.append(point);
+				}
+				break;
+
+				case FIELD_POSITION_Z:
+					pCurve->z = text.toDouble(&bOk);
+				break;
+
+				case FIELD_ID:
+					pSubModel->iId = text.toInt(&bOk);
+				break;
+
+				case FIELD_TYPE:
+					pSubModel->sType = text.toString().trimmed();
+				break;
+
+				case FIELD_RISK_SCORE:
+					pSubModel->iRiskScore = text.toInt(&bOk);
+				break;
+
+				case FIELD_FILE_VERSION:
+					m_iFileVersion = text.toInt(&bOk);
+				break;
+
+				case FIELD_REMARKS: // may come in pieces around entity references
+					m_sRemarks.append(text);
+				break;
+			}
+
+			if (!bOk)
+				m_sError = QString("invalid number \"%1\" in line %2").arg(text.toString()).arg(xml.lineNumber());
+		}
+		else if (token == QXmlStreamReader::EndElement)
+		{
+			QStringRef name = xml.name();
+			if (name == QLatin1String("curve") && pCurve)
+			{
+				// position-z is not required to come before the points
+				for (int i = 0; i < pCurve->points.size(); i++)
+					pCurve->points[i].z = pCurve->z;
+				pCurve = NULL;
+			}
+			else if (name == QLatin1String("sub-model"))
+				pSubModel = NULL;
+
+			iField = FIELD_NONE;
+		}
+	}
+
+	if (bOk && xml.hasError())
+	{
+		m_sError = xml.errorString();
+		bOk = false;
+	}
+	else if (bOk && !bModel)
+	{
+		m_sError = "no model element";
+		bOk = false;
+	}
+
+	return bOk;
+}
+
+bool ModelXmlReader::ParsePoint(const QStringRef& text, double z, inurbsPoint& point)
+{
+	// "x,y", the python tools can also write "x y"
+	QStringRef xy = text.trimmed();
+	int iSeparator = xy.indexOf(QLatin1Char(','));
+	if (iSeparator < 0)
+		iSeparator = xy.indexOf(QLatin1Char(' '));
+	if (iSeparator <= 0)
+		return false;
+
+	bool bOkX, bOkY;
+	point.x = xy.left(iSeparator).toDouble(&bOkX);
+	point.y = xy.mid(iSeparator + 1).toDouble(&bOkY);
+	point.z = z;
+	return bOkX && bOkY;
+}
+
+/******************************************************************************/
+/* Writer
+/******************************************************************************/
+
+ModelXmlWriter::ModelXmlWriter() : m_hash(QCryptographicHash::Md5)
+{
+	m_bWriteOk = false;
+}
+
+ModelXmlWriter::~ModelXmlWriter()
+{
+	if (m_file.isOpen())
+		m_file.close();
+}
+
+bool ModelXmlWriter::Open(QString sFile)
+{
+	m_file.setFileName(sFile);
+	if (!m_file.open(QIODevice::WriteOnly | QIODevice::Truncate))
+		return false;
+
+	m_bWriteOk = true;
+	m_hash.reset();
+	m_buffer.reserve(MODEL_XML_FLUSH_SIZE + 4096);
+	m_buffer.resize(0);
+	m_buffer.append("<model>\n");
+	m_buffer.append("    <file-version>").append(QByteArray::number(MODEL_XML_FILE_VERSION)).append("</file-version>\n");
+	m_buffer.append("    <type>NURBS</type>\n");
+	return true;
+}
+
+void ModelXmlWriter::WriteSubModel(int iId, QString sType, inurbsSubModel* pSubModel)
+{
+	m_buffer.append("    <sub-model>\n");
+	m_buffer.append("        <id>").append(QByteArray::number(iId)).append("</id>\n");
+	m_buffer.append("        <type>").append(sType.toLatin1()).append("</type>\n");
+	if (sType == MODEL_XML_TYPE_LESION)
+		m_buffer.append("        <risk-score>").append(QByteArray::number(pSubModel->GetRiskScore())).append("</risk-score>\n");
+
+	inurbsPlanarCurveStack* pCurveStack = pSubModel->GetCurveStack();
+	int iNumCurves = pCurveStack->GetNumOfCurves();
+	for (int i = 0; i < iNumCurves; i++)
+	{
+		inurbsPlanarCurve* pCurve = pCurveStack->GetCurve(i);
+		if (!pCurve || pCurve->GetNumOfPoints() == 0) // the position is taken from the points
+			continue;
+
+		QList<inurbsPoint*>* pPoints = pCurve->GetPoints();
+		int iNumPoints = pPoints->size();
+
+		m_buffer.append("        <curve>\n");
+		m_buffer.append("            <position-z>");
+		WriteNumber(pPoints->at(0)->z);
+		m_buffer.append("</position-z>\n");
+		m_buffer.append("            <points>\n");
+		for (int j = 0; j < iNumPoints; j++)
+		{
+			const inurbsPoint* pPoint = pPoints->at(j);
+			m_buffer.append("                <point-x-y>");
+			WriteNumber(pPoint->x);
+			m_buffer.append(',');
+			WriteNumber(pPoint->y);
+			m_buffer.append("</point-x-y>\n");
+		}
+		m_buffer.append("            </points>\n");
+		m_buffer.append("        </curve>\n");
+
+		if (m_buffer.size() > MODEL_XML_FLUSH_SIZE)
+			Flush();
+	}
+
+	m_buffer.append("    </sub-model>\n");
+}
+
+bool ModelXmlWriter::Close(QString sRemarks)
+{
+	if (!m_file.isOpen())
+		return false;
+
+	m_buffer.append("    <lesion-remarks>").append(sRemarks.toHtmlEscaped().toUtf8()).append("</lesion-remarks>\n");
+	m_buffer.append("</model>\n");
+	Flush();
+
+	m_file.close();
+	return m_bWriteOk;
+}
+
+void ModelXmlWriter::WriteNumber(double fValue)
+{
+	// fixed 4 decimals like the meta record writer, formatted by hand so
+	// the output does not depend on the locale and nothing is allocated
+	qint64 iScaled = qRound64(fValue * 10000.0);
+	if (iScaled < 0)
+	{
+		m_buffer.append('-');
+		iScaled = -iScaled;
+	}
+
+	char digits[24];
+	int n = 0;
+	qint64 iInteger = iScaled / 10000;
+	do
+	{
+		digits[n++] = (char)('0' + iInteger % 10);
+		iInteger /= 10;
+	} while (iInteger > 0);
+
+	while (n > 0)
+		m_buffer.append(digits[--n]);
+
+	int iFraction = (int)(iScaled % 10000);
+	char fraction[5] = { '.', (char)('0' + iFraction / 1000), (char)('0' + iFraction / 100 % 10), (char)('0' + iFraction / 10 % 10), (char)('0' + iFraction % 10) };
+	m_buffer.append(fraction, 5);
+}
+
+void ModelXmlWriter::Flush()
+{
+	if (m_buffer.isEmpty())
+		return;
+
+	if (m_file.write(m_buffer) != m_buffer.size())
+		m_bWriteOk = false;
+
+	m_hash.addData(m_buffer);
+	m_buffer.resize(0); // keeps the capacity
+}
+
+QByteArray ModelXmlWriter::GetHash()
+{
+	return m_hash.result().left(MODEL_XML_HASH_SIZE);
+}
+
+QByteArray ModelXmlWriter::GetHash(const QByteArray& data)
+{
+	return QCryptographicHash::hash(data, QCryptographicHash::Md5).left(MODEL_XML_HASH_SIZE);
+}
@@ -0,0 +1,95 @@
+/******************************************************************************
+	ModelXmlStream.h
+
+	Date      : 18 Oct 2026
+******************************************************************************/
+
+#ifndef MODEL_XML_STREAM_H
+#define MODEL_XML_STREAM_H
+
+#include <QFile>
+#include <QString>
+#include <QByteArray>
+#include <QList>
+#include <QVector>
+#include <QCryptographicHash>
+
+#include "inurbsPlanarCurve.h" // inurbsPoint
+
+class inurbsSubModel;
+
+#define MODEL_XML_FILE_VERSION 1
+#define MODEL_XML_TYPE_PROSTATE "Prostate"
+#define MODEL_XML_TYPE_LESION "Lesion"
+#define MODEL_XML_FIRST_LESION_ID 4 // ids below are the prostate and critical structures
+#define MODEL_XML_HASH_SIZE 8 // bytes of the MD5 of the file kept in the binary copy
+
+// Streaming reader and writer for model.xml, the same format the meta record
+// DOM of the model writes:
+//
+//   <model> file-version, type, <sub-model>*, lesion-remarks
+//   <sub-model> id, type, risk-score (lesions only), <curve>*
+//   <curve> position-z, <points> <point-x-y>x,y</point-x-y>* </points>
+//
+// The reader parses the numbers straight from the text of the stream reader
+// into one point array per curve. The writer formats them into a buffer that
+// is flushed to the file in large blocks.
+class ModelXmlReader
+{
+public:
+	struct Curve
+	{
+		double z;
+		QVector<inurbsPoint> points;
+	};
+
+	struct SubModel
+	{
+		int iId;
+		QString sType;
+		int iRiskScore;
+		QList<Curve> curves;
+	};
+
+	bool Read(QString sFile);
+	bool ReadData(const QByteArray& data); // contents of a file, e.g. after decryption
+
+	int GetFileVersion() { return m_iFileVersion; }
+	const QList<SubModel>& GetSubModels() { return m_subModels; }
+	QString GetRemarks() { return m_sRemarks; }
+	QString GetErrorString() { return m_sError; }
+
+protected:
+	static bool ParsePoint(const QStringRef& text, double z, inurbsPoint& point);
+
+	int m_iFileVersion;
+	QList<SubModel> m_subModels;
+	QString m_sRemarks;
+	QString m_sError;
+};
+
+class ModelXmlWriter
+{
+public:
+	ModelXmlWriter();
+	~ModelXmlWriter();
+
+	bool Open(QString sFile);
+	void WriteSubModel(int iId, QString sType, inurbsSubModel* pSubModel);
+	bool Close(QString sRemarks);
+
+	// hash of the bytes written, ties the binary copy to this file
+	QByteArray GetHash();
+	static QByteArray GetHash(const QByteArray& data);
+
+protected:
+	void WriteNumber(double fValue);
+	void Flush();
+
+	QFile m_file;
+	QByteArray m_buffer;
+	QCryptographicHash m_hash;
+	bool m_bWriteOk;
+};
+
+#endif
@@ -18,18 +18,8 @@ RTROI::RTROI()
 
 RTROI::~RTROI()
 {
-	// destruct rois
-	if (m_pContours)
-	{
-		int numROIs = m_pContours->size();
-		for (int i = 0; i < numROIs; i++)
-		{
-			RTContour* pContour = m_pContours->at(i);
-			DeleteContour(pContour);
-		}
-		qDeleteAll(m_pContours->begin(), m_pContours->end());
-		m_pContours->clear();
-	}
+	// the contours are in the arena of the struct
+	delete m_pContours;
 }
 
 /******************************************************************************/
@@ -45,7 +35,7 @@ void RTROI::DeleteContour(RTContour* pContour)
 {
 	if (pContour)
 	{
-		delete[] pContour->m_pPoints;
+		m_pContours->removeOne(pContour);
 		pContour->m_iNumPoints = 0;
 		pContour->m_strRefSOPInstanceUID = "";
 	}
@@ -9,6 +9,7 @@
 
 #include <QObject>
 
+// created by RTStruct::CreateContour(), the points belong to the struct
 class RTContour
 {
 public:
@@ -24,7 +25,7 @@ public:
 	~RTROI();
 
 	void AddContour(RTContour* pContour);
-	void DeleteContour(RTContour* pContour);
+	void DeleteContour(RTContour* pContour); // only removes it, the memory is freed with the struct
 	int GetNumContours();
 	RTContour* GetContour(int iIndex);
 	void SetName(const char* strName) { m_sName = strName; }
@@ -15,6 +15,8 @@
 RTStruct::RTStruct()
 {
 	m_pROIs = new QList<RTROI *>();
+	m_iNumBlockPointsUsed = RTSTRUCT_POINT_BLOCK_SIZE;
+	m_iNumBlockContoursUsed = RTSTRUCT_CONTOUR_BLOCK_SIZE;
 }
 
 RTStruct::~RTStruct()
@@ -33,6 +35,12 @@ RTStruct::~RTStruct()
 	}
 
 	delete m_pROIs;
+
+	// a few blocks instead of two allocations per contour
+	for (int i = 0; i < m_pointBlocks.size(); i++)
+		delete [] m_pointBlocks.at(i);
+	for (int i = 0; i < m_contourBlocks.size(); i++)
+		delete [] m_contourBlocks.at(i);
 }
 
 /******************************************************************************/
@@ -69,4 +77,47 @@ RTROI* RTStruct::GetROI(int iIndex)
 	if (iIndex >= GetNumROIs())
 		return NULL;
 	return m_pROIs->at(iIndex);
+}
+
+/******************************************************************************/
+ /* Arena functions
+ /******************************************************************************/
+
+RTContour* RTStruct::CreateContour(int iNumPoints)
+{
+	if (m_iNumBlockContoursUsed == RTSTRUCT_CONTOUR_BLOCK_SIZE)
+	{
+		m_contourBlocks.append(new RTContour[RTSTRUCT_CONTOUR_BLOCK_SIZE]);
+		m_iNumBlockContoursUsed = 0;
+	}
+
+	RTContour* pContour = m_contourBlocks.last() + m_iNumBlockContoursUsed++;
+	pContour->m_pPoints = AllocatePoints(iNumPoints);
+	pContour->m_iNumPoints = iNumPoints;
+	return pContour;
+}
+
+double* RTStruct::AllocatePoints(int iNumPoints)
+{
+	int iSize = iNumPoints * 3;
+	if (iSize <= 0)
+		return NULL;
+
+	// contours bigger than a block get their own, the current block stays last
+	if (iSize > RTSTRUCT_POINT_BLOCK_SIZE)
+	{
+		double* pPoints = new double[iSize];
+		m_pointBlocks.insert(qMax(0, m_pointBlocks.size() - 1), pPoints);
+		return pPoints;
+	}
+
+	if (m_pointBlocks.isEmpty() || m_iNumBlockPointsUsed + iSize > RTSTRUCT_POINT_BLOCK_SIZE)
+	{
+		m_pointBlocks.append(new double[RTSTRUCT_POINT_BLOCK_SIZE]);
+		m_iNumBlockPointsUsed = 0;
+	}
+
+	double* pPoints = m_pointBlocks.last() + m_iNumBlockPointsUsed;
+	m_iNumBlockPointsUsed += iSize;
+	return pPoints;
 }
\ No newline at end of file
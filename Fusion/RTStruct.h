@@ -9,6 +9,10 @@
 
 #include <QObject>
 class RTROI;
+class RTContour;
+
+#define RTSTRUCT_POINT_BLOCK_SIZE (64 * 1024) // doubles per arena block
+#define RTSTRUCT_CONTOUR_BLOCK_SIZE 256 // contours per arena block
 
 class RTStruct
 {
@@ -23,9 +27,20 @@ public:
 	int GetNumROIs();
 	RTROI* GetROI(int iIndex);
 
+	// contours and their points are allocated in blocks owned by the struct
+	// and freed in bulk with it, the ROIs only keep the pointers
+	RTContour* CreateContour(int iNumPoints);
+
 
 private:
+	double* AllocatePoints(int iNumPoints);
+
 	QList<RTROI *>* m_pROIs;
+
+	QList<double*> m_pointBlocks;
+	int m_iNumBlockPointsUsed; // in the last block
+	QList<RTContour*> m_contourBlocks;
+	int m_iNumBlockContoursUsed; // in the last block
 };
 
 #endif
@@ -0,0 +1,315 @@
+/******************************************************************************
+	SurfaceSliceContours.cpp
+
+	Date      : 18 Oct 2026
+******************************************************************************/
+
+#include <QRunnable>
+#include <math.h>
+#include <string.h>
+
+#include <vtkCellArray.h>
+#include <vtkFloatArray.h>
+#include <vtkIdList.h>
+#include <vtkPoints.h>
+#include <vtkPolyData.h>
+
+#include "SurfaceSliceContours.h"
+#include "FusionTrace.h"
+
+#define SLICE_POSITION_TOLERANCE 1e-3 // fraction of the slice spacing still treated as on the slice
+
+/******************************************************************************/
+/* Cut task
+/******************************************************************************/
+
+class SliceContourTask : public QRunnable
+{
+public:
+	SliceContourTask(SurfaceSliceContours* pContours, QSharedPointer<SurfaceSliceContours::BuildJob> pJob, int iFirstSlice, int iLastSlice)
+	{
+		m_pContours = pContours;
+		m_pJob = pJob;
+		m_iFirstSlice = iFirstSlice;
+		m_iLastSlice = iLastSlice;
+	}
+
+	void run()
+	{
+		SurfaceSliceContours::CutSlices(m_pJob.data(), m_iFirstSlice, m_iLastSlice);
+
+		if (!m_pJob->iRemainingTasks.deref() && !m_pJob->iCancelled.loadAcquire())
+			QMetaObject::invokeMethod(m_pContours, "OnBuildFinished", Qt::QueuedConnection);
+	}
+
+protected:
+	SurfaceSliceContours* m_pContours;
+	QSharedPointer<SurfaceSliceContours::BuildJob> m_pJob;
+	int m_iFirstSlice;
+	int m_iLastSlice;
+};
+
+/******************************************************************************/
+/* Constructors and destructors
+/******************************************************************************/
+
+SurfaceSliceContours::SurfaceSliceContours(QObject* parent) : QObject(parent)
+{
+	m_pMesh = NULL;
+	m_iMeshTime = 0;
+	m_fFirstZ = 0.0;
+	m_fSpacingZ = 0.0;
+	m_iNumSlices = 0;
+	m_fOffSliceZ = 0.0;
+	m_pEmptyContour = CreateContour(QVector<float>());
+}
+
+SurfaceSliceContours::~SurfaceSliceContours()
+{
+	CancelBuild();
+	m_threadPool.waitForDone();
+}
+
+/******************************************************************************/
+/* Build functions
+/******************************************************************************/
+
+void SurfaceSliceContours::Update(vtkPolyData* pMesh, double fFirstZ, double fSpacingZ, int iNumSlices, bool bAllSlices)
+{
+	if (!pMesh || fSpacingZ <= 0.0 || iNumSlices <= 0)
+	{
+		Clear();
+		return;
+	}
+
+	// surfaces are rebuilt in place, so the modified time tells an edit apart
+	if (pMesh != m_pMesh || pMesh->GetMTime() != m_iMeshTime ||
+		fFirstZ != m_fFirstZ || fSpacingZ != m_fSpacingZ || iNumSlices != m_iNumSlices)
+	{
+		Clear();
+
+		FUSION_TRACE_SCOPE("ReadSliceContourMesh", "render");
+
+		m_pMesh = pMesh;
+		m_iMeshTime = pMesh->GetMTime();
+		m_fFirstZ = fFirstZ;
+		m_fSpacingZ = fSpacingZ;
+		m_iNumSlices = iNumSlices;
+
+		// a surface without polygons, e.g. before the first build, has empty contours
+		if (!ReadMesh(pMesh))
+		{
+			m_slices.fill(m_pEmptyContour, iNumSlices);
+			return;
+		}
+	}
+
+	if (bAllSlices && m_slices.isEmpty() && !m_pBuildJob)
+		StartBuild(iNumSlices);
+}
+
+void SurfaceSliceContours::StartBuild(int iNumSlices)
+{
+	// the tasks share the arrays of m_mesh, nothing is copied
+	m_pBuildJob = QSharedPointer<BuildJob>(new BuildJob);
+	m_pBuildJob->mesh = m_mesh;
+	m_pBuildJob->fFirstZ = m_fFirstZ;
+	m_pBuildJob->fSpacingZ = m_fSpacingZ;
+	m_pBuildJob->segments.resize(iNumSlices);
+
+	int iNumTasks = qMax(1, qMin(m_threadPool.maxThreadCount(), iNumSlices));
+	m_pBuildJob->iRemainingTasks.store(iNumTasks);
+	for (int i = 0; i < iNumTasks; i++)
+	{
+		int iFirstSlice = (qint64)iNumSlices * i / iNumTasks;
+		int iLastSlice = (qint64)iNumSlices * (i + 1) / iNumTasks;
+		m_threadPool.start(new SliceContourTask(this, m_pBuildJob, iFirstSlice, iLastSlice));
+	}
+}
+
+void SurfaceSliceContours::CancelBuild()
+{
+	// the tasks still running keep the job alive and drop their results
+	if (m_pBuildJob)
+		m_pBuildJob->iCancelled.storeRelease(1);
+	m_pBuildJob.clear();
+}
+
+void SurfaceSliceContours::OnBuildFinished()
+{
+	// a job cancelled after its last task was queued is no longer current
+	if (!m_pBuildJob || m_pBuildJob->iRemainingTasks.loadAcquire() != 0)
+		return;
+
+	FUSION_TRACE_SCOPE("BuildSliceContours", "render");
+
+	// VTK objects are created here, not on the pool
+	QSharedPointer<BuildJob> pJob = m_pBuildJob;
+	m_pBuildJob.clear();
+	m_slices.resize(pJob->segments.size());
+	for (int i = 0; i < m_slices.size(); i++)
+		m_slices[i] = pJob->segments.at(i).isEmpty() ? m_pEmptyContour : CreateContour(pJob->segments.at(i));
+
+	emit built();
+}
+
+void SurfaceSliceContours::Clear()
+{
+	CancelBuild();
+
+	m_mesh.points.clear();
+	m_mesh.cells.clear();
+	m_mesh.offsets.clear();
+	m_mesh.zRange.clear();
+	m_pMesh = NULL;
+	m_iMeshTime = 0;
+	m_iNumSlices = 0;
+	m_slices.clear();
+	m_pOffSliceContour = NULL;
+}
+
+bool SurfaceSliceContours::ReadMesh(vtkPolyData* pMesh)
+{
+	vtkPoints* pPoints = pMesh->GetPoints();
+	vtkCellArray* pPolys = pMesh->GetPolys();
+	if (!pPoints || !pPolys || pPolys->GetNumberOfCells() == 0)
+		return false;
+
+	vtkIdType iNumPoints = pPoints->GetNumberOfPoints();
+	m_mesh.points.resize(iNumPoints * 3);
+	for (vtkIdType i = 0; i < iNumPoints; i++)
+		pPoints->GetPoint(i, m_mesh.points.data() + i * 3);
+
+	vtkSmartPointer<vtkIdList> cell = vtkSmartPointer<vtkIdList>::New();
+	m_mesh.offsets.reserve(pPolys->GetNumberOfCells());
+	m_mesh.zRange.reserve(pPolys->GetNumberOfCells() * 2);
+	for (pPolys->InitTraversal(); pPolys->GetNextCell(cell);)
+	{
+		vtkIdType iNumCellPoints = cell->GetNumberOfIds();
+		if (iNumCellPoints < 3)
+			continue;
+
+		m_mesh.offsets.append(m_mesh.cells.size());
+		m_mesh.cells.append(iNumCellPoints);
+
+		double fMinZ = m_mesh.points.at(cell->GetId(0) * 3 + 2);
+		double fMaxZ = fMinZ;
+		for (vtkIdType j = 0; j < iNumCellPoints; j++)
+		{
+			vtkIdType id = cell->GetId(j);
+			double z = m_mesh.points.at(id * 3 + 2);
+			fMinZ = qMin(fMinZ, z);
+			fMaxZ = qMax(fMaxZ, z);
+			m_mesh.cells.append(id);
+		}
+		m_mesh.zRange.append(fMinZ);
+		m_mesh.zRange.append(fMaxZ);
+	}
+
+	return !m_mesh.offsets.isEmpty();
+}
+
+void SurfaceSliceContours::CutSlices(BuildJob* pJob, int iFirstSlice, int iLastSlice)
+{
+	for (int i = iFirstSlice; i < iLastSlice && !pJob->iCancelled.loadAcquire(); i++)
+		CutMesh(pJob->mesh, pJob->fFirstZ + i * pJob->fSpacingZ, pJob->segments[i]);
+}
+
+void SurfaceSliceContours::CutMesh(const Mesh& mesh, double z, QVector<float>& segments)
+{
+	const double* pPoints = mesh.points.constData();
+	const vtkIdType* pCells = mesh.cells.constData();
+	const double* pRange = mesh.zRange.constData();
+
+	// same side rule as the cutter, a vertex on the plane counts as above it
+	float crossings[8 * 3];
+	int iNumCells = mesh.offsets.size();
+	for (int c = 0; c < iNumCells; c++)
+	{
+		if (z < pRange[c * 2] || z > pRange[c * 2 + 1])
+			continue;
+
+		const vtkIdType* pCell = pCells + mesh.offsets.at(c);
+		vtkIdType iNumCellPoints = pCell[0];
+		int iNumCrossings = 0;
+		for (vtkIdType j = 0; j < iNumCellPoints && iNumCrossings < 8; j++)
+		{
+			const double* a = pPoints + pCell[1 + j] * 3;
+			const double* b = pPoints + pCell[1 + (j + 1) % iNumCellPoints] * 3;
+			double da = a[2] - z;
+			double db = b[2] - z;
+			if ((da < 0.0) == (db < 0.0))
+				continue;
+
+			double t = da / (da - db);
+			float* p = crossings + iNumCrossings * 3;
+			p[0] = (float)(a[0] + t * (b[0] - a[0]));
+			p[1] = (float)(a[1] + t * (b[1] - a[1]));
+			p[2] = (float)z;
+			iNumCrossings++;
+		}
+
+		// a triangle gives one segment, a concave polygon may give more
+		for (int k = 0; k + 1 < iNumCrossings; k += 2)
+		{
+			for (int m = 0; m < 6; m++)
+				segments.append(crossings[k * 3 + m]);
+		}
+	}
+}
+
+vtkSmartPointer<vtkPolyData> SurfaceSliceContours::CreateContour(const QVector<float>& segments)
+{
+	vtkIdType iNumPoints = segments.size() / 3;
+
+	vtkSmartPointer<vtkFloatArray> coordinates = vtkSmartPointer<vtkFloatArray>::New();
+	coordinates->SetNumberOfComponents(3);
+	coordinates->SetNumberOfTuples(iNumPoints);
+	if (iNumPoints > 0)
+		memcpy(coordinates->GetPointer(0), segments.constData(), segments.size() * sizeof(float));
+
+	vtkSmartPointer<vtkPoints> points = vtkSmartPointer<vtkPoints>::New();
+	points->SetData(coordinates);
+
+	vtkSmartPointer<vtkCellArray> lines = vtkSmartPointer<vtkCellArray>::New();
+	lines->AllocateExact(iNumPoints / 2, iNumPoints);
+	for (vtkIdType i = 0; i + 1 < iNumPoints; i += 2)
+	{
+		vtkIdType ids[2] = { i, i + 1 };
+		lines->InsertNextCell(2, ids);
+	}
+
+	vtkSmartPointer<vtkPolyData> contour = vtkSmartPointer<vtkPolyData>::New();
+	contour->SetPoints(points);
+	contour->SetLines(lines);
+	return contour;
+}
+
+/******************************************************************************/
+/* Access functions
+/******************************************************************************/
+
+vtkPolyData* SurfaceSliceContours::GetContour(double z)
+{
+	if (!m_pMesh)
+		return m_pEmptyContour;
+
+	if (!m_slices.isEmpty())
+	{
+		double fIndex = (z - m_fFirstZ) / m_fSpacingZ;
+		int iSlice = (int)floor(fIndex + 0.5);
+		if (iSlice >= 0 && iSlice < m_slices.size() && fabs(fIndex - iSlice) < SLICE_POSITION_TOLERANCE)
+			return m_slices.at(iSlice);
+	}
+
+	// not cut yet or between the image slices, cut once and keep it for repeated renders
+	if (!m_pOffSliceContour || m_fOffSliceZ != z)
+	{
+		QVector<float> segments;
+		CutMesh(m_mesh, z, segments);
+		m_pOffSliceContour = segments.isEmpty() ? m_pEmptyContour : CreateContour(segments);
+		m_fOffSliceZ = z;
+	}
+
+	return m_pOffSliceContour;
+}
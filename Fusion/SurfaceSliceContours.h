@@ -0,0 +1,96 @@
+/******************************************************************************
+	SurfaceSliceContours.h
+
+	Date      : 18 Oct 2026
+******************************************************************************/
+
+#ifndef SURFACE_SLICE_CONTOURS_H
+#define SURFACE_SLICE_CONTOURS_H
+
+#include <QObject>
+#include <QThreadPool>
+#include <QVector>
+#include <QAtomicInt>
+#include <QSharedPointer>
+#include <vtkSmartPointer.h>
+#include <vtkType.h>
+
+class vtkPolyData;
+
+// Cross sections of a surface mesh with every transversal image slice. The
+// mesh is cut against all slice planes on a thread pool, in parallel over
+// slice ranges, and the line segments of each slice are kept as polydata.
+// Changing the slice then only swaps the polydata of a mapper instead of
+// running a vtkCutter over the whole mesh.
+//
+// Until the cut of the current mesh is in, and for meshes that change on every
+// frame such as drag previews, only the viewed slice is cut.
+class SurfaceSliceContours : public QObject
+{
+	Q_OBJECT
+
+public:
+	SurfaceSliceContours(QObject* parent = 0);
+	~SurfaceSliceContours();
+
+	// called before every render, the slices are at z = fFirstZ + i * fSpacingZ, i < iNumSlices.
+	// a changed mesh is read again, bAllSlices starts cutting it against all slices
+	void Update(vtkPolyData* pMesh, double fFirstZ, double fSpacingZ, int iNumSlices, bool bAllSlices);
+	void Clear();
+
+	// contour at the slice position, cut on demand until all slices are in
+	vtkPolyData* GetContour(double z);
+	bool IsBuilt() { return !m_slices.isEmpty(); }
+
+protected:
+	struct Mesh
+	{
+		QVector<double> points;		// x, y, z
+		QVector<vtkIdType> cells;	// number of points followed by the point ids
+		QVector<vtkIdType> offsets;	// start of each cell in cells
+		QVector<double> zRange;		// min, max of each cell
+	};
+
+	// one cut of all slices, shared by its tasks, the last one to finish reports it
+	struct BuildJob
+	{
+		Mesh mesh;
+		double fFirstZ;
+		double fSpacingZ;
+		QVector<QVector<float> > segments;	// per slice, two points per segment
+		QAtomicInt iRemainingTasks;
+		QAtomicInt iCancelled;
+	};
+
+	bool ReadMesh(vtkPolyData* pMesh);
+	void StartBuild(int iNumSlices);
+	void CancelBuild();
+	static void CutSlices(BuildJob* pJob, int iFirstSlice, int iLastSlice); // runs on the pool
+	static void CutMesh(const Mesh& mesh, double z, QVector<float>& segments);
+	static vtkSmartPointer<vtkPolyData> CreateContour(const QVector<float>& segments);
+
+	Mesh m_mesh;
+	vtkPolyData* m_pMesh;	// only compared, never dereferenced
+	vtkMTimeType m_iMeshTime;
+	double m_fFirstZ;
+	double m_fSpacingZ;
+	int m_iNumSlices;
+
+	QSharedPointer<BuildJob> m_pBuildJob; // cut of the current mesh in progress
+	QVector<vtkSmartPointer<vtkPolyData> > m_slices;
+	vtkSmartPointer<vtkPolyData> m_pEmptyContour;
+	vtkSmartPointer<vtkPolyData> m_pOffSliceContour;
+	double m_fOffSliceZ;
+
+	QThreadPool m_threadPool;
+
+	friend class SliceContourTask;
+
+protected slots:
+	void OnBuildFinished();
+
+signals:
+	void built(); // all slices of the current mesh are in, render to show them
+};
+
+#endif
@@ -0,0 +1,372 @@
+/******************************************************************************
+	ZipArchiveWriter.cpp
+
+	Date      : 18 Oct 2026
+******************************************************************************/
+
+#include <QDateTime>
+#include <QtEndian>
+
+#include "ZipArchiveWriter.h"
+
+#define ZIP_LOCAL_HEADER_SIGNATURE 0x04034b50
+#define ZIP_CENTRAL_HEADER_SIGNATURE 0x02014b50
+#define ZIP_END_SIGNATURE 0x06054b50
+#define ZIP64_END_SIGNATURE 0x06064b50
+#define ZIP64_LOCATOR_SIGNATURE 0x07064b50
+#define ZIP64_EXTRA_ID 0x0001
+#define ZIP_VERSION 20
+#define ZIP64_VERSION 45
+#define ZIP_FLAG_UTF8 0x0800
+#define ZIP_METHOD_STORE 0
+#define ZIP_METHOD_DEFLATE 8
+#define ZIP_MAX_ENTRIES 0xFFFF
+#define ZIP_MAX_SIZE 0xFFFFFFFFLL
+#define ZIP_STREAM_BLOCK_SIZE (4 * 1024 * 1024)
+
+/******************************************************************************/
+/* Little endian helpers
+/******************************************************************************/
+
+static void AppendU16(QByteArray& data, quint16 iValue)
+{
+	uchar bytes[2];
+	qToLittleEndian(iValue, bytes);
+	data.append((const char*)bytes, 2);
+}
+
+static void AppendU32(QByteArray& data, quint32 iValue)
+{
+	uchar bytes[4];
+	qToLittleEndian(iValue, bytes);
+	data.append((const char*)bytes, 4);
+}
+
+static void AppendU64(QByteArray& data, quint64 iValue)
+{
+	uchar bytes[8];
+	qToLittleEndian(iValue, bytes);
+	data.append((const char*)bytes, 8);
+}
+
+/******************************************************************************/
+/* Constructors and destructors
+/******************************************************************************/
+
+ZipArchiveWriter::ZipArchiveWriter()
+{
+	m_iDosTime = 0;
+	m_iDosDate = 0;
+	m_bWriteOk = false;
+}
+
+ZipArchiveWriter::~ZipArchiveWriter()
+{
+	if (m_file.isOpen())
+		m_file.close();
+}
+
+/******************************************************************************/
+/* Archive functions
+/******************************************************************************/
+
+bool ZipArchiveWriter::Open(QString sFile)
+{
+	m_entries.clear();
+
+	m_file.setFileName(sFile);
+	if (!m_file.open(QIODevice::WriteOnly | QIODevice::Truncate))
+		return false;
+
+	// all entries get the time the archive was written
+	QDateTime now = QDateTime::currentDateTime();
+	m_iDosTime = (quint16)((now.time().hour() << 11) | (now.time().minute() << 5) | (now.time().second() / 2));
+	m_iDosDate = (quint16)(((qMax(now.date().year(), 1980) - 1980) << 9) | (now.date().month() << 5) | now.date().day());
+
+	m_bWriteOk = true;
+	return true;
+}
+
+bool ZipArchiveWriter::AddFile(QString sName, const QByteArray& data, bool bCompress)
+{
+	Entry entry;
+	entry.name = sName.toUtf8();
+	entry.iMethod = ZIP_METHOD_STORE;
+	entry.iCrc = GetCrc32(data);
+	entry.iSize = (quint64)data.size();
+
+	// qCompress gives a zlib stream after its 4 byte size, zip wants the raw
+	// deflate data between the 2 byte zlib header and the 4 byte adler32
+	QByteArray compressed;
+	if (bCompress && !data.isEmpty())
+	{
+		compressed = qCompress(data);
+		if (compressed.size() > 10 && compressed.size() - 10 < data.size())
+		{
+			compressed = compressed.mid(6, compressed.size() - 10);
+			entry.iMethod = ZIP_METHOD_DEFLATE;
+		}
+		else
+			compressed.clear();
+	}
+
+	const QByteArray& body = entry.iMethod == ZIP_METHOD_DEFLATE ? compressed : data;
+	entry.iStoredSize = (quint64)body.size();
+
+	QByteArray header = GetLocalHeader(entry);
+
+	QMutexLocker locker(&m_mutex);
+
+	if (!BeginEntry(entry, header))
+		return false;
+
+	if (m_file.write(body) != body.size())
+	{
+		m_bWriteOk = false;
+		return false;
+	}
+
+	m_entries.append(entry);
+	return true;
+}
+
+bool ZipArchiveWriter::AddFile(QString sName, QString sSourceFile)
+{
+	QFile source(sSourceFile);
+	if (!source.open(QIODevice::ReadOnly))
+		return false;
+
+	Entry entry;
+	entry.name = sName.toUtf8();
+	entry.iMethod = ZIP_METHOD_STORE;
+	entry.iCrc = 0;
+	entry.iSize = (quint64)source.size();
+	entry.iStoredSize = entry.iSize;
+
+	// the crc is computed before the lock, so the workers read and sum their
+	// files at once and only the copy into the archive is serialized
+	QByteArray block(ZIP_STREAM_BLOCK_SIZE, Qt::Uninitialized);
+	quint64 iRead = 0;
+	while (iRead < entry.iSize)
+	{
+		qint64 iBlock = source.read(block.data(), qMin((quint64)block.size(), entry.iSize - iRead));
+		if (iBlock <= 0)
+			return false;
+
+		entry.iCrc = UpdateCrc32(entry.iCrc, block.constData(), iBlock);
+		iRead += iBlock;
+	}
+
+	if (!source.seek(0))
+		return false;
+
+	QByteArray header = GetLocalHeader(entry);
+
+	QMutexLocker locker(&m_mutex);
+
+	if (!BeginEntry(entry, header))
+		return false;
+
+	quint64 iWritten = 0;
+	while (iWritten < entry.iSize)
+	{
+		qint64 iBlock = source.read(block.data(), qMin((quint64)block.size(), entry.iSize - iWritten));
+		if (iBlock <= 0)
+			return false; // the entry is not listed, the next one starts after the bytes written
+
+		if (m_file.write(block.constData(), iBlock) != iBlock)
+		{
+			m_bWriteOk = false;
+			return false;
+		}
+
+		iWritten += iBlock;
+	}
+
+	m_entries.append(entry);
+	return true;
+}
+
+void ZipArchiveWriter::RemoveEntries(QString sPrefix)
+{
+	QByteArray prefix = sPrefix.toUtf8();
+
+	QMutexLocker locker(&m_mutex);
+
+	for (int i = m_entries.size() - 1; i >= 0; i--)
+	{
+		if (m_entries.at(i).name.startsWith(prefix))
+			m_entries.removeAt(i);
+	}
+}
+
+bool ZipArchiveWriter::Close()
+{
+	QMutexLocker locker(&m_mutex);
+
+	if (!m_file.isOpen())
+		return false;
+
+	QByteArray directory;
+	for (int i = 0; i < m_entries.size(); i++)
+	{
+		const Entry& entry = m_entries.at(i);
+
+		// the values past 32 bit go into the zip64 extra field in this order
+		QByteArray extra;
+		if (entry.iSize >= ZIP_MAX_SIZE)
+			AppendU64(extra, entry.iSize);
+		if (entry.iStoredSize >= ZIP_MAX_SIZE)
+			AppendU64(extra, entry.iStoredSize);
+		if (entry.iOffset >= ZIP_MAX_SIZE)
+			AppendU64(extra, entry.iOffset);
+
+		QByteArray extraField;
+		if (!extra.isEmpty())
+		{
+			AppendU16(extraField, ZIP64_EXTRA_ID);
+			AppendU16(extraField, extra.size());
+			extraField.append(extra);
+		}
+
+		quint16 iVersion = extraField.isEmpty() ? ZIP_VERSION : ZIP64_VERSION;
+		AppendU32(directory, ZIP_CENTRAL_HEADER_SIGNATURE);
+		AppendU16(directory, iVersion);
+		AppendU16(directory, iVersion);
+		AppendU16(directory, ZIP_FLAG_UTF8);
+		AppendU16(directory, entry.iMethod);
+		AppendU16(directory, m_iDosTime);
+		AppendU16(directory, m_iDosDate);
+		AppendU32(directory, entry.iCrc);
+		AppendU32(directory, (quint32)qMin(entry.iStoredSize, (quint64)ZIP_MAX_SIZE));
+		AppendU32(directory, (quint32)qMin(entry.iSize, (quint64)ZIP_MAX_SIZE));
+		AppendU16(directory, entry.name.size());
+		AppendU16(directory, extraField.size());
+		AppendU16(directory, 0); // comment
+		AppendU16(directory, 0); // disk
+		AppendU16(directory, 0); // internal attributes
+		AppendU32(directory, 0); // external attributes
+		AppendU32(directory, (quint32)qMin(entry.iOffset, (quint64)ZIP_MAX_SIZE));
+		directory.append(entry.name);
+		directory.append(extraField);
+	}
+
+	quint64 iDirectoryOffset = (quint64)m_file.pos();
+	quint64 iDirectorySize = (quint64)directory.size();
+	quint64 iNumEntries = (quint64)m_entries.size();
+
+	// the zip64 end record and its locator go before the end record
+	bool bZip64 = iNumEntries >= ZIP_MAX_ENTRIES || iDirectorySize >= ZIP_MAX_SIZE || iDirectoryOffset >= ZIP_MAX_SIZE;
+	if (bZip64)
+	{
+		quint64 iZip64EndOffset = iDirectoryOffset + iDirectorySize;
+		AppendU32(directory, ZIP64_END_SIGNATURE);
+		AppendU64(directory, 44); // size of the rest of the record
+		AppendU16(directory, ZIP64_VERSION);
+		AppendU16(directory, ZIP64_VERSION);
+		AppendU32(directory, 0);
+		AppendU32(directory, 0);
+		AppendU64(directory, iNumEntries);
+		AppendU64(directory, iNumEntries);
+		AppendU64(directory, iDirectorySize);
+		AppendU64(directory, iDirectoryOffset);
+
+		AppendU32(directory, ZIP64_LOCATOR_SIGNATURE);
+		AppendU32(directory, 0);
+		AppendU64(directory, iZip64EndOffset);
+		AppendU32(directory, 1);
+	}
+
+	AppendU32(directory, ZIP_END_SIGNATURE);
+	AppendU16(directory, 0);
+	AppendU16(directory, 0);
+	AppendU16(directory, (quint16)qMin(iNumEntries, (quint64)ZIP_MAX_ENTRIES));
+	AppendU16(directory, (quint16)qMin(iNumEntries, (quint64)ZIP_MAX_ENTRIES));
+	AppendU32(directory, (quint32)qMin(iDirectorySize, (quint64)ZIP_MAX_SIZE));
+	AppendU32(directory, (quint32)qMin(iDirectoryOffset, (quint64)ZIP_MAX_SIZE));
+	AppendU16(directory, 0);
+
+	if (m_bWriteOk && m_file.write(directory) != directory.size())
+		m_bWriteOk = false;
+
+	m_file.close();
+	if (!m_bWriteOk)
+		m_file.remove();
+	return m_bWriteOk;
+}
+
+QByteArray ZipArchiveWriter::GetLocalHeader(const Entry& entry)
+{
+	// the sizes of an entry past 4 GB are in the zip64 extra field
+	bool bZip64 = entry.iSize >= ZIP_MAX_SIZE || entry.iStoredSize >= ZIP_MAX_SIZE;
+
+	QByteArray header;
+	header.reserve(30 + entry.name.size() + 20);
+	AppendU32(header, ZIP_LOCAL_HEADER_SIGNATURE);
+	AppendU16(header, bZip64 ? ZIP64_VERSION : ZIP_VERSION);
+	AppendU16(header, ZIP_FLAG_UTF8);
+	AppendU16(header, entry.iMethod);
+	AppendU16(header, m_iDosTime);
+	AppendU16(header, m_iDosDate);
+	AppendU32(header, entry.iCrc);
+	AppendU32(header, bZip64 ? (quint32)ZIP_MAX_SIZE : (quint32)entry.iStoredSize);
+	AppendU32(header, bZip64 ? (quint32)ZIP_MAX_SIZE : (quint32)entry.iSize);
+	AppendU16(header, entry.name.size());
+	AppendU16(header, bZip64 ? 20 : 0);
+	header.append(entry.name);
+	if (bZip64)
+	{
+		AppendU16(header, ZIP64_EXTRA_ID);
+		AppendU16(header, 16);
+		AppendU64(header, entry.iSize);
+		AppendU64(header, entry.iStoredSize);
+	}
+
+	return header;
+}
+
+bool ZipArchiveWriter::BeginEntry(Entry& entry, const QByteArray& header)
+{
+	if (!m_bWriteOk || !m_file.isOpen())
+		return false;
+
+	entry.iOffset = (quint64)m_file.pos();
+	if (m_file.write(header) != header.size())
+	{
+		m_bWriteOk = false;
+		return false;
+	}
+
+	return true;
+}
+
+quint32 ZipArchiveWriter::GetCrc32(const QByteArray& data)
+{
+	return UpdateCrc32(0, data.constData(), data.size());
+}
+
+quint32 ZipArchiveWriter::UpdateCrc32(quint32 iCrc, const char* pData, qint64 iSize)
+{
+	// built once, thread safe as a function static
+	static const struct CrcTable
+	{
+		quint32 values[256];
+		CrcTable()
+		{
+			for (quint32 i = 0; i < 256; i++)
+			{
+				quint32 c = i;
+				for (int k = 0; k < 8; k++)
+					c = (c & 1) ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+				values[i] = c;
+			}
+		}
+	} table;
+
+	iCrc ^= 0xFFFFFFFFu;
+	const uchar* p = (const uchar*)pData;
+	for (qint64 i = 0; i < iSize; i++)
+		iCrc = table.values[(iCrc ^ p[i]) & 0xFF] ^ (iCrc >> 8);
+
+	return iCrc ^ 0xFFFFFFFFu;
+}
@@ -0,0 +1,62 @@
+/******************************************************************************
+	ZipArchiveWriter.h
+
+	Date      : 18 Oct 2026
+******************************************************************************/
+
+#ifndef ZIP_ARCHIVE_WRITER_H
+#define ZIP_ARCHIVE_WRITER_H
+
+#include <QFile>
+#include <QString>
+#include <QByteArray>
+#include <QList>
+#include <QMutex>
+
+// Writes a zip archive entry by entry. Small entries are added from memory,
+// stored or deflated, large ones are streamed from a file block by block and
+// stored. The writes are serialized, the crc of a streamed file is summed
+// before, so the entries can be added from several workers at once. Entries, offsets and the archive past 4 GB or 65535 entries
+// get the zip64 records.
+class ZipArchiveWriter
+{
+public:
+	ZipArchiveWriter();
+	~ZipArchiveWriter();
+
+	bool Open(QString sFile);
+	bool AddFile(QString sName, const QByteArray& data, bool bCompress);
+	bool AddFile(QString sName, QString sSourceFile); // streamed and stored
+
+	// leaves the entries under sPrefix out of the central directory, their data
+	// stays in the file but is not listed, e.g. the files of a case that failed
+	void RemoveEntries(QString sPrefix);
+
+	bool Close(); // writes the central directory, false if any write failed
+
+	static quint32 GetCrc32(const QByteArray& data);
+	static quint32 UpdateCrc32(quint32 iCrc, const char* pData, qint64 iSize); // start with 0
+
+protected:
+	struct Entry
+	{
+		QByteArray name;
+		quint16 iMethod;
+		quint32 iCrc;
+		quint64 iStoredSize;
+		quint64 iSize;
+		quint64 iOffset;
+	};
+
+	QByteArray GetLocalHeader(const Entry& entry);
+	bool BeginEntry(Entry& entry, const QByteArray& header); // called with m_mutex locked
+
+	QFile m_file;
+	QMutex m_mutex;
+	QList<Entry> m_entries;
+	quint16 m_iDosTime;
+	quint16 m_iDosDate;
+	bool m_bWriteOk;
+};
+
+#endif